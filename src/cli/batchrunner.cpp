@@ -0,0 +1,574 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a platform for agent-based modeling on networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+#include "batchrunner.h"
+#include "core/experimentsmgr.h"
+
+namespace evoplex {
+
+int BatchRunner::exec(MainApp* mainApp, const QStringList& arguments)
+{
+    BatchRunner runner(mainApp);
+    if (!runner.init(arguments)) {
+        return InvalidArgs;
+    }
+    if (runner.isMerge()) {
+        return runner.merge();
+    }
+    connect(&runner, &BatchRunner::finished,
+            QCoreApplication::instance(), &QCoreApplication::exit, Qt::QueuedConnection);
+    runner.start();
+    return QCoreApplication::exec();
+}
+
+std::vector<std::set<int>> BatchRunner::partition(
+        std::vector<std::pair<int, quint64>> costs, const int numShards)
+{
+    Q_ASSERT_X(numShards > 0, "BatchRunner", "the number of shards must be positive");
+
+    // longest processing time first; ties are broken by id to make it stable
+    std::sort(costs.begin(), costs.end(),
+        [](const std::pair<int, quint64>& a, const std::pair<int, quint64>& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+
+    std::vector<std::set<int>> shards(static_cast<size_t>(numShards));
+    std::vector<quint64> loads(static_cast<size_t>(numShards), 0);
+    for (const auto& item : costs) {
+        // the least loaded shard (the first one, if tied)
+        const size_t s = std::min_element(loads.begin(), loads.end()) - loads.begin();
+        shards[s].insert(item.first);
+        loads[s] += item.second;
+    }
+    return shards;
+}
+
+BatchRunner::BatchRunner(MainApp* mainApp, QObject* parent)
+    : QObject(parent),
+      m_mainApp(mainApp),
+      m_out(stdout),
+      m_shard(-1),
+      m_numShards(1),
+      m_mergeShards(0),
+      m_pending(0),
+      m_failed(0),
+      m_control(false),
+      m_controlNotifier(nullptr)
+{
+    connect(&m_progressTimer, SIGNAL(timeout()), SLOT(printProgress()));
+}
+
+bool BatchRunner::init(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs all experiments of an Evoplex project without GUI.");
+    parser.setSingleDashWordOptionMode(QCommandLineParser::ParseAsLongOptions);
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("project", "The project file (.csv).");
+    QCommandLineOption noGui("no-gui", "Runs without GUI (implied by evoplex-cli).");
+    QCommandLineOption threads({"t", "threads"}, "Number of threads (default: all cores).", "n");
+    QCommandLineOption progress("progress", "Seconds between progress reports; 0 to disable (default: 5).", "secs", "5");
+    QCommandLineOption shard("shard", "Runs only the i-th of N shards of the project (0 <= i < N).", "i/N");
+    QCommandLineOption merge("merge", "Merges the outputs of the N shards of the project.", "N");
+    QCommandLineOption resume("resume", "Resumes the trials from their latest checkpoints (see '" OUTPUT_CHECKPOINT "').");
+    QCommandLineOption quantumSteps("quantum-steps", "Max steps a trial runs before yielding to the queued ones; 0 for no limit (default).", "k", "0");
+    QCommandLineOption quantumMsecs("quantum-msecs", "Max milliseconds a trial runs before yielding to the queued ones; 0 for no limit (default).", "ms", "0");
+    QCommandLineOption memory("memory", "Memory budget (MB) for the running trials; 0 for no limit (default).", "mb", "0");
+    QCommandLineOption affinity("affinity", "Pins the threads to 'cores' or to NUMA 'nodes' (default: none).", "policy", "none");
+    QCommandLineOption control("control", "Reads commands from stdin while running: "
+                               "'threads n', 'quantum k ms', 'memory mb', 'placement' or 'status'.");
+    parser.addOptions({noGui, threads, progress, shard, merge, resume, quantumSteps, quantumMsecs,
+                       memory, affinity, control});
+    parser.process(arguments); // exits on --help, --version and unknown options
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1) {
+        printError("a single project file is expected.\n" + parser.helpText());
+        return false;
+    }
+
+    if (parser.isSet(threads)) {
+        bool ok = false;
+        const int n = parser.value(threads).toInt(&ok);
+        QString error;
+        if (ok) {
+            m_mainApp->expMgr()->setMaxThreadCount(n, &error);
+        }
+        if (!ok || !error.isEmpty()) {
+            printError(QString("invalid number of threads: %1\n%2").arg(parser.value(threads), error));
+            return false;
+        }
+    }
+
+    bool ok = false;
+    const int secs = parser.value(progress).toInt(&ok);
+    if (!ok || secs < 0) {
+        printError("invalid progress interval: " + parser.value(progress));
+        return false;
+    }
+    m_progressTimer.setInterval(secs * 1000);
+
+    bool okSteps = false, okMsecs = false;
+    const int qSteps = parser.value(quantumSteps).toInt(&okSteps);
+    const int qMsecs = parser.value(quantumMsecs).toInt(&okMsecs);
+    if (!okSteps || !okMsecs || qSteps < 0 || qMsecs < 0) {
+        printError(QString("invalid quantum: %1 steps, %2 msecs")
+                   .arg(parser.value(quantumSteps), parser.value(quantumMsecs)));
+        return false;
+    }
+    m_mainApp->expMgr()->setQuantum(qSteps, qMsecs);
+
+    const int mb = parser.value(memory).toInt(&ok);
+    if (!ok || mb < 0) {
+        printError("invalid memory budget: " + parser.value(memory));
+        return false;
+    }
+    m_mainApp->expMgr()->setMemoryBudget(mb);
+
+    const QString policy = parser.value(affinity);
+    if (policy != "none" && policy != "cores" && policy != "nodes") {
+        printError("invalid affinity: " + policy + "; expected none, cores or nodes");
+        return false;
+    }
+    m_mainApp->expMgr()->setAffinity(TrialScheduler::affinityFromString(policy));
+    m_control = parser.isSet(control);
+
+    if (parser.isSet(shard) && parser.isSet(merge)) {
+        printError("--shard and --merge cannot be used together.");
+        return false;
+    } else if (parser.isSet(shard)) {
+        const QStringList iN = parser.value(shard).split('/');
+        bool ok1 = false, ok2 = false;
+        if (iN.size() == 2) {
+            m_shard = iN.at(0).toInt(&ok1);
+            m_numShards = iN.at(1).toInt(&ok2);
+        }
+        if (!ok1 || !ok2 || m_numShards < 1 || m_shard < 0 || m_shard >= m_numShards) {
+            printError("invalid shard: " + parser.value(shard) + "; expected i/N with 0 <= i < N");
+            return false;
+        }
+    } else if (parser.isSet(merge)) {
+        m_mergeShards = parser.value(merge).toInt(&ok);
+        if (!ok || m_mergeShards < 1) {
+            printError("invalid number of shards: " + parser.value(merge));
+            return false;
+        }
+    }
+
+    const QFileInfo fileInfo(args.first());
+    const QString filePath = fileInfo.absoluteFilePath();
+    QString error;
+    m_project = m_mainApp->newProject(error);
+    if (!m_project) {
+        printError(error);
+        return false;
+    }
+    m_project->setFilePath(filePath);
+    const int numExps = m_project->importExperiments(filePath, error);
+    if (!error.isEmpty() || numExps < 1) {
+        printError(QString("unable to load the project %1\n%2").arg(filePath, error));
+        return false;
+    }
+    m_projectName = m_project->name();
+    m_projectDir = fileInfo.absolutePath();
+
+    if (parser.isSet(resume)) {
+        for (auto const& it : m_project->experiments()) {
+            it.second->setResumeFromCheckpoints(true);
+        }
+    }
+
+    if (m_shard < 0) {
+        for (auto const& it : m_project->experiments()) {
+            m_expIds.insert(it.first);
+        }
+    } else {
+        std::vector<std::pair<int, quint64>> costs;
+        for (auto const& it : m_project->experiments()) {
+            costs.emplace_back(it.first, estimatedCost(it.second.get()));
+        }
+        m_expIds = partition(costs, m_numShards).at(static_cast<size_t>(m_shard));
+        // The project name prefixes all output files; the tag makes them
+        // unique among shards. Note that the file path is not saved anywhere.
+        m_project->setFilePath(QString("%1/%2%3.csv").arg(m_projectDir, m_projectName,
+                                                          shardTag(m_shard, m_numShards)));
+        QFile::remove(doneFilePath(m_shard, m_numShards));
+    }
+
+    if (!isMerge()) {
+        m_out << QString("Loaded %1 experiments from %2; running %3 of them (%4 threads)\n")
+                 .arg(numExps).arg(filePath).arg(m_expIds.size())
+                 .arg(m_mainApp->expMgr()->maxThreadsCount());
+        if (m_mainApp->expMgr()->affinity() != TrialScheduler::Affinity::None) {
+            m_out << m_mainApp->expMgr()->placementReport();
+        }
+        m_out.flush();
+    }
+    return true;
+}
+
+quint64 BatchRunner::estimatedCost(const Experiment* exp) const
+{
+    if (exp->expStatus() == Status::Invalid) {
+        return 0; // it will fail straight away
+    }
+
+    quint64 numNodes = 1;
+    const QString cmd = exp->inputs()->general(GENERAL_ATTR_NODES).toQString();
+    if (QFileInfo::exists(cmd)) {
+        // one node per line, plus the header
+        QFile file(cmd);
+        if (file.open(QFile::ReadOnly)) {
+            numNodes = 0;
+            while (!file.atEnd()) {
+                file.readLine();
+                ++numNodes;
+            }
+            numNodes = std::max<quint64>(numNodes, 2) - 1;
+        }
+    } else {
+        QString error;
+        auto ag = AttrsGenerator::parse(exp->modelPlugin()->nodeAttrsScope(), cmd, error);
+        if (ag) {
+            numNodes = static_cast<quint64>(ag->size());
+        }
+    }
+
+    return numNodes * static_cast<quint64>(std::max(exp->stopAt(), 1))
+            * static_cast<quint64>(exp->numTrials());
+}
+
+void BatchRunner::start()
+{
+    m_elapsed.start();
+    m_pending = static_cast<int>(m_expIds.size());
+    if (m_pending == 0) {
+        m_out << "Nothing to run\n";
+        m_out.flush();
+        emit (finished(Success));
+        return;
+    }
+
+    for (int expId : m_expIds) {
+        ExperimentPtr exp = m_project->experiment(expId);
+        m_started.insert({exp->id(), false});
+
+        // let's initialize it here; otherwise, a failure would go unnoticed
+        QString error;
+        if (exp->expStatus() == Status::Invalid || !exp->reset(&error)) {
+            m_out << QString("E%1 is invalid: %2\n").arg(exp->id()).arg(error);
+            expDone(exp, false);
+            continue;
+        }
+        if (!exp->hasOutputs()) {
+            m_out << QString("E%1 has no file outputs\n").arg(exp->id());
+        }
+
+        // the status changes in the work threads; let's handle it in the main thread
+        connect(exp.get(), &Experiment::statusChanged, this,
+                [this, exp](Status s) { expStatusChanged(exp, s); }, Qt::QueuedConnection);
+        exp->play();
+    }
+    m_out.flush();
+
+    if (m_progressTimer.interval() > 0) {
+        m_progressTimer.start();
+    }
+
+    if (m_control) {
+#ifdef Q_OS_UNIX
+        m_controlNotifier = new QSocketNotifier(0, QSocketNotifier::Read, this); // stdin
+        connect(m_controlNotifier, SIGNAL(activated(int)), SLOT(readControl()));
+#else
+        printError("--control is only supported on Unix; ignoring it.");
+#endif
+    }
+}
+
+void BatchRunner::readControl()
+{
+#ifdef Q_OS_UNIX
+    // Reads straight from the file descriptor: a buffered stream (eg.,
+    // std::cin) could hold several lines, and the notifier would not fire
+    // again for them until more input arrives.
+    char buf[4096];
+    const ssize_t n = ::read(0, buf, sizeof(buf));
+    if (n > 0) {
+        m_controlBuffer.append(buf, static_cast<int>(n));
+    } else if (n < 0 && errno == EINTR) {
+        return; // the notifier fires again
+    } else {
+        m_controlNotifier->setEnabled(false); // stdin has been closed
+        m_controlBuffer.append('\n'); // the last line might not have an end
+    }
+
+    int end;
+    while ((end = m_controlBuffer.indexOf('\n')) >= 0) {
+        const QString line = QString::fromUtf8(m_controlBuffer.left(end));
+        m_controlBuffer.remove(0, end + 1);
+        runCommand(line);
+    }
+#endif
+}
+
+void BatchRunner::runCommand(const QString& line)
+{
+    const QStringList cmd = line.simplified().split(' ', QString::SkipEmptyParts);
+    if (cmd.isEmpty()) {
+        return;
+    }
+
+    ExperimentsMgr* expMgr = m_mainApp->expMgr();
+    bool ok1 = true, ok2 = true;
+    const int arg1 = cmd.size() > 1 ? cmd.at(1).toInt(&ok1) : 0;
+    const int arg2 = cmd.size() > 2 ? cmd.at(2).toInt(&ok2) : 0;
+    if (cmd.first() == "threads" && cmd.size() == 2 && ok1) {
+        QString error;
+        expMgr->setMaxThreadCount(arg1, &error);
+        if (!error.isEmpty()) {
+            printError(error);
+            return;
+        }
+        m_out << QString("threads: %1\n").arg(expMgr->maxThreadsCount());
+    } else if (cmd.first() == "quantum" && cmd.size() == 3 && ok1 && ok2) {
+        expMgr->setQuantum(arg1, arg2);
+        m_out << QString("quantum: %1 steps, %2 msecs\n")
+                 .arg(expMgr->quantumSteps()).arg(expMgr->quantumMsecs());
+    } else if (cmd.first() == "memory" && cmd.size() == 2 && ok1) {
+        expMgr->setMemoryBudget(arg1);
+        m_out << QString("memory: %1 MB\n").arg(expMgr->memoryBudget());
+    } else if (cmd.first() == "placement" && cmd.size() == 1) {
+        m_out << expMgr->placementReport();
+    } else if (cmd.first() == "status" && cmd.size() == 1) {
+        m_out << QString("threads: %1; quantum: %2 steps, %3 msecs; memory: %4 MB\n")
+                 .arg(expMgr->maxThreadsCount()).arg(expMgr->quantumSteps())
+                 .arg(expMgr->quantumMsecs()).arg(expMgr->memoryBudget());
+        printProgress();
+    } else {
+        printError("unknown command: " + line);
+        return;
+    }
+    m_out.flush();
+}
+
+void BatchRunner::expStatusChanged(const ExperimentPtr& exp, Status s)
+{
+    bool& started = m_started.at(exp->id());
+    if (s == Status::Queued || s == Status::Running) {
+        started = true;
+    } else if (s == Status::Invalid) {
+        expDone(exp, false);
+    } else if (started) {
+        // finished, or disabled after finishing (autoDelete)
+        expDone(exp, s == Status::Finished || s == Status::Disabled);
+    }
+}
+
+void BatchRunner::expDone(const ExperimentPtr& exp, bool ok)
+{
+    exp->disconnect(this);
+    m_started.erase(exp->id());
+
+    --m_pending;
+    if (!ok) {
+        ++m_failed;
+    }
+    m_out << QString("E%1 %2%3\n").arg(exp->id())
+             .arg(ok ? "finished" : "failed", cycleReport(exp.get()));
+
+    if (m_pending == 0) {
+        m_progressTimer.stop();
+        const int total = static_cast<int>(m_expIds.size());
+        m_out << QString("Done: %1 finished, %2 failed in %3s\n")
+                 .arg(total - m_failed).arg(m_failed).arg(m_elapsed.elapsed() / 1000.0, 0, 'f', 1);
+
+        // tell the merge step that this shard is complete
+        if (m_shard >= 0 && m_failed == 0) {
+            QFile done(doneFilePath(m_shard, m_numShards));
+            if (done.open(QFile::WriteOnly | QFile::Truncate)) {
+                QTextStream ids(&done);
+                for (int id : m_expIds) {
+                    ids << id << "\n";
+                }
+            } else {
+                printError("unable to write " + done.fileName());
+                ++m_failed;
+            }
+        }
+        emit (finished(m_failed > 0 ? Failed : Success));
+    }
+    m_out.flush();
+}
+
+int BatchRunner::merge()
+{
+    // all shards must be complete, and together they must cover the project
+    std::set<int> doneIds;
+    for (int i = 0; i < m_mergeShards; ++i) {
+        QFile done(doneFilePath(i, m_mergeShards));
+        if (!done.open(QFile::ReadOnly)) {
+            printError(QString("the shard %1/%2 is not complete: %3 is missing")
+                       .arg(i).arg(m_mergeShards).arg(done.fileName()));
+            return Failed;
+        }
+        while (!done.atEnd()) {
+            const QByteArray line = done.readLine().trimmed();
+            if (!line.isEmpty()) {
+                doneIds.insert(line.toInt());
+            }
+        }
+    }
+    for (auto const& it : m_project->experiments()) {
+        if (!doneIds.count(it.first)) {
+            printError(QString("the experiment %1 has not been run by any shard").arg(it.first));
+            return Failed;
+        }
+    }
+
+    std::set<QString> outDirs;
+    for (auto const& it : m_project->experiments()) {
+        const ExpInputs* inputs = it.second->inputs();
+        if (inputs && !inputs->fileCaches().empty()) {
+            outDirs.insert(QDir(inputs->general(OUTPUT_DIR).toQString()).absolutePath());
+        }
+    }
+
+    // <name>_shard<i>of<N>_<rest> -> <name>_<rest>
+    const QRegularExpression rx(QString("^%1_shard(\\d+)of%2_(.+)$")
+            .arg(QRegularExpression::escape(m_projectName)).arg(m_mergeShards));
+    int numFiles = 0;
+    for (const QString& dirPath : outDirs) {
+        QDir dir(dirPath);
+        QStringList sharedFiles; // written by all experiments of a shard
+        for (const QString& fileName : dir.entryList(QDir::Files, QDir::Name)) {
+            const QRegularExpressionMatch m = rx.match(fileName);
+            if (!m.hasMatch()) {
+                continue;
+            }
+            const QString rest = m.captured(2);
+            if (rest == "outputs.csv") {
+                sharedFiles << fileName;
+                continue;
+            }
+            const QString dest = QString("%1_%2").arg(m_projectName, rest);
+            dir.remove(dest);
+            if (!dir.rename(fileName, dest)) {
+                printError(QString("unable to rename %1 to %2").arg(dir.filePath(fileName), dest));
+                return Failed;
+            }
+            ++numFiles;
+        }
+
+        if (sharedFiles.isEmpty()) {
+            continue;
+        }
+
+        // the files of the 'project' mode are concatenated; same header
+        QFile dest(dir.filePath(m_projectName + "_outputs.csv"));
+        if (!dest.open(QFile::WriteOnly | QFile::Truncate)) {
+            printError("unable to write " + dest.fileName());
+            return Failed;
+        }
+        QByteArray header;
+        for (const QString& fileName : sharedFiles) {
+            QFile src(dir.filePath(fileName));
+            if (!src.open(QFile::ReadOnly)) {
+                printError("unable to read " + src.fileName());
+                return Failed;
+            }
+            const QByteArray srcHeader = src.readLine();
+            if (header.isEmpty()) {
+                header = srcHeader;
+                dest.write(header);
+            } else if (srcHeader != header) {
+                printError(QString("%1 and %2 have different headers").arg(sharedFiles.first(), fileName));
+                return Failed;
+            }
+            while (!src.atEnd()) {
+                dest.write(src.read(1 << 20));
+            }
+        }
+        dest.close();
+        for (const QString& fileName : sharedFiles) {
+            dir.remove(fileName);
+        }
+        numFiles += sharedFiles.size();
+    }
+
+    for (int i = 0; i < m_mergeShards; ++i) {
+        QFile::remove(doneFilePath(i, m_mergeShards));
+    }
+
+    m_out << QString("Merged %1 files of %2 shards\n").arg(numFiles).arg(m_mergeShards);
+    m_out.flush();
+    return Success;
+}
+
+void BatchRunner::printProgress()
+{
+    const int total = static_cast<int>(m_expIds.size());
+    QString line = QString("[%1s] %2/%3 done, %4 MB")
+            .arg(m_elapsed.elapsed() / 1000.0, 0, 'f', 1)
+            .arg(total - m_pending).arg(total)
+            .arg(m_mainApp->expMgr()->memoryInUse() >> 20);
+    for (int expId : m_expIds) {
+        const ExperimentPtr exp = m_project->experiment(expId);
+        if (exp->expStatus() == Status::Running) {
+            line += QString(" | E%1 %2% %3/%4 MB%5").arg(exp->id())
+                    .arg(exp->progress() * 100 / 360)
+                    .arg(exp->memoryUsage() >> 20)
+                    .arg((exp->trialFootprint() * static_cast<quint64>(exp->numTrials())) >> 20)
+                    .arg(cycleReport(exp.get()));
+        }
+    }
+    m_out << line << "\n";
+    m_out.flush();
+}
+
+QString BatchRunner::cycleReport(const Experiment* exp) const
+{
+    QStringList periods;
+    for (auto const& it : exp->cyclePeriods()) {
+        periods << QString("period %1 (%2 trials)").arg(it.first).arg(it.second);
+    }
+    return periods.isEmpty() ? QString() : "; cycles: " + periods.join(", ");
+}
+
+void BatchRunner::printError(const QString& msg)
+{
+    QTextStream err(stderr);
+    err << "Error: " << msg << "\n";
+}
+
+} // evoplex
@@ -0,0 +1,170 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a platform for agent-based modeling on networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTextStream>
+#include <QTimer>
+
+#include "core/mainapp.h"
+#include "core/project.h"
+
+namespace evoplex {
+
+/**
+ * @brief Runs all experiments of a project without GUI.
+ *
+ * It is meant for batch nodes (eg., clusters) without a display server:
+ * it loads the experiments of a project file, runs them all through the
+ * ExperimentsMgr and streams the progress to stdout.
+ *
+ * Usage: evoplex-cli [--threads n] [--progress secs] [--shard i/N] [--resume]
+ *                    [--quantum-steps k] [--quantum-msecs ms] [--memory mb]
+ *                    [--affinity none|cores|nodes] [--control] project.csv
+ *        evoplex-cli --merge N project.csv
+ *
+ * A large project can be split into N shards, each one run by a separate
+ * process (or host) with '--shard i/N', where 0 <= i < N. All processes
+ * compute the same partition: the experiments are balanced by their
+ * estimated cost (nodes * stopAt * trials) with the longest-processing-time
+ * rule, breaking ties by experiment id. The output files of each shard are
+ * tagged with '_shard<i>of<N>', and a shard which succeeds writes a
+ * '<project>_shard<i>of<N>.done' file next to the project file. Once all
+ * shards are done, '--merge N' stitches their outputs back together.
+ *
+ * If the experiments save checkpoints (OUTPUT_CHECKPOINT), a run which has
+ * been killed can be resumed with '--resume'; the trials carry on from
+ * their latest checkpoints.
+ *
+ * With '--quantum-steps' and/or '--quantum-msecs', the trials take turns on
+ * the threads (see ExperimentsMgr::setQuantum), so all trials of a sweep
+ * advance together instead of one batch after another.
+ *
+ * With '--memory', the trials are only initialized while their estimated
+ * footprint fits in the budget (see ExperimentsMgr::setMemoryBudget); the
+ * progress reports the memory in use per experiment against its estimate.
+ *
+ * With '--control', these settings can be changed while running by writing
+ * commands to stdin, one per line: 'threads n' (the pool grows at once and
+ * shrinks as the running trials finish or yield), 'quantum k ms', 'memory mb',
+ * 'placement' (see ExperimentsMgr::placementReport) and 'status'. It is only
+ * supported on Unix.
+ */
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum ExitCode {
+        Success = 0,     // all experiments finished
+        Failed = 1,      // at least one experiment failed
+        InvalidArgs = 2  // bad arguments or the project could not be loaded
+    };
+
+    // Parses the arguments, runs the project and returns the ExitCode.
+    // It must be called from the main thread of a QCoreApplication.
+    static int exec(MainApp* mainApp, const QStringList& arguments);
+
+    explicit BatchRunner(MainApp* mainApp, QObject* parent=nullptr);
+
+    // Splits the items into 'numShards' bins balanced by cost (LPT rule).
+    // 'costs' is a list of <id, cost>; it returns the ids in each shard.
+    static std::vector<std::set<int>> partition(
+            std::vector<std::pair<int, quint64>> costs, const int numShards);
+
+    // Parses the command line and loads the project.
+    // Returns false if it is not possible to run.
+    bool init(const QStringList& arguments);
+
+    // Plays all experiments (of the shard); finished() is emitted when all
+    // of them are done.
+    void start();
+
+    // Stitches the outputs of all shards together.
+    // Returns the ExitCode.
+    int merge();
+
+    inline bool isMerge() const { return m_mergeShards > 0; }
+
+signals:
+    void finished(int exitCode);
+
+private slots:
+    void printProgress();
+    // handles the commands of the control channel (stdin), ie, all the
+    // complete lines available
+    void readControl();
+
+private:
+    MainApp* m_mainApp;
+    ProjectPtr m_project;
+    QTextStream m_out;
+    QTimer m_progressTimer;
+    QElapsedTimer m_elapsed;
+
+    QString m_projectName; // the original name (without the shard tag)
+    QString m_projectDir;
+    int m_shard;       // index of this shard; -1 to run all experiments
+    int m_numShards;
+    int m_mergeShards; // number of shards to merge; 0 to run
+    std::set<int> m_expIds; // experiments to be run
+
+    std::map<int, bool> m_started; // <expId, true if it has been queued>
+    int m_pending;  // experiments not done yet
+    int m_failed;
+
+    bool m_control; // true if the commands are read from stdin
+    QSocketNotifier* m_controlNotifier;
+    QByteArray m_controlBuffer; // input read from stdin up to an incomplete line
+
+    // estimated cost of running the experiment: nodes * stopAt * trials
+    quint64 estimatedCost(const Experiment* exp) const;
+
+    // the trials which have stopped in a cycle, by period; empty if none
+    QString cycleReport(const Experiment* exp) const;
+
+    inline QString shardTag(int shard, int numShards) const
+    { return QString("_shard%1of%2").arg(shard).arg(numShards); }
+    inline QString doneFilePath(int shard, int numShards) const
+    { return QString("%1/%2%3.done").arg(m_projectDir, m_projectName, shardTag(shard, numShards)); }
+
+    // called in the main thread whenever the status of an experiment changes
+    void expStatusChanged(const ExperimentPtr& exp, Status s);
+    // an experiment is done (finished or failed)
+    void expDone(const ExperimentPtr& exp, bool ok);
+
+    void printError(const QString& msg);
+
+    // runs a command of the control channel; see readControl()
+    void runCommand(const QString& line);
+};
+
+} // evoplex
+#endif // BATCHRUNNER_H
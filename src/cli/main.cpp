@@ -0,0 +1,48 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a platform for agent-based modeling on networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCoreApplication>
+
+#include "config.h"
+#include "core/logger.h"
+#include "core/mainapp.h"
+#include "batchrunner.h"
+
+// A command-line only Evoplex; it does not depend on the GUI libraries.
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    // same as the GUI, so both share the settings and the imported plugins
+    QCoreApplication::setOrganizationName("Evoplex");
+    QCoreApplication::setOrganizationDomain("https://evoplex.org");
+    QCoreApplication::setApplicationName("Evoplex");
+    QCoreApplication::setApplicationVersion(EVOPLEX_VERSION_RELEASE);
+
+    evoplex::Logger::instance()->init();
+
+    int result;
+    {
+        evoplex::MainApp mainApp;
+        result = evoplex::BatchRunner::exec(&mainApp, app.arguments());
+    }
+
+    evoplex::Logger::instance()->destroy();
+    return result;
+}
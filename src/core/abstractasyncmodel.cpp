@@ -0,0 +1,81 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <numeric>
+
+#include "abstractasyncmodel.h"
+
+namespace evoplex {
+
+AbstractAsyncModel::AbstractAsyncModel()
+    : m_order(UpdateOrder::Shuffled),
+      m_updatesPerStep(0),
+      m_rebuild(true)
+{
+}
+
+void AbstractAsyncModel::beforeLoop()
+{
+    m_rebuild = true;
+}
+
+void AbstractAsyncModel::rebuild()
+{
+    m_nodes.clear();
+    m_nodes.reserve(nodes().size());
+    for (auto const& p : nodes()) {
+        m_nodes.emplace_back(p.second);
+    }
+    // the nodes are usually allocated in the order of their ids, so that
+    // it's friendlier to the cache than the order of the hash table
+    std::sort(m_nodes.begin(), m_nodes.end(),
+              [](const Node& a, const Node& b) { return a.id() < b.id(); });
+    m_rebuild = false;
+}
+
+bool AbstractAsyncModel::algorithmStep()
+{
+    if (m_rebuild || m_nodes.size() != nodes().size()) {
+        rebuild();
+    }
+    if (m_nodes.empty()) {
+        return true;
+    }
+
+    const quint32 numNodes = static_cast<quint32>(m_nodes.size());
+    if (m_order == UpdateOrder::Shuffled) {
+        // starting from the identity keeps the sequence independent of
+        // the previous steps (eg., when resuming from a checkpoint)
+        m_sequence.resize(numNodes);
+        std::iota(m_sequence.begin(), m_sequence.end(), 0);
+        prg()->shuffle(m_sequence.begin(), m_sequence.end());
+    } else {
+        const size_t n = m_updatesPerStep > 0 ? static_cast<size_t>(m_updatesPerStep) : numNodes;
+        m_sequence.resize(n);
+        for (quint32& i : m_sequence) {
+            i = prg()->index(numNodes);
+        }
+    }
+
+    for (const quint32 i : m_sequence) {
+        updateNode(m_nodes[i]);
+    }
+    return true;
+}
+
+} // evoplex
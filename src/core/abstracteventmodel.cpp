@@ -0,0 +1,119 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <QDataStream>
+
+#include "abstracteventmodel.h"
+
+namespace evoplex {
+
+AbstractEventModel::AbstractEventModel()
+    : m_time(0.0),
+      m_numEvents(0),
+      m_rebuild(true)
+{
+}
+
+void AbstractEventModel::beforeLoop()
+{
+    m_rebuild = true;
+}
+
+bool AbstractEventModel::saveState(QDataStream& out) const
+{
+    out << m_time << m_numEvents;
+    return out.status() == QDataStream::Ok;
+}
+
+bool AbstractEventModel::loadState(QDataStream& in)
+{
+    in >> m_time >> m_numEvents;
+    m_rebuild = true;
+    return in.status() == QDataStream::Ok;
+}
+
+void AbstractEventModel::rebuild()
+{
+    // starts tracking the changes (or discards the ones seen so far)
+    graph()->activeNodes();
+
+    int maxId = -1;
+    m_nodes.clear();
+    m_nodes.reserve(nodes().size());
+    for (auto const& p : nodes()) {
+        m_nodes.emplace_back(p.second);
+        maxId = std::max(maxId, p.first);
+    }
+
+    m_leaves.assign(static_cast<size_t>(maxId + 1), -1);
+    std::vector<double> rates;
+    rates.reserve(m_nodes.size());
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        m_leaves[static_cast<size_t>(m_nodes[i].id())] = static_cast<int>(i);
+        rates.emplace_back(rate(m_nodes[i]));
+    }
+    m_rates.assign(rates);
+    m_rebuild = false;
+}
+
+bool AbstractEventModel::algorithmStep()
+{
+    if (m_rebuild) {
+        rebuild();
+    }
+
+    // the step is always a point of the time grid; by the memorylessness
+    // of the exponential distribution, the event crossing it is discarded
+    const double until = (step() + 1) * timeStep();
+    m_time = step() * timeStep();
+
+    while (true) {
+        const double total = m_rates.total();
+        if (total <= 0.0) {
+            m_time = until;
+            return false; // nothing can happen anymore
+        }
+
+        const double dt = -std::log(1.0 - prg()->uniform()) / total;
+        if (m_time + dt > until) {
+            m_time = until;
+            return true;
+        }
+        m_time += dt;
+
+        const int leaf = m_rates.find(prg()->uniform() * total);
+        fire(m_nodes[static_cast<size_t>(leaf)]);
+        ++m_numEvents;
+
+        if (nodes().size() != m_nodes.size()) {
+            rebuild(); // the topology has changed
+            continue;
+        }
+        for (const Node& node : graph()->activeNodes()) {
+            const int id = node.id();
+            if (id >= static_cast<int>(m_leaves.size()) || m_leaves[static_cast<size_t>(id)] < 0) {
+                rebuild(); // a new node
+                break;
+            }
+            m_rates.update(m_leaves[static_cast<size_t>(id)], rate(node));
+        }
+    }
+}
+
+} // evoplex
@@ -14,22 +14,97 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <QDataStream>
+
 #include "abstractgraph.h"
 #include "constants.h"
 #include "edge_p.h"
 #include "graphplugin.h"
 #include "node_p.h"
+#include "parallel.h"
 #include "trial.h"
 #include "utils.h"
 
 namespace evoplex {
 
+namespace {
+// All nodes (or edges) of a graph have the same attributes, so the names are
+// written only once, followed by the values of each element.
+void writeAttrNames(QDataStream& out, const Attributes* attrs)
+{
+    if (!attrs) {
+        out << static_cast<quint16>(0);
+        return;
+    }
+    out << static_cast<quint16>(attrs->size());
+    for (const QString& name : attrs->names()) {
+        out << name;
+    }
+}
+
+std::vector<QString> readAttrNames(QDataStream& in)
+{
+    quint16 size;
+    in >> size;
+    std::vector<QString> names(size);
+    for (QString& name : names) {
+        in >> name;
+    }
+    return names;
+}
+
+void writeAttrValues(QDataStream& out, const Attributes& attrs)
+{
+    for (const Value& v : attrs.values()) {
+        out << v;
+    }
+}
+
+Attributes readAttrValues(QDataStream& in, const std::vector<QString>& names)
+{
+    Attributes attrs(static_cast<int>(names.size()));
+    for (size_t i = 0; i < names.size(); ++i) {
+        Value v;
+        in >> v;
+        attrs.replace(static_cast<int>(i), names[i], v);
+    }
+    return attrs;
+}
+
+// Reads a numeric Value as double; returns false if it's not numeric.
+inline bool toNumber(const Value& v, double& d)
+{
+    switch (v.type()) {
+    case Value::BOOL: d = v.toBool() ? 1.0 : 0.0; return true;
+    case Value::CHAR: d = v.toChar(); return true;
+    case Value::DOUBLE: d = v.toDouble(); return true;
+    case Value::INT: d = v.toInt(); return true;
+    default: return false;
+    }
+}
+} // namespace
+
 AbstractGraph::AbstractGraph()
     : m_graphType(GraphType::Invalid),
       m_prg(nullptr),
       m_lastNodeId(-1),
-      m_lastEdgeId(-1)
+      m_lastEdgeId(-1),
+      m_trackStateHash(false),
+      m_stateHash(0),
+      m_trackActivity(false),
+      m_allActive(true),
+      m_activeStamp(0),
+      m_topologyChanged(true)
+{
+}
+
+AbstractGraph::AbstractGraph(GraphType type)
+    : AbstractGraph()
 {
+    m_graphType = type;
 }
 
 bool AbstractGraph::setup(const QString& id, GraphType type, PRG& prg,
@@ -44,10 +119,471 @@ bool AbstractGraph::setup(const QString& id, GraphType type, PRG& prg,
     m_prg = &prg;
     m_numNodesDist = std::uniform_int_distribution<int>(0, numNodes()-1);
     m_lastNodeId = static_cast<int>(m_nodes.size());
+    m_topologyChanged = true;
     m_edgeAttrsGen = std::move(edgeGen);
     return AbstractPlugin::setup(attrs);
 }
 
+bool AbstractGraph::saveState(QDataStream& out) const
+{
+    out << static_cast<qint32>(m_lastNodeId) << static_cast<qint32>(m_lastEdgeId);
+
+    writeAttrNames(out, m_nodes.empty() ? nullptr : &m_nodes.cbegin()->second.attrs());
+    out << static_cast<quint32>(m_nodes.size());
+    for (auto const& p : m_nodes) {
+        const Node& node = p.second;
+        out << static_cast<qint32>(node.id()) << node.x() << node.y();
+        writeAttrValues(out, node.attrs());
+    }
+
+    writeAttrNames(out, m_edges.empty() ? nullptr : m_edges.cbegin()->second.attrs());
+    out << static_cast<quint32>(m_edges.size());
+    for (auto const& p : m_edges) {
+        const Edge& edge = p.second;
+        out << static_cast<qint32>(edge.id()) << static_cast<qint32>(edge.origin().id())
+            << static_cast<qint32>(edge.neighbour().id());
+        writeAttrValues(out, *edge.attrs());
+    }
+    return out.status() == QDataStream::Ok;
+}
+
+bool AbstractGraph::loadState(QDataStream& in)
+{
+    struct NodeState { qint32 id; float x; float y; Attributes attrs; };
+    struct EdgeState { qint32 id; qint32 origin; qint32 neighbour; Attributes attrs; };
+
+    qint32 lastNodeId, lastEdgeId;
+    in >> lastNodeId >> lastEdgeId;
+
+    const std::vector<QString> nodeAttrNames = readAttrNames(in);
+    quint32 size;
+    in >> size;
+    std::vector<NodeState> nodes;
+    nodes.reserve(size);
+    for (quint32 i = 0; i < size && in.status() == QDataStream::Ok; ++i) {
+        NodeState n;
+        in >> n.id >> n.x >> n.y;
+        n.attrs = readAttrValues(in, nodeAttrNames);
+        nodes.emplace_back(std::move(n));
+    }
+
+    const std::vector<QString> edgeAttrNames = readAttrNames(in);
+    in >> size;
+    std::vector<EdgeState> edges;
+    edges.reserve(size);
+    for (quint32 i = 0; i < size && in.status() == QDataStream::Ok; ++i) {
+        EdgeState e;
+        in >> e.id >> e.origin >> e.neighbour;
+        e.attrs = readAttrValues(in, edgeAttrNames);
+        edges.emplace_back(std::move(e));
+    }
+
+    if (in.status() != QDataStream::Ok || nodes.empty()) {
+        qWarning() << "the checkpoint has a corrupted graph.";
+        return false;
+    }
+
+    // Models might hold Node/Edge handles taken in init(). So, whenever the
+    // topology is the same, the current objects are updated in place.
+    bool sameNodes = nodes.size() == m_nodes.size();
+    for (size_t i = 0; sameNodes && i < nodes.size(); ++i) {
+        sameNodes = m_nodes.find(nodes[i].id) != m_nodes.end();
+    }
+    bool sameEdges = sameNodes && edges.size() == m_edges.size();
+    for (size_t i = 0; sameEdges && i < edges.size(); ++i) {
+        auto it = m_edges.find(edges[i].id);
+        sameEdges = it != m_edges.end() && it->second.origin().id() == edges[i].origin
+                && it->second.neighbour().id() == edges[i].neighbour;
+    }
+
+    if (!sameEdges) {
+        removeAllEdges();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (sameNodes) {
+        for (NodeState& n : nodes) {
+            BaseNode* node = m_nodes.at(n.id).m_ptr.get();
+            node->setCoords(n.x, n.y);
+            node->m_attrs = std::move(n.attrs);
+        }
+    } else {
+        m_nodes.clear();
+        BaseNode::constructor_key k;
+        for (const NodeState& n : nodes) {
+            Node node;
+            if (isDirected()) {
+                node.m_ptr = std::make_shared<DNode>(k, n.id, n.attrs, n.x, n.y);
+            } else {
+                node.m_ptr = std::make_shared<UNode>(k, n.id, n.attrs, n.x, n.y);
+            }
+            m_nodes.insert({n.id, node});
+        }
+    }
+
+    if (sameEdges) {
+        for (EdgeState& e : edges) {
+            *m_edges.at(e.id).m_ptr->m_attrs = std::move(e.attrs);
+        }
+    } else {
+        BaseEdge::constructor_key k;
+        for (EdgeState& e : edges) {
+            auto origin = m_nodes.find(e.origin);
+            auto neighbour = m_nodes.find(e.neighbour);
+            if (origin == m_nodes.end() || neighbour == m_nodes.end()) {
+                qWarning() << "the checkpoint has an edge linking non-existent nodes.";
+                return false;
+            }
+            Attributes* attrs = new Attributes(std::move(e.attrs));
+            Edge edgeOut, edgeIn;
+            edgeOut.m_ptr = std::make_shared<BaseEdge>(k, e.id, origin->second, neighbour->second, attrs, true);
+            edgeIn.m_ptr = std::make_shared<BaseEdge>(k, e.id, neighbour->second, origin->second, attrs, false);
+            origin->second.m_ptr->addOutEdge(edgeOut);
+            neighbour->second.m_ptr->addInEdge(edgeIn);
+            m_edges.insert({e.id, edgeOut});
+        }
+    }
+
+    m_lastNodeId = lastNodeId;
+    m_lastEdgeId = lastEdgeId;
+    m_topologyChanged = true;
+    m_numNodesDist = std::uniform_int_distribution<int>(0, numNodes()-1);
+    locker.unlock();
+
+    if (m_trackStateHash) {
+        trackStateHash(true); // the attributes have been replaced
+    }
+    if (m_trackActivity) {
+        m_changedNodes.clear();
+        for (auto const& p : m_nodes) {
+            p.second.m_ptr->m_changedNodes = &m_changedNodes;
+            p.second.m_ptr->m_changed = false;
+        }
+        m_allActive = true;
+    }
+    return true;
+}
+
+void AbstractGraph::trackStateHash(bool enable)
+{
+    QMutexLocker locker(&m_mutex);
+    m_trackStateHash = enable;
+    m_stateHash = 0;
+    for (auto const& p : m_nodes) {
+        BaseNode* node = p.second.m_ptr.get();
+        node->m_stateHash = enable ? &m_stateHash : nullptr;
+        if (enable) {
+            m_stateHash ^= node->stateKeys();
+        }
+    }
+}
+
+void AbstractGraph::touch(BaseNode* node)
+{
+    if (m_trackActivity && !node->m_changed) {
+        node->m_changed = true;
+        m_changedNodes.emplace_back(node->id());
+    }
+}
+
+const std::vector<Node>& AbstractGraph::activeNodes()
+{
+    QMutexLocker locker(&m_mutex);
+    m_activeNodes.clear();
+
+    if (!m_trackActivity || m_allActive) {
+        m_activeNodes.reserve(m_nodes.size());
+        for (auto const& p : m_nodes) {
+            BaseNode* node = p.second.m_ptr.get();
+            node->m_changedNodes = &m_changedNodes;
+            node->m_changed = false;
+            m_activeNodes.emplace_back(p.second);
+        }
+        m_changedNodes.clear();
+        m_trackActivity = true;
+        m_allActive = false;
+        return m_activeNodes;
+    }
+
+    ++m_activeStamp;
+    auto take = [this](const Node& node) {
+        if (node.m_ptr->m_activeStamp != m_activeStamp) {
+            node.m_ptr->m_activeStamp = m_activeStamp;
+            m_activeNodes.emplace_back(node);
+        }
+    };
+
+    for (int id : m_changedNodes) {
+        auto it = m_nodes.find(id);
+        if (it == m_nodes.end()) {
+            continue; // it has been removed
+        }
+        const Node& node = it->second;
+        node.m_ptr->m_changed = false;
+        take(node);
+        // for undirected nodes, the in- and out-edges are the same
+        for (auto const& e : node.inEdges()) {
+            take(e.second.neighbour());
+        }
+        if (isDirected()) {
+            for (auto const& e : node.outEdges()) {
+                take(e.second.neighbour());
+            }
+        }
+    }
+    m_changedNodes.clear();
+    return m_activeNodes;
+}
+
+void AbstractGraph::updateTopology()
+{
+    if (!m_topologyChanged) {
+        return;
+    }
+
+    m_csrNodes.clear();
+    m_csrNodes.reserve(m_nodes.size());
+    for (auto const& p : m_nodes) {
+        m_csrNodes.emplace_back(p.second);
+    }
+    std::sort(m_csrNodes.begin(), m_csrNodes.end(),
+              [](const Node& a, const Node& b) { return a.id() < b.id(); });
+
+    m_csrIds.resize(m_csrNodes.size());
+    std::vector<int> rows(m_csrNodes.empty() ? 0 : static_cast<size_t>(m_csrNodes.back().id() + 1), -1);
+    for (size_t r = 0; r < m_csrNodes.size(); ++r) {
+        m_csrIds[r] = m_csrNodes[r].id();
+        rows[static_cast<size_t>(m_csrIds[r])] = static_cast<int>(r);
+    }
+
+    m_csrOffsets.assign(1, 0);
+    m_csrOffsets.reserve(m_csrNodes.size() + 1);
+    m_csrNeighbours.clear();
+    m_csrEdgeAttrs.clear();
+    for (const Node& node : m_csrNodes) {
+        for (auto const& e : node.outEdges()) {
+            m_csrNeighbours.emplace_back(rows[static_cast<size_t>(e.second.neighbour().id())]);
+            m_csrEdgeAttrs.emplace_back(e.second.attrs());
+        }
+        m_csrOffsets.emplace_back(static_cast<int>(m_csrNeighbours.size()));
+    }
+    m_adjacency.clear();
+    m_topologyChanged = false;
+}
+
+bool AbstractGraph::gatherColumn(int attrId, bool edges, std::vector<double>& column, int threads) const
+{
+    const int size = static_cast<int>(edges ? m_csrEdgeAttrs.size() : m_csrNodes.size());
+    column.resize(static_cast<size_t>(size));
+    if (size == 0) {
+        return true;
+    }
+
+    const int numAttrs = edges ? (m_csrEdgeAttrs.front() ? m_csrEdgeAttrs.front()->size() : 0)
+                               : m_csrNodes.front().attrs().size();
+    if (attrId < 0 || attrId >= numAttrs) {
+        qWarning() << "invalid attribute id:" << attrId;
+        return false;
+    }
+
+    std::atomic<bool> ok(true);
+    parallelFor(size, threads, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            const Value& v = edges ? m_csrEdgeAttrs[static_cast<size_t>(i)]->value(attrId)
+                                   : m_csrNodes[static_cast<size_t>(i)].attr(attrId);
+            if (!toNumber(v, column[static_cast<size_t>(i)])) {
+                ok = false;
+                return;
+            }
+        }
+    });
+
+    if (!ok) {
+        qWarning() << "the attribute" << attrId << "must be numeric.";
+    }
+    return ok;
+}
+
+bool AbstractGraph::sumNeighbours(int attrId, std::vector<double>& out,
+                                  int weightAttrId, int threads)
+{
+    updateTopology();
+    std::vector<double> x, w;
+    if (!gatherColumn(attrId, false, x, threads)
+            || (weightAttrId >= 0 && !gatherColumn(weightAttrId, true, w, threads))) {
+        return false;
+    }
+
+    out.assign(m_csrIds.empty() ? 0 : static_cast<size_t>(m_csrIds.back() + 1), 0.0);
+    const int* offsets = m_csrOffsets.data();
+    const int* nb = m_csrNeighbours.data();
+    const double* xs = x.data();
+    const double* ws = w.empty() ? nullptr : w.data();
+    parallelFor(static_cast<int>(m_csrIds.size()), threads, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            double sum = 0.0;
+            if (ws) {
+                for (int k = offsets[r]; k < offsets[r+1]; ++k) {
+                    sum += ws[k] * xs[nb[k]];
+                }
+            } else {
+                for (int k = offsets[r]; k < offsets[r+1]; ++k) {
+                    sum += xs[nb[k]];
+                }
+            }
+            out[static_cast<size_t>(m_csrIds[static_cast<size_t>(r)])] = sum;
+        }
+    });
+    return true;
+}
+
+bool AbstractGraph::countNeighbours(int attrId, const Value& value,
+                                    std::vector<int>& out, int threads)
+{
+    updateTopology();
+    if (!m_csrNodes.empty() && (attrId < 0 || attrId >= m_csrNodes.front().attrs().size())) {
+        qWarning() << "invalid attribute id:" << attrId;
+        return false;
+    }
+
+    // the comparison is done once per node
+    std::vector<int> equal(m_csrNodes.size());
+    parallelFor(static_cast<int>(m_csrNodes.size()), threads, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            equal[static_cast<size_t>(r)] = m_csrNodes[static_cast<size_t>(r)].attr(attrId) == value ? 1 : 0;
+        }
+    });
+
+    out.assign(m_csrIds.empty() ? 0 : static_cast<size_t>(m_csrIds.back() + 1), 0);
+    const int* offsets = m_csrOffsets.data();
+    const int* nb = m_csrNeighbours.data();
+    const int* eq = equal.data();
+    parallelFor(static_cast<int>(m_csrIds.size()), threads, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            int count = 0;
+            for (int k = offsets[r]; k < offsets[r+1]; ++k) {
+                count += eq[nb[k]];
+            }
+            out[static_cast<size_t>(m_csrIds[static_cast<size_t>(r)])] = count;
+        }
+    });
+    return true;
+}
+
+bool AbstractGraph::maxNeighbours(int attrId, std::vector<double>& out,
+                                  int weightAttrId, int threads)
+{
+    updateTopology();
+    std::vector<double> x, w;
+    if (!gatherColumn(attrId, false, x, threads)
+            || (weightAttrId >= 0 && !gatherColumn(weightAttrId, true, w, threads))) {
+        return false;
+    }
+
+    const double lowest = -std::numeric_limits<double>::infinity();
+    out.assign(m_csrIds.empty() ? 0 : static_cast<size_t>(m_csrIds.back() + 1), lowest);
+    const int* offsets = m_csrOffsets.data();
+    const int* nb = m_csrNeighbours.data();
+    const double* xs = x.data();
+    const double* ws = w.empty() ? nullptr : w.data();
+    parallelFor(static_cast<int>(m_csrIds.size()), threads, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            double max = lowest;
+            if (ws) {
+                for (int k = offsets[r]; k < offsets[r+1]; ++k) {
+                    max = std::max(max, ws[k] * xs[nb[k]]);
+                }
+            } else {
+                for (int k = offsets[r]; k < offsets[r+1]; ++k) {
+                    max = std::max(max, xs[nb[k]]);
+                }
+            }
+            out[static_cast<size_t>(m_csrIds[static_cast<size_t>(r)])] = max;
+        }
+    });
+    return true;
+}
+
+bool AbstractGraph::argmaxNeighbours(int attrId, std::vector<int>& out,
+                                     int weightAttrId, int threads)
+{
+    updateTopology();
+    std::vector<double> x, w;
+    if (!gatherColumn(attrId, false, x, threads)
+            || (weightAttrId >= 0 && !gatherColumn(weightAttrId, true, w, threads))) {
+        return false;
+    }
+
+    out.assign(m_csrIds.empty() ? 0 : static_cast<size_t>(m_csrIds.back() + 1), -1);
+    const int* offsets = m_csrOffsets.data();
+    const int* nb = m_csrNeighbours.data();
+    const double* xs = x.data();
+    const double* ws = w.empty() ? nullptr : w.data();
+    parallelFor(static_cast<int>(m_csrIds.size()), threads, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            int best = -1;
+            double max = 0.0;
+            for (int k = offsets[r]; k < offsets[r+1]; ++k) {
+                const double v = ws ? ws[k] * xs[nb[k]] : xs[nb[k]];
+                if (best < 0 || v > max) {
+                    best = k;
+                    max = v;
+                }
+            }
+            out[static_cast<size_t>(m_csrIds[static_cast<size_t>(r)])] =
+                    best < 0 ? -1 : m_csrIds[static_cast<size_t>(nb[best])];
+        }
+    });
+    return true;
+}
+
+const SparseMatrix* AbstractGraph::adjacency(int weightAttrId, bool transposed)
+{
+    updateTopology();
+    weightAttrId = weightAttrId < 0 ? -1 : weightAttrId;
+    const auto key = std::make_pair(weightAttrId, transposed);
+    auto it = m_adjacency.find(key);
+    if (it != m_adjacency.end()) {
+        return &it->second;
+    }
+
+    if (transposed) {
+        const SparseMatrix* matrix = adjacency(weightAttrId, false);
+        if (!matrix) {
+            return nullptr;
+        }
+        return &m_adjacency.emplace(key, matrix->transposed()).first->second;
+    }
+
+    std::vector<double> values;
+    if (weightAttrId < 0) {
+        values.assign(m_csrNeighbours.size(), 1.0);
+    } else if (!gatherColumn(weightAttrId, true, values, 1)) {
+        return nullptr;
+    }
+
+    // the rows are the node ids, so the missing ids are empty rows
+    const int size = m_csrIds.empty() ? 0 : m_csrIds.back() + 1;
+    std::vector<int> offsets;
+    offsets.reserve(static_cast<size_t>(size) + 1);
+    offsets.emplace_back(0);
+    for (size_t r = 0; r < m_csrIds.size(); ++r) {
+        while (static_cast<int>(offsets.size()) <= m_csrIds[r]) {
+            offsets.emplace_back(m_csrOffsets[r]); // gaps
+        }
+        offsets.emplace_back(m_csrOffsets[r+1]);
+    }
+
+    std::vector<int> columns;
+    columns.reserve(m_csrNeighbours.size());
+    for (int row : m_csrNeighbours) {
+        columns.emplace_back(m_csrIds[static_cast<size_t>(row)]);
+    }
+
+    SparseMatrix matrix(size, std::move(offsets), std::move(columns), std::move(values));
+    return &m_adjacency.emplace(key, std::move(matrix)).first->second;
+}
+
 Node AbstractGraph::randNode() const
 {
     if (m_nodes.empty()) {
@@ -68,7 +604,16 @@ Node AbstractGraph::addNode(Attributes attr, float x, float y)
         node.m_ptr = std::make_shared<UNode>(k, m_lastNodeId, attr, x, y);
     }
     m_nodes.insert({m_lastNodeId, node});
+    m_topologyChanged = true;
     m_numNodesDist = std::uniform_int_distribution<int>(0, numNodes()-1);
+    if (m_trackStateHash) {
+        node.m_ptr->m_stateHash = &m_stateHash;
+        m_stateHash ^= node.m_ptr->stateKeys();
+    }
+    if (m_trackActivity) {
+        node.m_ptr->m_changedNodes = &m_changedNodes;
+        touch(node.m_ptr.get());
+    }
     return node;
 }
 
@@ -83,6 +628,9 @@ Edge AbstractGraph::addEdge(const Node& origin, const Node& neighbour, Attribute
     origin.m_ptr->addOutEdge(edgeOut);
     neighbour.m_ptr->addInEdge(edgeIn); // neighbour must be aware of the in-connection
     m_edges.insert({m_lastEdgeId, edgeOut}); // store only the original direction
+    m_topologyChanged = true;
+    touch(origin.m_ptr.get());
+    touch(neighbour.m_ptr.get());
     return edgeOut;
 }
 
@@ -94,23 +642,30 @@ void AbstractGraph::removeAllEdges()
         p.second.m_ptr->clearOutEdges();
     }
     m_edges.clear();
+    m_allActive = true;
+    m_topologyChanged = true;
 }
 
 void AbstractGraph::removeAllEdges(const Node& node)
 {
     QMutexLocker locker(&m_mutex);
+    m_topologyChanged = true;
+    touch(node.m_ptr.get());
     if (isUndirected()) {
         for (auto const& p : node.outEdges()) {
+            touch(p.second.neighbour().m_ptr.get());
             p.second.neighbour().m_ptr->removeInEdge(p.first);
             m_edges.erase(p.first);
         }
         node.m_ptr->clearOutEdges();
     } else if (isDirected()) {
         for (auto const& p : node.outEdges()) {
+            touch(p.second.neighbour().m_ptr.get());
             p.second.neighbour().m_ptr->removeInEdge(p.first);
             m_edges.erase(p.first);
         }
         for (auto const& p : node.inEdges()) {
+            touch(p.second.neighbour().m_ptr.get());
             p.second.neighbour().m_ptr->removeOutEdge(p.first);
             m_edges.erase(p.first);
         }
@@ -125,6 +680,10 @@ void AbstractGraph::removeNode(const Node& node)
 {
     removeAllEdges(node);
     QMutexLocker locker(&m_mutex);
+    if (m_trackStateHash) {
+        m_stateHash ^= node.m_ptr->stateKeys();
+        node.m_ptr->m_stateHash = nullptr;
+    }
     m_nodes.erase(node.id());
     int sz = m_nodes.empty() ? 0 : numNodes()-1;
     m_numNodesDist = std::uniform_int_distribution<int>(0, sz);
@@ -134,6 +693,10 @@ Nodes::iterator AbstractGraph::removeNode(Nodes::iterator it)
 {
     removeAllEdges(it->second);
     QMutexLocker locker(&m_mutex);
+    if (m_trackStateHash) {
+        m_stateHash ^= it->second.m_ptr->stateKeys();
+        it->second.m_ptr->m_stateHash = nullptr;
+    }
     it = m_nodes.erase(it);
     int sz = m_nodes.empty() ? 0 : numNodes()-1;
     m_numNodesDist = std::uniform_int_distribution<int>(0, sz);
@@ -143,6 +706,9 @@ Nodes::iterator AbstractGraph::removeNode(Nodes::iterator it)
 void AbstractGraph::removeEdge(const Edge& edge)
 {
     QMutexLocker locker(&m_mutex);
+    m_topologyChanged = true;
+    touch(edge.origin().m_ptr.get());
+    touch(edge.neighbour().m_ptr.get());
     edge.origin().m_ptr->removeOutEdge(edge.id());
     edge.neighbour().m_ptr->removeInEdge(edge.id());
     m_edges.erase(edge.id());
@@ -152,6 +718,9 @@ Edges::iterator AbstractGraph::removeEdge(Edges::iterator it)
 {
     QMutexLocker locker(&m_mutex);
     const Edge& edge = it->second;
+    m_topologyChanged = true;
+    touch(edge.origin().m_ptr.get());
+    touch(edge.neighbour().m_ptr.get());
     edge.origin().m_ptr->removeOutEdge(edge.id());
     edge.neighbour().m_ptr->removeInEdge(edge.id());
     return m_edges.erase(it);
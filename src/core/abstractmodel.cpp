@@ -40,4 +40,21 @@ int AbstractModel::step() const
 int AbstractModel::lastStep() const
 { return m_trial->stopAt(); }
 
+bool AbstractModel::algorithmSteps(int n, int& steps)
+{
+    // step() must be the current step in each algorithmStep(), as if they
+    // were called one by one; the trial moves on after the batch
+    const int first = m_trial->m_step;
+    bool hasNext = true;
+    for (steps = 0; steps < n && hasNext; ++steps) {
+        m_trial->m_step = first + steps;
+        hasNext = algorithmStep();
+    }
+    m_trial->m_step = first;
+    return hasNext;
+}
+
+double AbstractModel::timeStep() const
+{ return m_trial->timeStep(); }
+
 } // evoplex
@@ -0,0 +1,116 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include "checkpointwriter.h"
+
+namespace evoplex
+{
+
+const quint32 CheckpointWriter::kMagic = 0x45564350; // "EVCP"
+const quint16 CheckpointWriter::kVersion = 1;
+
+QByteArray CheckpointWriter::read(const QString& filePath, QString& error)
+{
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly)) {
+        error = "unable to read the checkpoint " + filePath;
+        return QByteArray();
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_8);
+    quint32 magic;
+    quint16 version;
+    QByteArray compressed;
+    in >> magic >> version >> compressed;
+    if (in.status() != QDataStream::Ok || magic != kMagic) {
+        error = filePath + " is not a valid checkpoint.";
+        return QByteArray();
+    }
+    if (version != kVersion) {
+        error = QString("%1 has an unsupported format (version %2).").arg(filePath).arg(version);
+        return QByteArray();
+    }
+
+    QByteArray state = qUncompress(compressed);
+    if (state.isEmpty()) {
+        error = filePath + " is corrupted.";
+    }
+    return state;
+}
+
+CheckpointWriter::CheckpointWriter()
+    : m_scheduled(false),
+      m_failures(0)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    waitForDone();
+}
+
+void CheckpointWriter::write(const QString& filePath, QByteArray state)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pending[filePath] = std::move(state);
+    if (!m_scheduled) {
+        m_scheduled = true;
+        QtConcurrent::run(&m_pool, [this]() { writePending(); });
+    }
+}
+
+void CheckpointWriter::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+void CheckpointWriter::writePending()
+{
+    while (true) {
+        QMutexLocker locker(&m_mutex);
+        if (m_pending.empty()) {
+            m_scheduled = false;
+            return;
+        }
+        const QString filePath = m_pending.begin()->first;
+        const QByteArray state = std::move(m_pending.begin()->second);
+        m_pending.erase(m_pending.begin());
+        locker.unlock();
+
+        // the previous checkpoint is replaced only if the new one is complete
+        QSaveFile file(filePath);
+        if (file.open(QFile::WriteOnly)) {
+            QDataStream out(&file);
+            out.setVersion(QDataStream::Qt_5_8);
+            out << kMagic << kVersion << qCompress(state, 1);
+            if (out.status() == QDataStream::Ok && file.commit()) {
+                continue;
+            }
+        }
+        qWarning() << "unable to write the checkpoint" << filePath;
+        ++m_failures;
+    }
+}
+
+} // evoplex
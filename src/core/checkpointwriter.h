@@ -0,0 +1,82 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHECKPOINTWRITER_H
+#define CHECKPOINTWRITER_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+
+namespace evoplex
+{
+
+class CheckpointWriter;
+using CheckpointWriterPtr = std::shared_ptr<CheckpointWriter>;
+
+/**
+ * @brief Writes the checkpoints of the trials to disk in the background.
+ *
+ * A trial serializes its state into memory, which is fast, and hands it
+ * over to the writer. The writer compresses it and replaces the checkpoint
+ * file atomically in its own thread, so a trial is paused only while its
+ * state is copied. If a trial hands over a new checkpoint before the
+ * previous one has been written, the old one is dropped.
+ *
+ * File format: magic number, format version and the zlib-compressed state.
+ */
+class CheckpointWriter
+{
+public:
+    static const quint32 kMagic;
+    static const quint16 kVersion;
+
+    // Reads the state stored in a checkpoint file.
+    // Returns an empty array and fills 'error' if it fails.
+    static QByteArray read(const QString& filePath, QString& error);
+
+    explicit CheckpointWriter();
+    // Waits for the pending checkpoints.
+    ~CheckpointWriter();
+
+    // Schedules 'state' to be written to 'filePath'. It never blocks.
+    // This method IS thread-safe.
+    void write(const QString& filePath, QByteArray state);
+
+    // Blocks until all pending checkpoints are written.
+    void waitForDone();
+
+    // Number of checkpoints which could not be written.
+    inline int failures() const { return m_failures; }
+
+private:
+    QMutex m_mutex;
+    std::map<QString, QByteArray> m_pending; // <filePath, state>
+    bool m_scheduled; // true if the thread is (or will be) writing the pending ones
+    QThreadPool m_pool; // a single thread, away from the trials' pool
+    std::atomic<int> m_failures;
+
+    // writes the pending checkpoints until there is nothing left
+    void writePending();
+};
+
+} // evoplex
+#endif // CHECKPOINTWRITER_H
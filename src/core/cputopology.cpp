@@ -0,0 +1,148 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <QDir>
+#include <QFile>
+#include <QRegularExpression>
+#include <QThread>
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "cputopology.h"
+
+namespace evoplex
+{
+
+static thread_local int t_currentNode = -1;
+
+CpuTopology::CpuTopology()
+    : m_numCpus(0)
+{
+#ifdef Q_OS_LINUX
+    const QDir dir("/sys/devices/system/node");
+    const QRegularExpression rx("^node(\\d+)$");
+    for (const QString& entry : dir.entryList(QDir::Dirs)) {
+        const QRegularExpressionMatch m = rx.match(entry);
+        if (!m.hasMatch()) {
+            continue;
+        }
+        QFile file(dir.filePath(entry + "/cpulist"));
+        if (!file.open(QFile::ReadOnly)) {
+            continue;
+        }
+        const size_t node = m.captured(1).toUInt();
+        if (m_cpus.size() <= node) {
+            m_cpus.resize(node + 1);
+        }
+        m_cpus[node] = parseCpuList(QString::fromLatin1(file.readAll()).trimmed());
+    }
+    // memory-only nodes have no cpus
+    m_cpus.erase(std::remove_if(m_cpus.begin(), m_cpus.end(),
+            [](const std::vector<int>& cpus) { return cpus.empty(); }), m_cpus.end());
+#endif
+
+    if (m_cpus.empty()) {
+        std::vector<int> all(static_cast<size_t>(QThread::idealThreadCount()));
+        for (size_t i = 0; i < all.size(); ++i) {
+            all[i] = static_cast<int>(i);
+        }
+        m_cpus.emplace_back(all);
+    }
+
+    for (const auto& cpus : m_cpus) {
+        m_numCpus += static_cast<int>(cpus.size());
+    }
+}
+
+const CpuTopology& CpuTopology::instance()
+{
+    static const CpuTopology topology;
+    return topology;
+}
+
+std::vector<int> CpuTopology::parseCpuList(const QString& list)
+{
+    std::vector<int> cpus;
+    for (const QString& range : list.split(',', QString::SkipEmptyParts)) {
+        const QStringList ends = range.split('-');
+        bool ok1 = false, ok2 = true;
+        const int first = ends.at(0).trimmed().toInt(&ok1);
+        const int last = ends.size() == 2 ? ends.at(1).trimmed().toInt(&ok2) : first;
+        if (!ok1 || !ok2 || ends.size() > 2 || first < 0 || last < first) {
+            return std::vector<int>();
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.emplace_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+int CpuTopology::nodeOf(int cpu) const
+{
+    for (size_t node = 0; node < m_cpus.size(); ++node) {
+        if (std::binary_search(m_cpus[node].begin(), m_cpus[node].end(), cpu)) {
+            return static_cast<int>(node);
+        }
+    }
+    return -1;
+}
+
+bool CpuTopology::pinCurrentThread(const std::vector<int>& cpus)
+{
+#ifdef Q_OS_LINUX
+    if (cpus.empty()) {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) {
+        return false;
+    }
+
+    // the node of the thread, if all cpus are in the same one
+    const CpuTopology& topology = instance();
+    int node = topology.nodeOf(cpus.front());
+    for (int cpu : cpus) {
+        if (topology.nodeOf(cpu) != node) {
+            node = -1;
+            break;
+        }
+    }
+    t_currentNode = node;
+    return true;
+#else
+    Q_UNUSED(cpus);
+    return false;
+#endif
+}
+
+int CpuTopology::currentNode()
+{
+    return t_currentNode;
+}
+
+} // evoplex
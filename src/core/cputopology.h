@@ -0,0 +1,65 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPUTOPOLOGY_H
+#define CPUTOPOLOGY_H
+
+#include <vector>
+#include <QString>
+
+namespace evoplex
+{
+
+/**
+ * @brief The NUMA nodes of the machine and their CPUs.
+ *
+ * On Linux, it is read from '/sys/devices/system/node'. Elsewhere (or if
+ * it is not available), the machine is seen as a single node with
+ * QThread::idealThreadCount() CPUs.
+ */
+class CpuTopology
+{
+public:
+    // the topology of this machine; it's read only once
+    static const CpuTopology& instance();
+
+    // Parses a Linux cpu list, eg, "0-3,8,10-11".
+    // Returns an empty vector if it is malformed.
+    static std::vector<int> parseCpuList(const QString& list);
+
+    // Pins the calling thread to the given CPUs.
+    // Returns false if it is not supported or if it fails.
+    static bool pinCurrentThread(const std::vector<int>& cpus);
+
+    // the NUMA node of the calling thread if it has been pinned to a
+    // single node by pinCurrentThread(); -1 otherwise
+    static int currentNode();
+
+    inline int numNodes() const { return static_cast<int>(m_cpus.size()); }
+    inline int numCpus() const { return m_numCpus; }
+    inline const std::vector<int>& cpus(int node) const { return m_cpus.at(static_cast<size_t>(node)); }
+    // -1 if the cpu is unknown
+    int nodeOf(int cpu) const;
+
+private:
+    std::vector<std::vector<int>> m_cpus; // cpus of each node
+    int m_numCpus;
+
+    CpuTopology();
+};
+
+} // evoplex
+#endif // CPUTOPOLOGY_H
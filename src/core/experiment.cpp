@@ -15,6 +15,8 @@
  */
 
 #include <QDebug>
+#include <QFile>
+#include <QFileInfo>
 
 #include "experiment.h"
 #include "nodes.h"
@@ -34,10 +36,20 @@ Experiment::Experiment(MainApp* mainApp, const int id, ProjectWPtr project)
       m_numTrials(0),
       m_autoDeleteTrials(true),
       m_stopAt(-1),
+      m_fileHasStepColumn(false),
+      m_fileMode(OutputFile::Mode::Trial),
+      m_resumeFromCheckpoints(false),
+      m_checkpointInterval(0),
       m_pauseAt(-1),
       m_progress(0),
       m_delay(0),
-      m_expStatus(Status::Invalid)
+      m_expStatus(Status::Invalid),
+      m_pendingTrials(0),
+      m_trialsToInit(0),
+      m_initFailed(false),
+      m_trialFootprint(0),
+      m_footprintMeasured(false),
+      m_memoryUsage(0)
 {
     Q_ASSERT_X(project.lock(), "Experiment", "an experiment must belong to a valid project");
 }
@@ -67,6 +79,7 @@ void Experiment::deleteTrials()
     }
     m_trials.clear();
     m_clonableNodes.clear();
+    m_mainApp->expMgr()->releaseMemory(this, m_memoryUsage.exchange(0));
 }
 
 bool Experiment::setInputs(ExpInputsPtr inputs, QString& error)
@@ -132,6 +145,18 @@ bool Experiment::disable(QString* error)
     m_outputs.clear();
     m_filePathPrefix.clear();
     m_fileHeader.clear();
+    m_fileHasStepColumn = false;
+    m_outputFile.reset();
+    m_outputBudget.reset();
+    if (m_aggregator) {
+        // the trials which have not finished are aborted
+        m_aggregator->allTrialsFinished();
+        m_aggregator.reset();
+    }
+    m_checkpointWriter.reset(); // waits for the pending checkpoints
+    m_checkpointPrefix.clear();
+    m_trialFootprint = 0;
+    m_footprintMeasured = false;
     m_expStatus = Status::Disabled;
     setProgress(0);
     return true;
@@ -150,6 +175,22 @@ bool Experiment::reset(QString* error)
                   "Please, pause it and try again.";
     } else if (m_expStatus == Status::Disabled) {
         enable(erroMsg);
+        if (erroMsg.isEmpty()) {
+            enableCheckpoints();
+        }
+    } else {
+        // the rows of the previous run are discarded
+        if (m_fileMode == OutputFile::Mode::Experiment && m_outputFile) {
+            m_outputFile->truncate(erroMsg);
+        } else if (m_fileMode == OutputFile::Mode::Project && m_outputFile) {
+            if (ProjectPtr project = m_project.lock()) {
+                m_outputFile = project->outputFile(m_outputFile->filePath(),
+                                                   m_outputFile->header(), m_id, erroMsg);
+            }
+        }
+        if (m_aggregator) {
+            m_aggregator->restart(erroMsg);
+        }
     }
 
     if (!m_inputs || !erroMsg.isEmpty()) {
@@ -166,11 +207,33 @@ bool Experiment::reset(QString* error)
     }
 
     deleteTrials();
+    {
+        QMutexLocker cyclesLocker(&m_cyclesMutex);
+        m_cyclePeriods.clear();
+    }
     m_trials.reserve(static_cast<size_t>(m_numTrials));
     for (quint16 trialId = 0; trialId < m_numTrials; ++trialId) {
         m_trials.insert({trialId, new Trial(trialId, shared_from_this())});
     }
 
+    // The replicates of a group are run in lockstep by its first trial.
+    // The trials of a group can't be saved, resumed or stopped at different
+    // steps, so it's not done with checkpoints (even if only resuming from
+    // them) or cycle detection.
+    const int replicates = m_inputs->general(GENERAL_ATTR_REPLICATES).toInt();
+    if (replicates > 1 && !m_checkpointWriter && m_checkpointPrefix.isEmpty()
+            && !m_resumeFromCheckpoints
+            && m_inputs->general(GENERAL_ATTR_CYCLEWINDOW).toInt() == 0) {
+        for (quint16 trialId = 0; trialId < m_numTrials; ++trialId) {
+            Trial* leader = m_trials.at(static_cast<quint16>(trialId - trialId % replicates));
+            if (leader->id() != trialId) {
+                Trial* trial = m_trials.at(trialId);
+                trial->m_group.clear();
+                leader->m_group.emplace_back(trial);
+            }
+        }
+    }
+
     m_expStatus = Status::Paused;
     emit (statusChanged(m_expStatus));
 
@@ -190,22 +253,100 @@ void Experiment::enable(QString& error)
         return;
     }
 
+    // a budget is needed even without files; eg., charts also buffer rows
+    const quint64 memLimit = static_cast<quint64>(m_inputs->general(OUTPUT_MEMLIMIT).toInt()) << 20; // MB
+    m_outputBudget = std::make_shared<OutputBudget>(memLimit,
+        OutputBudget::policyFromString(m_inputs->general(OUTPUT_MEMPOLICY).toQString()));
+
     if (m_inputs->fileCaches().empty()) {
         return; // nothing to do
     }
 
-    m_filePathPrefix = QString("%1/%2_e%3_t")
-            .arg(m_inputs->general(OUTPUT_DIR).toQString(), project->name())
-            .arg(m_id);
+    const QString outDir = m_inputs->general(OUTPUT_DIR).toQString();
+    m_filePathPrefix = QString("%1/%2_e%3_t").arg(outDir, project->name()).arg(m_id);
+    m_fileMode = OutputFile::modeFromString(m_inputs->general(OUTPUT_FILEMODE).toQString());
 
     m_outputs.clear();
     m_fileHeader.clear();
+    m_fileHasStepColumn = false;
     for (const Cache* cache : m_inputs->fileCaches()) {
         m_fileHeader += cache->printableHeader(',', false) + ",";
-        m_outputs.insert(cache->output());
+        addOutput(cache->output());
+        if (!cache->output()->sampling().isDense()) {
+            m_fileHasStepColumn = true;
+        }
+    }
+    if (m_fileHasStepColumn) {
+        // sparse outputs are not aligned to the line number anymore
+        m_fileHeader.prepend("step,");
     }
     m_fileHeader.chop(1);
     m_fileHeader += "\n";
+
+    // all trials write to a single file; the rows are identified by their ids
+    if (m_fileMode == OutputFile::Mode::Experiment) {
+        m_fileHeader.prepend("trial,");
+        m_outputFile = std::make_shared<OutputFile>(
+            QString("%1/%2_e%3.csv").arg(outDir, project->name()).arg(m_id), m_fileHeader);
+        if (!m_outputFile->open(error)) {
+            m_outputFile.reset();
+        }
+    } else if (m_fileMode == OutputFile::Mode::Project) {
+        m_fileHeader.prepend("experiment,trial,");
+        m_outputFile = project->outputFile(
+            QString("%1/%2_outputs.csv").arg(outDir, project->name()), m_fileHeader, m_id, error);
+    }
+
+    // statistics across trials, written to a summary file
+    if (m_inputs->general(OUTPUT_AVGTRIALS).toBool()) {
+        QStringList columns;
+        for (const Cache* cache : m_inputs->fileCaches()) {
+            columns << cache->printableHeader(',', false).split(',');
+        }
+        auto summary = std::make_shared<OutputFile>(
+            QString("%1/%2_e%3_summary.csv").arg(outDir, project->name()).arg(m_id),
+            OutputAggregator::header(columns));
+        if (summary->open(error)) {
+            m_aggregator = std::make_shared<OutputAggregator>(columns, m_numTrials,
+                                                              summary, m_outputBudget);
+        }
+    }
+}
+
+void Experiment::enableCheckpoints()
+{
+    m_checkpointPrefix.clear();
+    m_checkpointWriter.reset();
+
+    const int interval = m_inputs->general(OUTPUT_CHECKPOINT).toInt();
+    if (interval <= 0 && !m_resumeFromCheckpoints) {
+        return;
+    }
+
+    // when resuming, the rows written after the checkpoint are discarded;
+    // it is not possible in files shared by other trials
+    if (m_outputFile || m_aggregator) {
+        qWarning() << QString("E%1: checkpoints are not supported with shared output "
+                              "files ('%2') nor with '%3'.").arg(m_id).arg(OUTPUT_FILEMODE, OUTPUT_AVGTRIALS);
+        return;
+    }
+
+    ProjectPtr project = m_project.lock();
+    QString dir = m_inputs->general(OUTPUT_DIR).toQString();
+    if (dir.isEmpty() && !project->filepath().isEmpty()) {
+        dir = QFileInfo(project->filepath()).absolutePath();
+    }
+    if (dir.isEmpty()) {
+        qWarning() << QString("E%1: checkpoints need an output directory "
+                              "or a saved project.").arg(m_id);
+        return;
+    }
+
+    m_checkpointPrefix = QString("%1/%2_e%3_t").arg(dir, project->name()).arg(m_id);
+    m_checkpointInterval = interval * 1000;
+    if (interval > 0) {
+        m_checkpointWriter = std::make_shared<CheckpointWriter>();
+    }
 }
 
 const Trial* Experiment::trial(quint16 trialId) const
@@ -216,6 +357,18 @@ const Trial* Experiment::trial(quint16 trialId) const
     return it->second;
 }
 
+std::map<int, int> Experiment::cyclePeriods() const
+{
+    QMutexLocker locker(&m_cyclesMutex);
+    return m_cyclePeriods;
+}
+
+void Experiment::cycleFound(int period)
+{
+    QMutexLocker locker(&m_cyclesMutex);
+    ++m_cyclePeriods[period];
+}
+
 void Experiment::updateProgressValue()
 {
     if (m_expStatus != Status::Running) {
@@ -224,7 +377,9 @@ void Experiment::updateProgressValue()
 
     float p = 0.f;
     for (auto const& t : m_trials) {
-        p += (static_cast<float>(t.second->step()) / m_stopAt);
+        // a trial which has stopped in a cycle is done as well
+        const int step = t.second->status() == Status::Finished ? m_stopAt : t.second->step();
+        p += (static_cast<float>(step) / m_stopAt);
     }
     auto newProg = static_cast<quint16>(std::ceil(p * 360.f / m_numTrials));
     if (newProg != m_progress) {
@@ -240,7 +395,16 @@ void Experiment::trialFinished(Trial* trial)
         pause(); // pause all other trials asap
         emit (statusChanged(m_expStatus));
     }
+    const OutputAggregatorPtr aggregator = m_aggregator;
     locker.unlock();
+
+    // a failed trial will not fold its rows anymore; don't wait for it
+    if (aggregator && trial->status() == Status::Invalid) {
+        for (const Trial* t : trial->m_group) {
+            aggregator->trialFinished(t->id());
+        }
+    }
+
     m_mainApp->expMgr()->trialFinished(trial);
 }
 
@@ -264,6 +428,18 @@ void Experiment::expFinished()
         }
     }
 
+    // the checkpoints of the finished trials are no longer needed
+    if (!m_checkpointPrefix.isEmpty()) {
+        if (m_checkpointWriter) {
+            m_checkpointWriter->waitForDone();
+        }
+        for (auto const& t : m_trials) {
+            if (t.second->status() == Status::Finished) {
+                QFile::remove(checkpointPath(t.first));
+            }
+        }
+    }
+
     if (allTrialsFinished) {
         m_expStatus = Status::Finished;
         if (m_autoDeleteTrials) {
@@ -313,20 +489,61 @@ void Experiment::playNext()
     play();
 }
 
-Nodes Experiment::cloneCachedNodes(const int trialId)
+bool Experiment::prepareTrials()
 {
+    QMutexLocker locker(&m_mutex);
+
+    int toInit = 0;
+    for (auto const& it : m_trials) {
+        if (it.second->status() == Status::Disabled) {
+            ++toInit;
+        }
+    }
+
+    m_initFailed = false;
+    m_trialsToInit = toInit;
+    if (toInit == 0) {
+        return true;
+    }
+
+    // a single trial just takes these nodes; no copy is made
+    if (m_clonableNodes.empty()) {
+        m_clonableNodes = createNodes();
+        if (m_clonableNodes.empty()) {
+            m_initFailed = true;
+            return false;
+        }
+    }
+
+    // until a trial is measured, we assume a Moore neighbourhood (8 edges per node)
+    if (!m_footprintMeasured) {
+        const quint64 nodes = m_clonableNodes.size();
+        const quint64 edges = m_graphType == GraphType::Directed ? nodes * 8 : nodes * 4;
+        m_trialFootprint = Trial::estimateFootprint(m_graphType, nodes, edges,
+                static_cast<int>(modelPlugin()->nodeAttrsScope().size()),
+                static_cast<int>(modelPlugin()->edgeAttrsScope().size()))
+                + outputFootprint();
+    }
+    return true;
+}
+
+Nodes Experiment::cloneCachedNodes()
+{
+    // the read lock is taken before counting down the trials, so the last
+    // one only takes the nodes when all the others are done with them
+    QReadLocker readLocker(&m_clonableNodesLock);
     if (m_clonableNodes.empty()) {
         return Nodes();
     }
 
     // if it's not the last trial, just take a copy of the nodes
-    for (auto const& it : m_trials) {
-        if (it.first != trialId && it.second->status() == Status::Disabled) {
-            return NodesPrivate::clone(m_clonableNodes);
-        }
+    if (--m_trialsToInit > 0) {
+        return NodesPrivate::clone(m_clonableNodes);
     }
+    readLocker.unlock();
 
     // it's the last trial, let's use the cloned nodes
+    QWriteLocker writeLocker(&m_clonableNodesLock);
     Nodes nodes = m_clonableNodes;
     Nodes().swap(m_clonableNodes);
     return nodes;
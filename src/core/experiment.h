@@ -17,20 +17,26 @@
 #ifndef EXPERIMENT_H
 #define EXPERIMENT_H
 
+#include <atomic>
+#include <map>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include <QMutex>
+#include <QReadWriteLock>
 
 #include "attrsgenerator.h"
+#include "checkpointwriter.h"
 #include "constants.h"
 #include "enum.h"
 #include "expinputs.h"
 #include "experimentsmgr.h"
 #include "mainapp.h"
 #include "output.h"
+#include "outputaggregator.h"
+#include "outputfile.h"
 #include "graphplugin.h"
 #include "modelplugin.h"
 
@@ -81,6 +87,8 @@ public:
     bool removeOutput(const OutputPtr& output);
     OutputPtr searchOutput(const OutputPtr& find);
     inline bool hasOutputs() const;
+    // sets the memory budget of the experiment to the output and creates
+    // the rows of all trials in it
     inline void addOutput(OutputPtr output);
 
     // pause all trials at a specific step
@@ -97,9 +105,33 @@ public:
     inline bool autoDeleteTrials() const;
     inline void setAutoDeleteTrials(bool b);
 
+    // If enabled, the trials resume from their latest checkpoint (if any)
+    // instead of starting from scratch. It takes effect on the next reset.
+    // See OUTPUT_CHECKPOINT.
+    inline bool resumeFromCheckpoints() const;
+    inline void setResumeFromCheckpoints(bool b);
+
     const Trial* trial(quint16 trialId) const;
     inline const Trials& trials();
 
+    // the memory used by the output rows waiting to be read
+    // it's null for a Disabled experiment
+    inline const OutputBudget* outputBudget() const;
+
+    // The memory (in bytes) a trial is expected to take; it's estimated
+    // from the number of nodes and attributes when the trials are queued,
+    // and replaced by the footprint of the first trial initialized.
+    // See ExperimentsMgr::setMemoryBudget().
+    inline quint64 trialFootprint() const;
+    // The memory (in bytes) taken by the initialized trials.
+    inline quint64 memoryUsage() const;
+
+    // The number of trials which have stopped in a cycle of each period
+    // (see GENERAL_ATTR_CYCLEWINDOW), ie, <period, trials>. It's kept until
+    // the experiment is reset, even if the trials are deleted.
+    // This method IS thread-safe.
+    std::map<int, int> cyclePeriods() const;
+
     inline int id() const;
     inline ProjectPtr project() const;
     inline int numTrials() const;
@@ -153,7 +185,17 @@ private:
 
     QString m_fileHeader;   // file header is the same for all trials; let's save it then
     QString m_filePathPrefix;
+    bool m_fileHasStepColumn; // true if any file output has a sparse sampling policy
+    OutputFile::Mode m_fileMode;
+    OutputFilePtr m_outputFile; // file shared by all trials; null for OutputFile::Mode::Trial
+    OutputAggregatorPtr m_aggregator; // null if OUTPUT_AVGTRIALS is false
     std::unordered_set<OutputPtr> m_outputs;
+    OutputBudgetPtr m_outputBudget; // shared by all outputs
+
+    bool m_resumeFromCheckpoints;
+    QString m_checkpointPrefix; // empty if checkpoints are not supported
+    int m_checkpointInterval;   // msecs
+    CheckpointWriterPtr m_checkpointWriter; // null if the checkpoints are disabled
 
     int m_pauseAt;
     quint16 m_progress; // current progress value [0, 360]
@@ -161,24 +203,51 @@ private:
     Status m_expStatus;
 
     Trials m_trials;
+    // trials (or groups of replicates) queued or running;
+    // see ExperimentsMgr::trialFinished()
+    std::atomic<int> m_pendingTrials;
 
     // The trials are meant to have the same initial population.
     // So, considering that it might be a very expensive operation (eg, I/O),
-    // we try to do the heavy stuff only once, storing the initial population
-    // in the 'm_clonableNodes' container. Except when the experiment has only
-    // one trial.
+    // we do the heavy stuff only once, before the trials are initialized,
+    // storing the initial population in the 'm_clonableNodes' container.
     Nodes m_clonableNodes;
+    QReadWriteLock m_clonableNodesLock;
+    std::atomic<int> m_trialsToInit; // trials which still need a copy of 'm_clonableNodes'
+    // set when a trial fails to initialize; the others give up asap
+    std::atomic<bool> m_initFailed;
+
+    std::atomic<quint64> m_trialFootprint;  // see trialFootprint()
+    std::atomic<bool> m_footprintMeasured;  // true if m_trialFootprint comes from a trial
+    std::atomic<quint64> m_memoryUsage;     // see memoryUsage()
+
+    mutable QMutex m_cyclesMutex;
+    std::map<int, int> m_cyclePeriods; // see cyclePeriods()
 
     // Parse the edge attrs command and return an AttrsGenerator
     AttrsGeneratorPtr edgeAttrsGen(bool& ok) const;
 
-    // Return a clone of 'm_clonableNodes'. It also clear the 'm_clonableNodes'
-    // if 'trialId' is the last trial being created for this experiment.
-    // This method is NOT thread-safe.
-    Nodes cloneCachedNodes(const int trialId);
+    // Builds the state shared by the trials which are about to be
+    // initialized (ie, 'm_clonableNodes'), so that they can be initialized
+    // concurrently, and estimates their footprint.
+    // Returns false if the nodes could not be created.
+    // This method IS thread-safe.
+    bool prepareTrials();
+
+    // each trial's share of the memory limit of the output rows
+    inline quint64 outputFootprint() const;
+
+    // Return a clone of 'm_clonableNodes'. The last trial being initialized
+    // takes the 'm_clonableNodes' instead. It returns an empty set if
+    // there is nothing cached.
+    // This method IS thread-safe.
+    Nodes cloneCachedNodes();
 
     void deleteTrials();
 
+    // trigged when a Trial has finished in a cycle of the given period
+    void cycleFound(int period);
+
     // trigged when a Trial ends
     // also runs in a work thread
     void trialFinished(Trial *trial);
@@ -190,6 +259,11 @@ private:
     // auxiliary method to initialize the experiment
     void enable(QString& error);
 
+    // sets where (and how often) the trials save their checkpoints
+    void enableCheckpoints();
+
+    inline QString checkpointPath(quint16 trialId) const;
+
     // set experiment status and emit statusChanged()
     // this IS thread-safe
     void setExpStatus(Status s);
@@ -206,7 +280,7 @@ inline bool Experiment::hasOutputs() const
 { return !m_outputs.empty(); }
 
 inline void Experiment::addOutput(OutputPtr output)
-{ m_outputs.insert(output); }
+{ output->setBudget(m_outputBudget); output->createRows(m_numTrials); m_outputs.insert(output); }
 
 inline void Experiment::pause()
 { m_pauseAt = -1; }
@@ -229,6 +303,18 @@ inline void Experiment::setStopAt(int step)
 inline const Trials& Experiment::trials()
 { return m_trials; }
 
+inline const OutputBudget* Experiment::outputBudget() const
+{ return m_outputBudget.get(); }
+
+inline quint64 Experiment::trialFootprint() const
+{ return m_trialFootprint; }
+
+inline quint64 Experiment::memoryUsage() const
+{ return m_memoryUsage; }
+
+inline quint64 Experiment::outputFootprint() const
+{ return m_outputBudget && m_numTrials > 0 ? m_outputBudget->limit() / static_cast<quint64>(m_numTrials) : 0; }
+
 inline quint16 Experiment::delay() const
 { return m_delay; }
 
@@ -241,6 +327,15 @@ inline bool Experiment::autoDeleteTrials() const
 inline void Experiment::setAutoDeleteTrials(bool b)
 { m_autoDeleteTrials = b; }
 
+inline bool Experiment::resumeFromCheckpoints() const
+{ return m_resumeFromCheckpoints; }
+
+inline void Experiment::setResumeFromCheckpoints(bool b)
+{ m_resumeFromCheckpoints = b; }
+
+inline QString Experiment::checkpointPath(quint16 trialId) const
+{ return m_checkpointPrefix + QString("%1.ckpt").arg(trialId); }
+
 inline int Experiment::id() const
 { return m_id; }
 
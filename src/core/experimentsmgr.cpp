@@ -14,10 +14,12 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <QFutureWatcher>
 #include <QtConcurrent>
 #include <QtDebug>
 
+#include "cputopology.h"
 #include "experimentsmgr.h"
 #include "experiment.h"
 #include "trial.h"
@@ -25,15 +27,21 @@
 namespace evoplex {
 
 ExperimentsMgr::ExperimentsMgr()
-    : m_lastThreadPriority(std::numeric_limits<int>::max()/2),
+    : m_memoryInUse(0),
+      m_runningTrials(0),
       m_timerProgress(new QTimer(this))
 {
     resetSettingsToDefault();
 
+    m_quantumSteps = m_userPrefs.value("settings/quantumSteps", m_quantumSteps.load()).toInt();
+    m_quantumMsecs = m_userPrefs.value("settings/quantumMsecs", m_quantumMsecs.load()).toInt();
+    m_memoryBudget = m_userPrefs.value("settings/memoryBudget", m_memoryBudget.load()).toInt();
     m_threads = m_userPrefs.value("settings/threads", m_threads).toInt();
     m_threads = m_threads > QThread::idealThreadCount() ? QThread::idealThreadCount() : m_threads;
-    m_threadPool.setMaxThreadCount(m_threads);
+    m_scheduler.reset(new TrialScheduler(m_threads, [this](Trial* t) { runTrial(t); }));
     qDebug() << "setting the max number of threads to" << m_threads;
+    m_scheduler->setAffinity(TrialScheduler::affinityFromString(
+            m_userPrefs.value("settings/affinity", "none").toString()));
 
     m_timerProgress->setSingleShot(true);
     connect(m_timerProgress, SIGNAL(timeout()), SLOT(updateProgressValues()));
@@ -41,18 +49,21 @@ ExperimentsMgr::ExperimentsMgr()
 
 ExperimentsMgr::~ExperimentsMgr()
 {
-    m_threadPool.clear();
-    m_threadPool.waitForDone();
+    m_scheduler.reset(); // waits for the running trials
     delete m_timerProgress;
 }
 
 void ExperimentsMgr::resetSettingsToDefault()
 {
     m_threads = QThread::idealThreadCount();
+    m_quantumSteps = 0;
+    m_quantumMsecs = 0;
+    m_memoryBudget = 0;
 }
 
 void ExperimentsMgr::updateProgressValues()
 {
+    QMutexLocker locker(&m_mutex);
     if (!m_running.empty()) {
         for (auto const& exp : m_running) {
             exp->updateProgressValue();
@@ -74,6 +85,7 @@ void ExperimentsMgr::_play(ExperimentPtr exp)
 
     if (exp->expStatus() == Status::Invalid ||
             exp->expStatus() == Status::Running ||
+            exp->expStatus() == Status::Queued ||
             exp->expStatus() == Status::Finished) {
         return;
     }
@@ -82,106 +94,224 @@ void ExperimentsMgr::_play(ExperimentPtr exp)
         return; // something went wrong while initializing the experimnt
     }
 
-    if (exp->expStatus() != Status::Queued) {
-        exp->setExpStatus(Status::Queued);
-        m_idle.remove(exp);
-        m_queued.remove(exp);
-        m_queued.emplace_back(exp);
-    }
+    exp->setExpStatus(Status::Queued);
+    m_idle.remove(exp);
+    m_queued.emplace_back(exp);
 
     // iterate by id to maintain id order
+    // the replicates of a group are run by the first trial of the group
+    std::vector<Trial*> trials;
+    trials.reserve(exp->trials().size());
     for (quint16 id = 0; id < exp->trials().size(); ++id) {
         Trial* trial = exp->trials().at(id);
         if (trial->status() != Status::Disabled) {
             trial->m_status = Status::Queued;
         }
-        m_queuedTrials.emplace_back(trial);
+        if (!trial->m_group.empty()) {
+            trials.emplace_back(trial);
+        }
     }
+    exp->m_pendingTrials += static_cast<int>(trials.size());
 
     locker.unlock();
-    processQueue();
-}
 
-void ExperimentsMgr::trialFinished(Trial* trial)
-{
-    QMutexLocker locker(&m_mutex);
+    // builds the initial population once, so the trials can init concurrently;
+    // if it fails, the trials are aborted as soon as they start
+    exp->prepareTrials();
 
-    m_runningTrials.remove(trial);
-    if (isTheLastTrial(trial)) {
-        ExperimentPtr exp = trial->m_exp;
+    submit(trials);
+}
 
-        locker.unlock();
-        exp->expFinished(); // might delete all trials
-        locker.relock();
+void ExperimentsMgr::submit(const std::vector<Trial*>& trials)
+{
+    // the trials go back to the NUMA node where their memory is
+    std::map<int, std::vector<Trial*>> nodes;
+    for (Trial* trial : trials) {
+        nodes[trial->m_numaNode].emplace_back(trial);
+    }
+    for (auto const& it : nodes) {
+        m_scheduler->submit(it.second, it.first);
+    }
+}
 
-        m_running.remove(exp);
-        emit (progressUpdated());
+void ExperimentsMgr::runTrial(Trial* trial)
+{
+    const ExperimentPtr& exp = trial->m_exp;
 
-        if (exp->expStatus() != Status::Invalid && exp->expStatus() != Status::Disabled) {
-            m_idle.emplace_back(exp);
+    // the first trial to run sets the experiment as running
+    if (exp->expStatus() == Status::Queued && exp->pauseAt() >= 0) {
+        QMutexLocker locker(&m_mutex);
+        if (exp->expStatus() == Status::Queued) {
+            exp->setExpStatus(Status::Running);
+            m_queued.remove(exp);
+            m_running.emplace_back(exp);
         }
+    }
 
-        if (m_running.empty() && m_queued.empty()) {
-            m_lastThreadPriority = std::numeric_limits<int>::max()/2; // reset priority
-        }
+    // checks if we really need to run this trial; eg., the experiment might
+    // have been paused, invalidated or removed from the queue meanwhile.
+    // A trial which yielded is in the middle of its loop; it runs anyway
+    // to stop properly (see Trial::runSteps).
+    if (!trial->m_yielded && (exp->expStatus() != Status::Running || exp->pauseAt() < 0)) {
+        trialFinished(trial);
+        return;
     }
 
-    locker.unlock();
-    processQueue();
+    // a trial only takes memory when it's initialized
+    if (trial->status() == Status::Disabled && !admit(trial)) {
+        return; // deferred; it's submitted again by admitDeferred()
+    }
+
+    ++m_runningTrials;
+    trial->run(); // calls trialFinished()
+    --m_runningTrials;
+
+    admitDeferred();
 }
 
-bool ExperimentsMgr::isTheLastTrial(const Trial* trial)
+bool ExperimentsMgr::admit(Trial* trial)
 {
-    for (auto const& t : m_runningTrials) {
-        if (t->m_exp == trial->m_exp)
-            return false;
+    if (trial->m_footprint > 0) {
+        return true; // admitted by admitDeferred()
     }
-    for (auto const& t : m_queuedTrials) {
-        if (t->m_exp == trial->m_exp)
-            return false;
+
+    // the replicates of a group are initialized together
+    const quint64 bytes = trial->m_exp->trialFootprint() * trial->m_group.size();
+    const quint64 budget = static_cast<quint64>(m_memoryBudget) << 20; // MB
+
+    QMutexLocker locker(&m_admissionMutex);
+    // if nothing else is running, the memory in use will not be released
+    // soon; let's run it anyway to avoid a deadlock
+    if (budget > 0 && m_runningTrials > 0 && m_memoryInUse + bytes > budget) {
+        m_deferred.emplace_back(trial);
+        return false;
     }
+    reserve(trial);
     return true;
 }
 
-void ExperimentsMgr::processQueue()
+void ExperimentsMgr::reserve(Trial* trial)
 {
-    QMutexLocker locker(&m_mutex);
-    if (static_cast<int>(m_runningTrials.size()) < m_threads) {
-        Trial* trial = nullptr;
-        while (!trial && !m_queuedTrials.empty()) {
-            trial = m_queuedTrials.front();
-            m_queuedTrials.pop_front();
-        }
+    Experiment* exp = trial->m_exp.get();
+    for (Trial* t : trial->m_group) {
+        t->m_footprint = exp->trialFootprint();
+        exp->m_memoryUsage += t->m_footprint;
+        m_memoryInUse += t->m_footprint;
+    }
+}
 
-        if (!trial) {
-            return;
-        }
+void ExperimentsMgr::release(Trial* trial)
+{
+    Experiment* exp = trial->m_exp.get();
+    QMutexLocker locker(&m_admissionMutex);
+    quint64 bytes = 0;
+    for (Trial* t : trial->m_group) {
+        bytes += t->m_footprint;
+        t->m_footprint = 0;
+        t->freeState();
+    }
+    exp->m_memoryUsage -= bytes;
+    m_memoryInUse -= bytes;
+}
 
+void ExperimentsMgr::admitDeferred()
+{
+    std::vector<Trial*> trials;
+    QMutexLocker locker(&m_admissionMutex);
+    const quint64 budget = static_cast<quint64>(m_memoryBudget) << 20; // MB
+    for (auto it = m_deferred.begin(); it != m_deferred.end();) {
+        Trial* trial = *it;
         Experiment* exp = trial->m_exp.get();
-
-        // checks if we really need to run this trial
-        if (!exp || exp->expStatus() == Status::Invalid ||
-                exp->expStatus() == Status::Finished ||
-                exp->pauseAt() < 0) { // is paused
-            locker.unlock();
-            trialFinished(trial);
-            return;
+        if (exp->expStatus() != Status::Running || exp->pauseAt() < 0) {
+            // runTrial() just skips it
+        } else if (budget == 0 || m_memoryInUse + exp->trialFootprint() * trial->m_group.size() <= budget
+                   || (m_runningTrials == 0 && trials.empty())) {
+            reserve(trial);
+        } else {
+            ++it;
+            continue;
         }
+        trials.emplace_back(trial);
+        it = m_deferred.erase(it);
+    }
+    locker.unlock();
 
-        // checks if this is the first time we run this experiment
-        if (exp->expStatus() != Status::Running) {
-            exp->setExpStatus(Status::Running);
-            m_running.emplace_back(trial->m_exp);
-            m_queued.remove(trial->m_exp);
-        }
+    if (!trials.empty()) {
+        submit(trials);
+    }
+}
+
+void ExperimentsMgr::updateFootprint(Trial* trial)
+{
+    Experiment* exp = trial->m_exp.get();
+    const quint64 bytes = trial->footprint();
+
+    QMutexLocker locker(&m_admissionMutex);
+    // unsigned arithmetic; it also works if the trial is smaller than estimated
+    exp->m_memoryUsage += bytes - trial->m_footprint;
+    m_memoryInUse += bytes - trial->m_footprint;
+    trial->m_footprint = bytes;
+    if (!exp->m_footprintMeasured.exchange(true)) {
+        exp->m_trialFootprint = bytes;
+    }
+    locker.unlock();
+
+    // the estimate might have been too pessimistic
+    admitDeferred();
+}
 
-        m_runningTrials.emplace_back(trial);
-        // play in the same order of insertion
-        m_threadPool.start(trial, m_lastThreadPriority--);
+void ExperimentsMgr::releaseMemory(const Experiment* exp, quint64 bytes)
+{
+    QMutexLocker locker(&m_admissionMutex);
+    m_deferred.erase(std::remove_if(m_deferred.begin(), m_deferred.end(),
+            [exp](const Trial* t) { return t->m_exp.get() == exp; }), m_deferred.end());
+    locker.unlock();
 
-        locker.unlock();
-        processQueue();
+    if (bytes == 0) {
+        return;
     }
+    m_memoryInUse -= bytes;
+    admitDeferred();
+}
+
+void ExperimentsMgr::trialFinished(Trial* trial)
+{
+    // An ended trial gives its memory back right away, unless it's kept
+    // until the trials are deleted (eg., to be displayed).
+    if ((trial->status() == Status::Finished || trial->status() == Status::Invalid)
+            && trial->m_exp->autoDeleteTrials()) {
+        release(trial);
+        admitDeferred();
+    }
+
+    // a copy; the trial might be deleted by expFinished()
+    ExperimentPtr exp = trial->m_exp;
+    if (--exp->m_pendingTrials > 0) {
+        return;
+    }
+
+    exp->expFinished(); // might delete all trials
+
+    QMutexLocker locker(&m_mutex);
+    m_running.remove(exp);
+    m_queued.remove(exp);
+    emit (progressUpdated());
+
+    if (exp->expStatus() != Status::Invalid && exp->expStatus() != Status::Disabled) {
+        m_idle.emplace_back(exp);
+    }
+}
+
+void ExperimentsMgr::trialYielded(Trial* trial)
+{
+    m_scheduler->submit({trial}, trial->m_numaNode);
+}
+
+void ExperimentsMgr::replicasReleased(const std::vector<Trial*>& trials)
+{
+    Q_ASSERT_X(!trials.empty(), "ExperimentsMgr", "no replicas to release");
+    trials.front()->m_exp->m_pendingTrials += static_cast<int>(trials.size());
+    submit(trials);
 }
 
 void ExperimentsMgr::remove(const ExperimentPtr& exp)
@@ -196,14 +326,9 @@ void ExperimentsMgr::removeFromQueue(const ExperimentPtr& exp)
     QMutexLocker locker(&m_mutex);
     if (exp->expStatus() == Status::Queued) {
         m_queued.remove(exp);
-        auto it = m_queuedTrials.begin();
-        while (it != m_queuedTrials.end()) {
-            if ((*it)->m_exp == exp) {
-                it = m_queuedTrials.erase(it);
-            } else {
-                ++it;
-            }
-        }
+        const Experiment* e = exp.get();
+        exp->m_pendingTrials -= m_scheduler->removeIf(
+                [e](const Trial* t) { return t->m_exp.get() == e; });
         exp->setExpStatus(Status::Paused);
     }
 }
@@ -239,22 +364,9 @@ void ExperimentsMgr::setMaxThreadCount(int newValue, QString* error)
         return;
     }
 
-    QMutexLocker locker(&m_mutex);
-    if (!m_running.empty() || !m_queued.empty()) {
-        QString e("Cannot set the number of threads while running experiments."
-                  " Please, pause all your experiments and try again.");
-        if (error) *error = e;
-        qWarning() << e;
-        return;
-    }
-
-    m_threadPool.setMaxThreadCount(newValue);
-    if (newValue != m_threadPool.maxThreadCount()) {
-        QString e("Could not set the number of threads to %1.\n"
-                  "Assigning the maximum value available: %2.");
-        if (error) *error = e;
-        qWarning() << e;
-    }
+    // it takes effect while running too: new workers start right away and
+    // the excess ones retire once their current trial (or quantum) is over
+    m_scheduler->resize(newValue);
 
     qDebug() << "setting the max number of threads from"
              << m_threads << "to" << newValue;
@@ -263,4 +375,65 @@ void ExperimentsMgr::setMaxThreadCount(int newValue, QString* error)
     m_userPrefs.setValue("settings/threads", m_threads);
 }
 
+void ExperimentsMgr::setQuantum(const int steps, const int msecs)
+{
+    m_quantumSteps = std::max(0, steps);
+    m_quantumMsecs = std::max(0, msecs);
+    m_userPrefs.setValue("settings/quantumSteps", m_quantumSteps.load());
+    m_userPrefs.setValue("settings/quantumMsecs", m_quantumMsecs.load());
+}
+
+void ExperimentsMgr::setMemoryBudget(const int mb)
+{
+    m_memoryBudget = std::max(0, mb);
+    m_userPrefs.setValue("settings/memoryBudget", m_memoryBudget.load());
+    admitDeferred();
+}
+
+void ExperimentsMgr::setAffinity(TrialScheduler::Affinity affinity)
+{
+    m_scheduler->setAffinity(affinity);
+    m_userPrefs.setValue("settings/affinity", TrialScheduler::affinityToString(affinity));
+}
+
+QString ExperimentsMgr::placementReport()
+{
+    const CpuTopology& topology = CpuTopology::instance();
+    QString report = QString("affinity: %1; %2 NUMA node(s), %3 cpus\n")
+            .arg(TrialScheduler::affinityToString(m_scheduler->affinity()))
+            .arg(topology.numNodes()).arg(topology.numCpus());
+
+    auto cpuList = [](const std::vector<int>& cpus) {
+        QStringList l;
+        for (int cpu : cpus) l << QString::number(cpu);
+        return l.join(',');
+    };
+    for (int node = 0; node < topology.numNodes(); ++node) {
+        report += QString("  node %1: cpus %2\n").arg(node).arg(cpuList(topology.cpus(node)));
+    }
+    for (int w = 0; w < m_scheduler->numWorkers(); ++w) {
+        const std::vector<int> cpus = m_scheduler->workerCpus(w);
+        report += QString("  worker %1: node %2, cpus %3\n").arg(w)
+                .arg(m_scheduler->workerNode(w))
+                .arg(cpus.empty() ? QString("any") : cpuList(cpus));
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for (auto const& exp : m_running) {
+        std::map<int, int> trialsPerNode;
+        for (auto const& it : exp->trials()) {
+            if (it.second->status() != Status::Disabled) {
+                ++trialsPerNode[it.second->m_numaNode];
+            }
+        }
+        QStringList nodes;
+        for (auto const& it : trialsPerNode) {
+            nodes << QString("%1:%2").arg(it.first < 0 ? QString("?") : QString::number(it.first))
+                                     .arg(it.second);
+        }
+        report += QString("  E%1 trials per node: %2\n").arg(exp->id()).arg(nodes.join(' '));
+    }
+    return report;
+}
+
 } // evoplex
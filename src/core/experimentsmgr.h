@@ -17,14 +17,19 @@
 #ifndef EXPERIMENTMGR_H
 #define EXPERIMENTMGR_H
 
+#include <atomic>
+#include <deque>
 #include <list>
+#include <map>
 #include <memory>
+#include <vector>
 
 #include <QMutex>
 #include <QObject>
 #include <QTimer>
 #include <QSettings>
-#include <QThreadPool>
+
+#include "trialscheduler.h"
 
 namespace evoplex {
 
@@ -45,12 +50,63 @@ public:
     void play(ExperimentPtr exp);
 
     inline int maxThreadsCount() const { return m_threads; }
+    // It can be changed while experiments are running; see TrialScheduler::resize()
     void setMaxThreadCount(const int newValue, QString* error=nullptr);
 
+    // Time-sliced mode: a running trial yields its thread to the queued ones
+    // after 'steps' steps or 'msecs' milliseconds, whichever comes first,
+    // so all trials advance together. Zero disables a limit; both zero
+    // (default) lets trials run until they pause or finish. A trial resumes
+    // where it stopped (no re-init), so the results are the same.
+    void setQuantum(const int steps, const int msecs);
+    inline int quantumSteps() const { return m_quantumSteps; }
+    inline int quantumMsecs() const { return m_quantumMsecs; }
+
+    // true if there are trials waiting for a thread
+    inline bool hasQueuedTrials() const { return m_scheduler->numQueued() > 0; }
+
+    // Memory-aware admission control: a trial is only initialized if the
+    // memory of the initialized trials plus its footprint (see
+    // Experiment::trialFootprint()) fits in 'mb' megabytes; otherwise it
+    // waits for other trials to release memory. A trial is always admitted
+    // if no other trial is running. Zero (default) means unlimited.
+    void setMemoryBudget(const int mb);
+    inline int memoryBudget() const { return m_memoryBudget; }
+    // the memory (in bytes) taken by all initialized trials
+    inline quint64 memoryInUse() const { return m_memoryInUse; }
+
+    // trigged when a Trial has been initialized; its estimated footprint is
+    // replaced by the measured one (see Trial::footprint())
+    void updateFootprint(Trial* trial);
+
+    // trigged when the trials of an experiment are deleted; the deferred
+    // trials of 'exp' are dropped and its memory in use is released
+    void releaseMemory(const Experiment* exp, quint64 bytes);
+
+    // Pins the worker threads to cores or to NUMA nodes. Each trial is
+    // then initialized (ie, its graph allocated) and run on the same node
+    // whenever possible. It's a no-op on single-node machines.
+    void setAffinity(TrialScheduler::Affinity affinity);
+    inline TrialScheduler::Affinity affinity() const { return m_scheduler->affinity(); }
+
+    // the NUMA topology, where each worker is pinned to, and the nodes of
+    // the trials of the running experiments
+    QString placementReport();
+
     // trigged when a Trial ends
     // also runs in a work thread
+    // Only the last trial of an experiment takes the lock.
     void trialFinished(Trial* trial);
 
+    // trigged when a Trial has used up its quantum; it's queued again
+    // also runs in a work thread
+    void trialYielded(Trial* trial);
+
+    // trigged when the model of a group of replicates does not take them
+    // (see AbstractModel::takeReplicas()); they're queued to run individually
+    // also runs in a work thread
+    void replicasReleased(const std::vector<Trial*>& trials);
+
     void remove(const ExperimentPtr& exp);
     void removeFromQueue(const ExperimentPtr& exp);
     void removeFromIdle(const ExperimentPtr& exp);
@@ -65,16 +121,20 @@ private slots:
     void updateProgressValues();
 
 private:
-    QThreadPool m_threadPool;
-    QMutex m_mutex;
+    std::unique_ptr<TrialScheduler> m_scheduler;
+    QMutex m_mutex; // guards the lists of experiments
     QSettings m_userPrefs;
     int m_threads;
-    int m_lastThreadPriority;
+    std::atomic<int> m_quantumSteps;
+    std::atomic<int> m_quantumMsecs;
 
-    QTimer* m_timerProgress; // update the progress value of all running experiments
+    std::atomic<int> m_memoryBudget; // MB
+    std::atomic<quint64> m_memoryInUse;
+    std::atomic<int> m_runningTrials;
+    QMutex m_admissionMutex; // guards the admission/release of memory
+    std::deque<Trial*> m_deferred; // trials waiting for memory to be initialized
 
-    std::list<Trial*> m_runningTrials;
-    std::list<Trial*> m_queuedTrials;
+    QTimer* m_timerProgress; // update the progress value of all running experiments
 
     std::list<ExperimentPtr> m_running;
     std::list<ExperimentPtr> m_queued;
@@ -82,9 +142,25 @@ private:
 
     void _play(ExperimentPtr exp);
 
-    void processQueue();
+    // submits the trials to the workers of the node they belong to
+    void submit(const std::vector<Trial*>& trials);
+
+    // called by the scheduler in a worker thread
+    void runTrial(Trial* trial);
+
+    // Reserves the memory of a Disabled trial (and of the other trials of
+    // its group, which are initialized along with it). Returns false if it
+    // does not fit in the budget; the trial is then deferred.
+    bool admit(Trial* trial);
+
+    // reserves the memory of the trials of the group; m_admissionMutex must be locked
+    void reserve(Trial* trial);
+
+    // frees a trial (and its group) which has ended and gives its memory back
+    void release(Trial* trial);
 
-    bool isTheLastTrial(const Trial* trial);
+    // submits the deferred trials which fit in the budget now
+    void admitDeferred();
 };
 
 } // evoplex
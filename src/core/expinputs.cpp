@@ -106,18 +106,22 @@ ExpInputsPtr ExpInputs::parse(const MainApp* mainApp, const QStringList& header,
     parseAttrs(ei.get(), mainApp, header, values, failedAttrs);
     parseFileCache(ei.get(), failedAttrs, errMsg);
 
-    // make sure all attributes exist
-    auto checkAll = [&failedAttrs](Attributes* attrs, const AttributesScope& attrsScope) {
+    // make sure all attributes exist; the optional ones take their default value
+    auto checkAll = [&failedAttrs](Attributes* attrs, const AttributesScope& attrsScope,
+                                   const QHash<QString, Value>& defaults) {
         for (auto const& attrRange : attrsScope) {
             if (!attrs->contains(attrRange->attrName())) {
-                attrs->replace(attrRange->id(), attrRange->attrName(), Value());
-                failedAttrs.append(attrRange->attrName());
+                const Value dfValue = defaults.value(attrRange->attrName());
+                attrs->replace(attrRange->id(), attrRange->attrName(), dfValue);
+                if (!dfValue.isValid()) {
+                    failedAttrs.append(attrRange->attrName());
+                }
             }
         }
     };
-    checkAll(ei->m_generalAttrs, mainApp->generalAttrsScope());
-    checkAll(ei->m_graphAttrs, graph->pluginAttrsScope());
-    checkAll(ei->m_modelAttrs, model->pluginAttrsScope());
+    checkAll(ei->m_generalAttrs, mainApp->generalAttrsScope(), mainApp->generalAttrsDefaults());
+    checkAll(ei->m_graphAttrs, graph->pluginAttrsScope(), QHash<QString, Value>());
+    checkAll(ei->m_modelAttrs, model->pluginAttrsScope(), QHash<QString, Value>());
 
     // check if the given node/edge commands are valid
     checkAttrCommands(ei.get(), failedAttrs);
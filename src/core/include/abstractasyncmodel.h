@@ -0,0 +1,130 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ABSTRACT_ASYNC_MODEL_H
+#define ABSTRACT_ASYNC_MODEL_H
+
+#include <vector>
+
+#include "abstractmodel.h"
+
+namespace evoplex {
+
+/**
+ * @brief Abstract base class for models with asynchronous updates.
+ *
+ * At each step, nodes are picked at random and updated in place, one at
+ * a time, ie, an update sees the changes made by the previous ones. The
+ * engine draws the whole sequence of the step upfront (with PRG::index()
+ * and PRG::shuffle(), in O(1) per pick) and visits the nodes from a
+ * contiguous snapshot, so models only need to implement updateNode().
+ *
+ * The nodes are picked according to the updateOrder():
+ *   - UpdateOrder::Shuffled: a random sweep; each node is updated exactly
+ *     once per step, in a new random order at each step (default).
+ *   - UpdateOrder::Random: updatesPerStep() nodes are sampled uniformly
+ *     with replacement.
+ *
+ * @ingroup AbstractModel
+ */
+class AbstractAsyncModel : public AbstractModel
+{
+public:
+    enum class UpdateOrder {
+        Shuffled,
+        Random
+    };
+
+//! @addtogroup ModelAPI
+//! @{
+
+    /**
+     * @brief Updates @p node in place.
+     * It may read and change the attributes of any node.
+     */
+    virtual void updateNode(Node node) = 0;
+
+    /**
+     * @brief Performs the updates of one step.
+     * @returns true; derived classes may reimplement it to stop earlier.
+     */
+    bool algorithmStep() override;
+
+    /**
+     * @brief Schedules the snapshot of the nodes to be taken again, as
+     *        the graph might have been edited while the trial was paused.
+     * Derived classes reimplementing it must call it.
+     */
+    void beforeLoop() override;
+
+    /**
+     * @brief Gets the order in which the nodes are picked.
+     */
+    inline UpdateOrder updateOrder() const;
+
+    /**
+     * @brief Sets the order in which the nodes are picked.
+     * It's usually called once in init().
+     */
+    inline void setUpdateOrder(UpdateOrder order);
+
+    /**
+     * @brief Gets the number of updates per step of UpdateOrder::Random.
+     * Zero (default) means one per node, ie, one Monte Carlo step.
+     */
+    inline int updatesPerStep() const;
+
+    /**
+     * @brief Sets the number of updates per step of UpdateOrder::Random.
+     */
+    inline void setUpdatesPerStep(int n);
+
+/**@}*/
+
+protected:
+    //! constructor
+    AbstractAsyncModel();
+
+private:
+    UpdateOrder m_order;
+    int m_updatesPerStep;
+    bool m_rebuild;
+    std::vector<Node> m_nodes; // snapshot of the nodes, ordered by id
+    std::vector<quint32> m_sequence; // indices into 'm_nodes' of this step
+
+    // takes the snapshot of the nodes
+    void rebuild();
+};
+
+/************************************************************************
+   AbstractAsyncModel: Inline member functions
+ ************************************************************************/
+
+inline AbstractAsyncModel::UpdateOrder AbstractAsyncModel::updateOrder() const
+{ return m_order; }
+
+inline void AbstractAsyncModel::setUpdateOrder(UpdateOrder order)
+{ m_order = order; }
+
+inline int AbstractAsyncModel::updatesPerStep() const
+{ return m_updatesPerStep; }
+
+inline void AbstractAsyncModel::setUpdatesPerStep(int n)
+{ m_updatesPerStep = n > 0 ? n : 0; }
+
+} // evoplex
+#endif // ABSTRACT_ASYNC_MODEL_H
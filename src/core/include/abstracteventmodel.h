@@ -0,0 +1,130 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ABSTRACT_EVENT_MODEL_H
+#define ABSTRACT_EVENT_MODEL_H
+
+#include <vector>
+
+#include "abstractmodel.h"
+#include "ratetree.h"
+
+namespace evoplex {
+
+/**
+ * @brief Abstract base class for event-driven (continuous-time) models.
+ *
+ * Instead of updating all nodes at every step, each node has an event
+ * which happens at a given rate (see rate()). The events are simulated
+ * one at a time with the Gillespie algorithm: the time to the next event
+ * is exponentially distributed with the sum of all rates, and the node
+ * is picked with probability proportional to its rate, in O(log n).
+ * After an event, only the rates of the nodes which have changed and of
+ * their neighbours are recomputed.
+ *
+ * A step is a point of the time grid, ie, the trial's step @c s is the
+ * time @c s*timeStep() (see GENERAL_ATTR_TIMESTEP). So, the outputs are
+ * sampled on that grid, and algorithmStep() performs all events up to
+ * the next point. A trial finishes earlier if all rates are zero.
+ *
+ * @ingroup AbstractModel
+ */
+class AbstractEventModel : public AbstractModel
+{
+public:
+//! @addtogroup ModelAPI
+//! @{
+
+    /**
+     * @brief Gets the rate of the event of @p node in its current state.
+     * It must only depend on the attributes of the node and of its
+     * neighbours, and it must not be negative. Zero means that nothing
+     * can happen to the node.
+     */
+    virtual double rate(const Node& node) const = 0;
+
+    /**
+     * @brief Performs the event of @p node.
+     * It may change the attributes of any node.
+     */
+    virtual void fire(Node node) = 0;
+
+    /**
+     * @brief Performs all events up to the next point of the time grid.
+     * @returns false if no event can happen anymore.
+     */
+    bool algorithmStep() override;
+
+    /**
+     * @brief Schedules all rates to be recomputed before the next event,
+     *        as the nodes might have been edited while the trial was paused.
+     * Derived classes reimplementing it must call it.
+     */
+    void beforeLoop() override;
+
+    /**
+     * @brief Writes the time and the number of events into a checkpoint.
+     * Derived classes reimplementing it must call it first.
+     */
+    bool saveState(QDataStream& out) const override;
+
+    /**
+     * @brief Reads back the state written by saveState().
+     * Derived classes reimplementing it must call it first.
+     */
+    bool loadState(QDataStream& in) override;
+
+    /**
+     * @brief Gets the current (continuous) time.
+     */
+    inline double time() const;
+
+    /**
+     * @brief Gets the number of events performed so far.
+     */
+    inline quint64 numEvents() const;
+
+/**@}*/
+
+protected:
+    //! constructor
+    AbstractEventModel();
+
+private:
+    RateTree m_rates;
+    std::vector<Node> m_nodes; // the node of each leaf of 'm_rates'
+    std::vector<int> m_leaves; // node id -> leaf; -1 if none
+    double m_time;
+    quint64 m_numEvents;
+    bool m_rebuild;
+
+    // recomputes all rates
+    void rebuild();
+};
+
+/************************************************************************
+   AbstractEventModel: Inline member functions
+ ************************************************************************/
+
+inline double AbstractEventModel::time() const
+{ return m_time; }
+
+inline quint64 AbstractEventModel::numEvents() const
+{ return m_numEvents; }
+
+} // evoplex
+#endif // ABSTRACT_EVENT_MODEL_H
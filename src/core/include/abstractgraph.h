@@ -17,6 +17,9 @@
 #ifndef ABSTRACT_GRAPH_H
 #define ABSTRACT_GRAPH_H
 
+#include <map>
+#include <utility>
+#include <vector>
 #include <QtDebug>
 #include <QMutex>
 
@@ -26,6 +29,7 @@
 #include "enum.h"
 #include "nodes.h"
 #include "prg.h"
+#include "sparsematrix.h"
 
 namespace evoplex {
 
@@ -123,6 +127,88 @@ public:
      */
     Node randNode() const;
 
+    /**
+     * @brief Gets a hash of the attributes of all nodes.
+     * It's updated incrementally whenever a node's attribute changes, so
+     * it's O(1). It's only tracked if the trial looks for cycles (see
+     * GENERAL_ATTR_CYCLEWINDOW); otherwise it's zero.
+     */
+    inline quint64 stateHash() const;
+
+    /**
+     * @brief Gets the nodes which might change in the next step, i.e.,
+     *        the nodes whose attributes have changed since the previous
+     *        call, their neighbours, and the nodes whose edges have been
+     *        added or removed since then.
+     *
+     * It's meant for models in which a node's next state depends only on
+     * its own and its neighbours' attributes (eg, cellular automata), so
+     * that a step costs O(activity) instead of O(nodes):
+     * @code
+     * for (const Node& node : graph()->activeNodes()) { ... }
+     * @endcode
+     * The first call returns all nodes and starts tracking the changes,
+     * which costs a branch in every Node::setAttr().
+     * Note that the edges' attributes are not tracked.
+     * @warning The returned vector is only valid until the next call.
+     */
+    const std::vector<Node>& activeNodes();
+
+    /**
+     * @name Neighbourhood reductions
+     * For every node @c i, they reduce the attribute @p attrId of its
+     * neighbours @c j (ie, the outEdges()) into @c out[i.id()]; the
+     * output column is resized to fit the largest node id.
+     *
+     * If @p weightAttrId is a valid edge attribute, each neighbour's
+     * value is multiplied by the attribute of the edge (i,j) first.
+     * The attributes must be numeric (bool, char, int or double).
+     *
+     * They run on a compact copy of the topology, which is only rebuilt
+     * when nodes or edges are added or removed, in flat loops over
+     * contiguous arrays that the compiler can vectorize.
+     * Nodes are split across @p threads (1 by default, ie, the calling
+     * thread only; note that trials already run in parallel).
+     * @return false if an attribute is not numeric.
+     */
+    ///@{
+    //! The sum of the neighbours' attributes; 0 if it has no neighbours.
+    bool sumNeighbours(int attrId, std::vector<double>& out,
+                       int weightAttrId=-1, int threads=1);
+    //! The number of neighbours whose attribute is equal to @p value.
+    //! Unlike the other reductions, it accepts any type of attribute.
+    bool countNeighbours(int attrId, const Value& value, std::vector<int>& out,
+                         int threads=1);
+    //! The largest of the neighbours' attributes; -infinity if it has no neighbours.
+    bool maxNeighbours(int attrId, std::vector<double>& out,
+                       int weightAttrId=-1, int threads=1);
+    //! The id of the neighbour with the largest attribute (the first one in
+    //! the outEdges() on ties); -1 if it has no neighbours.
+    bool argmaxNeighbours(int attrId, std::vector<int>& out,
+                          int weightAttrId=-1, int threads=1);
+    ///@}
+
+    /**
+     * @brief Gets the weighted adjacency matrix of the graph.
+     *
+     * The entry (i,j) is the attribute @p weightAttrId of the edge from
+     * node @c i to its neighbour @c j (ie, the outEdges()), or 1 if
+     * @p weightAttrId is -1; rows and columns are the node ids. Thus, a
+     * linear update is one product, eg., the DeGroot model with
+     * row-normalized weights:
+     * @code
+     * graph()->adjacency(weightId)->multiply(opinions, next, threads);
+     * @endcode
+     * If @p transposed is true, it gets the transpose instead, eg., to
+     * push a distribution along the edges (random walks).
+     *
+     * The matrix is cached until nodes or edges are added or removed.
+     * Note that changes to the edges' attributes are not tracked.
+     * @return nullptr if the weight attribute is not numeric.
+     * @warning The pointer is only valid until the topology changes.
+     */
+    const SparseMatrix* adjacency(int weightAttrId=-1, bool transposed=false);
+
     /**
      * @brief Gets the number of nodes in the graph.
      */
@@ -216,6 +302,9 @@ protected:
 
     //! constructor
     AbstractGraph();
+    //! constructor of a graph of the given @p type which is built by hand
+    //! (ie, through addNode() and addEdge()) rather than set up by a trial
+    explicit AbstractGraph(GraphType type);
 
 private:
     QString m_graphId;
@@ -224,12 +313,50 @@ private:
 
     int m_lastNodeId;
     int m_lastEdgeId;
+    bool m_trackStateHash;
+    quint64 m_stateHash; // see stateHash()
+
+    // see activeNodes()
+    bool m_trackActivity;
+    bool m_allActive;               // true if the next call takes all nodes
+    quint32 m_activeStamp;          // incremented by each call
+    std::vector<int> m_changedNodes; // ids of nodes changed since the last call
+    std::vector<Node> m_activeNodes;
+
+    // compact copy of the topology for the neighbourhood reductions;
+    // the rows are the nodes ordered by id, the entries their outEdges
+    bool m_topologyChanged;          // true if it must be rebuilt
+    std::vector<Node> m_csrNodes;    // row -> node
+    std::vector<int> m_csrIds;       // row -> node id
+    std::vector<int> m_csrOffsets;   // row -> first entry; one extra at the end
+    std::vector<int> m_csrNeighbours; // entry -> row of the neighbour
+    std::vector<const Attributes*> m_csrEdgeAttrs; // entry -> edge's attributes
+    std::map<std::pair<int,bool>, SparseMatrix> m_adjacency; // <weightAttrId, transposed>
     QMutex m_mutex;
 
     std::uniform_int_distribution<int> m_numNodesDist;
 
     bool setup(const QString& id, GraphType type, PRG& prg,
                AttrsGeneratorPtr edgeGen, Nodes& nodes, const Attributes& attrs);
+
+    // Writes/reads the nodes and edges (ids, coordinates and attributes)
+    // to/from a trial checkpoint. loadState() replaces the current ones.
+    bool saveState(QDataStream& out) const;
+    bool loadState(QDataStream& in);
+
+    // Starts (or stops) updating the stateHash() as the nodes change.
+    // The hash is computed from scratch here.
+    void trackStateHash(bool enable);
+
+    // Adds the node into the next activeNodes().
+    void touch(BaseNode* node);
+
+    // Rebuilds the compact topology if nodes or edges have changed.
+    void updateTopology();
+
+    // Reads the attribute of each row (or of each entry's edge if 'edges'
+    // is true) into 'column'. Returns false if they are not numeric.
+    bool gatherColumn(int attrId, bool edges, std::vector<double>& column, int threads) const;
 };
 
 
@@ -270,6 +397,9 @@ inline Node AbstractGraph::node(int nodeId) const
 inline int AbstractGraph::numEdges() const
 { return static_cast<int>(m_edges.size()); }
 
+inline quint64 AbstractGraph::stateHash() const
+{ return m_stateHash; }
+
 inline int AbstractGraph::numNodes() const
 { return static_cast<int>(m_nodes.size()); }
 
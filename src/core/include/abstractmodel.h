@@ -52,6 +52,24 @@ public:
      */
     virtual bool algorithmStep() = 0;
 
+    /**
+     * @brief Performs up to @p n steps at once, as if algorithmStep() was
+     *        called @p n times in a row.
+     *
+     * The engine only grants @p n > 1 steps when nothing needs to look at
+     * the trial in between, ie, no output is due, no flush, pause or stop
+     * point is reached, and the nodes are not being displayed. So, models
+     * with tiny steps can reimplement it to save the per-step overhead.
+     * Note that step() is the first step of the batch and does not change
+     * while this function runs. The default implementation calls
+     * algorithmStep() in a loop and moves step() along, ie, it's exactly
+     * the same as calling algorithmStep() @p n times.
+     * @param steps the number of steps actually performed, in [1, n]
+     * @returns false if the model stopped (ie, algorithmStep() would have
+     *          returned false at the last step performed).
+     */
+    virtual bool algorithmSteps(int n, int& steps) = 0;
+
     /**
      * @brief It is executed after the algorithmStep() loop ends.
      * The default implementation of this function does nothing.
@@ -106,6 +124,12 @@ public:
      */
     int lastStep() const;
 
+    /**
+     * @brief Gets the time between two steps (see GENERAL_ATTR_TIMESTEP).
+     * It is only meaningful for continuous-time models.
+     */
+    double timeStep() const;
+
     //! @copydoc AbstractGraph::nodes
     inline const Nodes& nodes() const;
     //! @copydoc AbstractGraph::node
@@ -121,10 +145,70 @@ public:
     // AbstractModelInterface stuff
     // the default implementation of the functions below do nothing
     inline void beforeLoop() override {}
+    bool algorithmSteps(int n, int& steps) override;
     inline void afterLoop() override {}
     inline Values customOutputs(const Values& inputs) const override
     { Q_UNUSED(inputs); return Values(); }
 
+    /**
+     * @brief Writes the state kept by the model itself into a checkpoint.
+     *
+     * A trial checkpoint already includes the step, the PRG, the nodes and
+     * the edges. Thus, this function only needs to be reimplemented by
+     * models which keep some state in their own members across steps
+     * (eg., a counter or a cache); loadState() must read it back in the
+     * same order. The default implementation does nothing.
+     * @return true if successful.
+     */
+    virtual bool saveState(QDataStream& out) const
+    { Q_UNUSED(out); return true; }
+
+    /**
+     * @brief Restores the state written by saveState().
+     * It is called after a successful init() when a trial is resumed.
+     * The default implementation does nothing.
+     * @return true if successful.
+     */
+    virtual bool loadState(QDataStream& in)
+    { Q_UNUSED(in); return true; }
+
+    /**
+     * @brief Writes the state kept by the model back into the nodes.
+     *
+     * Models are free to keep the nodes' state in a faster structure
+     * (eg., bit-packed cells) during the algorithmStep() loop, as long as
+     * they write it back into the nodes' attributes here. It is called
+     * whenever the attributes are about to be read in the loop, i.e.,
+     * before an output is sampled, before a checkpoint, when the trial
+     * yields its thread and at every step while the trial is displayed.
+     * Such models should also write it back in afterLoop() and read the
+     * attributes again in beforeLoop(), as the user might edit them while
+     * the trial is paused. The default implementation does nothing.
+     */
+    virtual void syncNodes() {}
+
+    /**
+     * @brief Takes over the @p replicas of this trial, so that a single
+     *        algorithmStep() steps all of them in lockstep.
+     *
+     * It's only called when the trials run in groups of replicates (see
+     * GENERAL_ATTR_REPLICATES). The @p replicas are the models of the other
+     * trials of the group, each one already initialized with its own graph
+     * and PRG, ie, the same as if they were run individually. If it returns
+     * true, the algorithmStep(), beforeLoop(), afterLoop() and syncNodes()
+     * of the replicas are never called; those of this model must do it for
+     * all of them, drawing the random numbers of each replica from its own
+     * prg() in the same order as it would alone, so that the outputs of each
+     * trial are identical to an individual run. The replicas stop together,
+     * when this model's algorithmStep() returns false.
+     * Typically, it's worth it for small graphs, where the state of all
+     * replicas can be packed together (eg., one word per node).
+     * The default implementation returns false, ie, the trials of the group
+     * run individually.
+     */
+    virtual bool takeReplicas(const std::vector<AbstractModel*>& replicas)
+    { Q_UNUSED(replicas); return false; }
+
 /**@}*/
 
 protected:
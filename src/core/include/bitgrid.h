@@ -0,0 +1,353 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef BITGRID_H
+#define BITGRID_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include <QtGlobal>
+#include <QtAlgorithms>
+
+namespace evoplex {
+
+/**
+ * @brief A lattice of binary cells packed into 64-bit words.
+ *
+ * It's meant for cellular automata running on a 'squareGrid' graph: the
+ * cells are indexed in the same way (ie, id = row * width + column) and
+ * the neighbourhood is either the von Neumann (4) or the Moore (8) one,
+ * with fixed or periodic boundary conditions. Periodic lattices must have
+ * at least 3 rows and 3 columns.
+ *
+ * Each row keeps its cells in the bits [1, width] and a halo bit at each
+ * side, and there is a halo row above and below the lattice. The halos
+ * hold a copy of the opposite border (periodic) or zeros (fixed), so that
+ * the neighbours of 64 cells at a time are counted with the same
+ * branch-free bitwise adders.
+ */
+class BitGrid
+{
+public:
+    //! Creates an empty lattice.
+    BitGrid() : BitGrid(0, 0, 8, false) {}
+
+    //! Creates a lattice of dead cells.
+    explicit BitGrid(int width, int height, int neighbours, bool periodic);
+
+    inline int width() const { return m_width; }
+    inline int height() const { return m_height; }
+
+    /**
+     * @brief Returns true if the cell @p id is alive.
+     */
+    inline bool cell(int id) const;
+
+    /**
+     * @brief Sets the state of the cell @p id.
+     */
+    inline void setCell(int id, bool live);
+
+    /**
+     * @brief Performs one step of Conway's Game of Life (B3/S23).
+     */
+    void lifeStep();
+
+    /**
+     * @brief Calls @p func(id, live) for each cell which has changed since
+     *        the previous call (or resetChanges()).
+     */
+    template <typename Func>
+    void takeChanges(Func func);
+
+    /**
+     * @brief Takes the current cells as the reference for takeChanges().
+     */
+    inline void resetChanges() { m_taken = m_cells; }
+
+private:
+    int m_width;
+    int m_height;
+    int m_neighbours;
+    bool m_periodic;
+    int m_rowWords; // words in a row, including the halo bits
+
+    std::vector<quint64> m_cells; // 'm_height + 2' rows, halo rows included
+    std::vector<quint64> m_next;
+    std::vector<quint64> m_taken; // see takeChanges()
+    std::vector<quint64> m_mask;  // the bits of a row holding cells
+
+    // copies the borders into the halos (or clears them)
+    void fillHalos();
+
+    template <bool moore>
+    void lifeStep_();
+
+    // adds 'x' to the bit-sliced counter; s2 saturates at 4
+    static inline void add(quint64 x, quint64& s0, quint64& s1, quint64& s2);
+
+    inline bool bit(int row, int col) const;
+    inline void setBit(int row, int col, bool b);
+};
+
+/**
+ * @brief A row of binary cells packed into 64-bit words.
+ *
+ * It's meant for elementary (Wolfram) cellular automata, whose rule is
+ * applied to a whole row at a time with bitwise shifts and masks.
+ * As in BitGrid, the cells are kept in the bits [1, width].
+ */
+class BitRow
+{
+public:
+    //! Creates a row of @p width dead cells.
+    explicit BitRow(int width=0);
+
+    inline int width() const { return m_width; }
+
+    /**
+     * @brief Returns true if the cell @p col is alive.
+     */
+    inline bool cell(int col) const;
+
+    /**
+     * @brief Sets the state of the cell @p col.
+     */
+    inline void setCell(int col, bool live);
+
+    /**
+     * @brief Sets the cells of this row by applying the elementary
+     *        cellular automaton @p rule to the row @p src.
+     *
+     * With periodic boundaries, the first and the last cells are
+     * neighbours. Otherwise, they miss a neighbour at one side, so they
+     * are left untouched.
+     * @warning both rows must have the same width.
+     */
+    void applyRule(const BitRow& src, quint8 rule, bool periodic);
+
+private:
+    int m_width;
+    std::vector<quint64> m_words;
+};
+
+/************************************************************************
+   BitGrid: Inline member functions
+ ************************************************************************/
+
+inline BitGrid::BitGrid(int width, int height, int neighbours, bool periodic)
+    : m_width(width),
+      m_height(height),
+      m_neighbours(neighbours),
+      m_periodic(periodic),
+      m_rowWords((width + 2 + 63) / 64),
+      m_cells(static_cast<size_t>((height + 2) * m_rowWords), 0),
+      m_next(m_cells.size(), 0),
+      m_taken(m_cells.size(), 0),
+      m_mask(static_cast<size_t>(m_rowWords), 0)
+{
+    Q_ASSERT_X(neighbours == 4 || neighbours == 8, "BitGrid", "invalid neighbourhood");
+    Q_ASSERT_X(!periodic || (width >= 3 && height >= 3), "BitGrid", "lattice too small");
+    for (int col = 1; col <= width; ++col) {
+        m_mask[static_cast<size_t>(col / 64)] |= quint64(1) << (col % 64);
+    }
+}
+
+inline bool BitGrid::bit(int row, int col) const
+{ return (m_cells[static_cast<size_t>(row * m_rowWords + col / 64)] >> (col % 64)) & 1; }
+
+inline void BitGrid::setBit(int row, int col, bool b)
+{
+    quint64& w = m_cells[static_cast<size_t>(row * m_rowWords + col / 64)];
+    const quint64 m = quint64(1) << (col % 64);
+    w = b ? (w | m) : (w & ~m);
+}
+
+inline bool BitGrid::cell(int id) const
+{ return bit(id / m_width + 1, id % m_width + 1); }
+
+inline void BitGrid::setCell(int id, bool live)
+{ setBit(id / m_width + 1, id % m_width + 1, live); }
+
+inline void BitGrid::add(quint64 x, quint64& s0, quint64& s1, quint64& s2)
+{
+    const quint64 c0 = s0 & x;
+    s0 ^= x;
+    const quint64 c1 = s1 & c0;
+    s1 ^= c0;
+    s2 |= c1;
+}
+
+inline void BitGrid::fillHalos()
+{
+    const size_t n = static_cast<size_t>(m_rowWords);
+    for (int r = 1; r <= m_height; ++r) {
+        setBit(r, 0, m_periodic && bit(r, m_width));
+        setBit(r, m_width + 1, m_periodic && bit(r, 1));
+    }
+
+    auto top = m_cells.begin();
+    auto bottom = m_cells.begin() + static_cast<std::ptrdiff_t>((m_height + 1) * n);
+    if (m_periodic) {
+        std::copy(bottom - static_cast<std::ptrdiff_t>(n), bottom, top);
+        std::copy(top + static_cast<std::ptrdiff_t>(n), top + static_cast<std::ptrdiff_t>(2 * n), bottom);
+    } else {
+        std::fill(top, top + static_cast<std::ptrdiff_t>(n), 0);
+        std::fill(bottom, bottom + static_cast<std::ptrdiff_t>(n), 0);
+    }
+}
+
+inline void BitGrid::lifeStep()
+{
+    if (m_width < 1 || m_height < 1) {
+        return;
+    }
+    fillHalos();
+    if (m_neighbours == 8) {
+        lifeStep_<true>();
+    } else {
+        lifeStep_<false>();
+    }
+    m_cells.swap(m_next);
+}
+
+template <bool moore>
+inline void BitGrid::lifeStep_()
+{
+    const int n = m_rowWords;
+    // the cells at the left (west) and at the right (east) of each bit
+    auto west = [](const quint64* row, int k) {
+        return (row[k] << 1) | (k > 0 ? row[k-1] >> 63 : 0);
+    };
+    auto east = [n](const quint64* row, int k) {
+        return (row[k] >> 1) | (k + 1 < n ? row[k+1] << 63 : 0);
+    };
+
+    for (int r = 1; r <= m_height; ++r) {
+        const quint64* above = &m_cells[static_cast<size_t>((r - 1) * n)];
+        const quint64* curr = above + n;
+        const quint64* below = curr + n;
+        quint64* out = &m_next[static_cast<size_t>(r * n)];
+        for (int k = 0; k < n; ++k) {
+            quint64 s0 = 0, s1 = 0, s2 = 0;
+            add(above[k], s0, s1, s2);
+            add(below[k], s0, s1, s2);
+            add(west(curr, k), s0, s1, s2);
+            add(east(curr, k), s0, s1, s2);
+            if (moore) {
+                add(west(above, k), s0, s1, s2);
+                add(east(above, k), s0, s1, s2);
+                add(west(below, k), s0, s1, s2);
+                add(east(below, k), s0, s1, s2);
+            }
+            // two live neighbours keep a live cell alive; three give birth
+            out[k] = s1 & ~s2 & (s0 | curr[k]) & m_mask[static_cast<size_t>(k)];
+        }
+    }
+}
+
+template <typename Func>
+inline void BitGrid::takeChanges(Func func)
+{
+    const size_t n = static_cast<size_t>(m_rowWords);
+    for (int r = 1; r <= m_height; ++r) {
+        for (size_t k = 0; k < n; ++k) {
+            const size_t i = static_cast<size_t>(r) * n + k;
+            quint64 diff = (m_cells[i] ^ m_taken[i]) & m_mask[k];
+            while (diff) {
+                const int b = static_cast<int>(qCountTrailingZeroBits(diff));
+                func((r - 1) * m_width + static_cast<int>(k) * 64 + b - 1,
+                     static_cast<bool>((m_cells[i] >> b) & 1));
+                diff &= diff - 1;
+            }
+        }
+    }
+    m_taken = m_cells;
+}
+
+/************************************************************************
+   BitRow: Inline member functions
+ ************************************************************************/
+
+inline BitRow::BitRow(int width)
+    : m_width(width),
+      m_words(static_cast<size_t>((width + 2 + 63) / 64), 0)
+{
+}
+
+inline bool BitRow::cell(int col) const
+{ return (m_words[static_cast<size_t>((col + 1) / 64)] >> ((col + 1) % 64)) & 1; }
+
+inline void BitRow::setCell(int col, bool live)
+{
+    quint64& w = m_words[static_cast<size_t>((col + 1) / 64)];
+    const quint64 m = quint64(1) << ((col + 1) % 64);
+    w = live ? (w | m) : (w & ~m);
+}
+
+inline void BitRow::applyRule(const BitRow& src, quint8 rule, bool periodic)
+{
+    Q_ASSERT_X(src.m_width == m_width, "BitRow::applyRule", "rows must have the same width");
+    if (m_width < 1) {
+        return;
+    }
+
+    const int n = static_cast<int>(m_words.size());
+    const quint64* s = src.m_words.data();
+    // the word and bit of the first and the last cells
+    const int lastWord = m_width / 64;
+    const int lastBit = m_width % 64;
+    const int first = periodic ? 1 : 2;
+    const int last = periodic ? m_width : m_width - 1;
+
+    for (int k = 0; k < n; ++k) {
+        // the cells at the left and at the right of each bit
+        quint64 l = (s[k] << 1) | (k > 0 ? s[k-1] >> 63 : 0);
+        quint64 r = (s[k] >> 1) | (k + 1 < n ? s[k+1] << 63 : 0);
+        if (periodic) {
+            // the halo bits are always zero; wraps the borders around
+            if (k == 0 && src.cell(m_width - 1)) {
+                l |= quint64(1) << 1;
+            }
+            if (k == lastWord && src.cell(0)) {
+                r |= quint64(1) << lastBit;
+            }
+        }
+
+        // the union of the neighbourhoods (left, center, right) mapped to 1
+        quint64 next = 0;
+        for (int p = 0; p < 8; ++p) {
+            if ((rule >> p) & 1) {
+                next |= ((p & 4) ? l : ~l) & ((p & 2) ? s[k] : ~s[k]) & ((p & 1) ? r : ~r);
+            }
+        }
+
+        // the bits [first, last] which are set here
+        quint64 mask = 0;
+        const int lo = std::max(first, k * 64);
+        const int hi = std::min(last, k * 64 + 63);
+        if (lo <= hi) {
+            const int len = hi - lo + 1;
+            mask = (len == 64 ? ~quint64(0) : ((quint64(1) << len) - 1)) << (lo - k * 64);
+        }
+        m_words[static_cast<size_t>(k)] = (m_words[static_cast<size_t>(k)] & ~mask) | (next & mask);
+    }
+}
+
+} // evoplex
+#endif // BITGRID_H
@@ -57,15 +57,38 @@
 #define GENERAL_ATTR_GRAPHTYPE "graphType"
 //! a command to AttrsGenerator
 #define GENERAL_ATTR_EDGEATTRS "edgeAttrs"
+//! n>0 to stop a trial as soon as its nodes' state repeats within the last
+//! n steps (ie, a fixed point or a cycle); 0 to disable it (default)
+#define GENERAL_ATTR_CYCLEWINDOW "cycleWindow"
+//! true to fill the outputs of the steps skipped by GENERAL_ATTR_CYCLEWINDOW
+//! by repeating the cycle up to 'stopAt'; false otherwise (default)
+#define GENERAL_ATTR_CYCLEFILL "cycleFill"
+//! the (continuous) time between two steps of an event-driven model, ie,
+//! how often it is sampled; see AbstractEventModel. 1.0 by default
+#define GENERAL_ATTR_TIMESTEP "timeStep"
+//! k>1 to run the trials in groups of k replicates, stepped in lockstep by
+//! a single thread (see AbstractModel::takeReplicas()); 1 by default
+#define GENERAL_ATTR_REPLICATES "replicates"
 
 //! path to the directory in which the file will be saved
 #define OUTPUT_DIR "outputDirectory"
-//! 1 to indicate if the output should be done across all trials; 0 otherwise
+//! true to also write a summary file with the statistics across all trials
+//! (count, mean, std and quartiles) of each step; false otherwise (default)
 #define OUTPUT_AVGTRIALS "outputAvgTrials"
 //! valid header
 #define OUTPUT_HEADER "outputHeader"
 //! n=0 to save all steps; n>0 to save the last n steps
 #define OUTPUT_SAVESTEPS "outputSaveSteps"
+//! 'trial' to write one file per trial (default); 'experiment' or 'project'
+//! to write all trials of an experiment or project into a single file;
+//! 'none' to write only the summary file (see OUTPUT_AVGTRIALS)
+#define OUTPUT_FILEMODE "outputFileMode"
+//! memory ceiling (MB) for the output rows waiting to be read; 0 for no limit
+#define OUTPUT_MEMLIMIT "outputMemoryLimit"
+//! what trials do when the OUTPUT_MEMLIMIT is reached: 'flush', 'block' or 'spill'
+#define OUTPUT_MEMPOLICY "outputMemoryPolicy"
+//! interval (seconds) between the checkpoints of each trial; 0 to disable them (default)
+#define OUTPUT_CHECKPOINT "checkpointInterval"
 
 /******************************************************************************
     Plugin stuff
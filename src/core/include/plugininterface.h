@@ -22,6 +22,8 @@
 
 #include "abstractgraph.h"
 #include "abstractmodel.h"
+#include "abstractasyncmodel.h"
+#include "abstracteventmodel.h"
 
 namespace evoplex {
 
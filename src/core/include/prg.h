@@ -17,7 +17,10 @@
 #ifndef PRG_H
 #define PRG_H
 
+#include <cstdint>
 #include <random>
+#include <string>
+#include <utility>
 
 namespace evoplex {
 
@@ -41,6 +44,19 @@ public:
     inline unsigned int seed() const
     { return m_seed; }
 
+    /**
+     * @brief Gets the current state of the engine.
+     * The sequence can be continued later (eg., in another process) by
+     * passing the state to setState().
+     */
+    std::string state() const;
+
+    /**
+     * @brief Restores a state returned by state().
+     * @return false if @p state is invalid; the engine is left untouched.
+     */
+    bool setState(const std::string& state);
+
     /**
      * @brief Bernoulli distribution.
      * It generates a random boolean according to the discrete probability
@@ -100,6 +116,22 @@ public:
     inline double uniform()
     { return m_doubleZeroOne(m_mteng); }
 
+    /**
+     * @brief Generates a random index [0, n), with @p n > 0.
+     * Unlike uniform(int), it does not build a distribution at each call,
+     * so it is meant for hot loops (eg., picking random nodes). It's
+     * unbiased (Lemire's multiply-and-reject).
+     */
+    inline uint32_t index(uint32_t n);
+
+    /**
+     * @brief Shuffles the range [@p first, @p last) (Fisher-Yates).
+     * Unlike std::shuffle, the permutation does not depend on the
+     * standard library implementation.
+     */
+    template <typename RandomIt>
+    void shuffle(RandomIt first, RandomIt last);
+
     /**
      * @brief Uniform continuous distribution for random numbers.
      */
@@ -121,5 +153,33 @@ private:
     std::bernoulli_distribution m_bernoulli;
 };
 
+/************************************************************************
+   PRG: Inline member functions
+ ************************************************************************/
+
+inline uint32_t PRG::index(uint32_t n)
+{
+    uint64_t m = static_cast<uint64_t>(static_cast<uint32_t>(m_mteng())) * n;
+    uint32_t low = static_cast<uint32_t>(m);
+    if (low < n) {
+        const uint32_t threshold = (0u - n) % n;
+        while (low < threshold) {
+            m = static_cast<uint64_t>(static_cast<uint32_t>(m_mteng())) * n;
+            low = static_cast<uint32_t>(m);
+        }
+    }
+    return static_cast<uint32_t>(m >> 32);
+}
+
+template <typename RandomIt>
+void PRG::shuffle(RandomIt first, RandomIt last)
+{
+    using std::swap;
+    const auto n = last - first;
+    for (auto i = n - 1; i > 0; --i) {
+        swap(first[i], first[index(static_cast<uint32_t>(i + 1))]);
+    }
+}
+
 } // evoplex
 #endif // PRG_H
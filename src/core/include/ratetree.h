@@ -0,0 +1,139 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef RATETREE_H
+#define RATETREE_H
+
+#include <vector>
+#include <QtGlobal>
+
+namespace evoplex {
+
+/**
+ * @brief A sum tree of non-negative rates, for rejection-free sampling.
+ *
+ * It picks an index with probability proportional to its rate, and
+ * updates a rate, in O(log n). Each inner node holds the sum of its
+ * children, recomputed on every update, so the sums do not drift as
+ * they would with incremental (Fenwick) updates.
+ */
+class RateTree
+{
+public:
+    //! Creates a tree of @p size zero rates.
+    explicit RateTree(int size=0);
+
+    /**
+     * @brief Replaces all the rates; it's O(n).
+     */
+    void assign(const std::vector<double>& rates);
+
+    inline int size() const;
+
+    /**
+     * @brief Gets the sum of all rates.
+     */
+    inline double total() const;
+
+    /**
+     * @brief Gets the rate of @p i.
+     */
+    inline double rate(int i) const;
+
+    /**
+     * @brief Sets the rate of @p i; negative rates are taken as zero.
+     */
+    inline void update(int i, double rate);
+
+    /**
+     * @brief Finds the index whose cumulative rate interval holds @p u.
+     * @param u A value in [0, total()), eg, total() * PRG::uniform().
+     * @return An index with a positive rate; -1 if total() is zero.
+     */
+    inline int find(double u) const;
+
+private:
+    int m_size;
+    int m_leaves; // a power of two >= m_size
+    std::vector<double> m_tree; // 1 is the root; the children of i are 2i and 2i+1
+};
+
+/************************************************************************
+   RateTree: Inline member functions
+ ************************************************************************/
+
+inline RateTree::RateTree(int size)
+    : m_size(size),
+      m_leaves(1)
+{
+    while (m_leaves < size) {
+        m_leaves *= 2;
+    }
+    m_tree.assign(static_cast<size_t>(2 * m_leaves), 0.0);
+}
+
+inline void RateTree::assign(const std::vector<double>& rates)
+{
+    *this = RateTree(static_cast<int>(rates.size()));
+    for (size_t i = 0; i < rates.size(); ++i) {
+        m_tree[static_cast<size_t>(m_leaves) + i] = qMax(0.0, rates[i]);
+    }
+    for (int i = m_leaves - 1; i > 0; --i) {
+        m_tree[static_cast<size_t>(i)] = m_tree[static_cast<size_t>(2*i)] + m_tree[static_cast<size_t>(2*i+1)];
+    }
+}
+
+inline int RateTree::size() const
+{ return m_size; }
+
+inline double RateTree::total() const
+{ return m_tree[1]; }
+
+inline double RateTree::rate(int i) const
+{ return m_tree[static_cast<size_t>(m_leaves + i)]; }
+
+inline void RateTree::update(int i, double rate)
+{
+    Q_ASSERT_X(i >= 0 && i < m_size, "RateTree::update", "index out of range");
+    size_t k = static_cast<size_t>(m_leaves + i);
+    m_tree[k] = qMax(0.0, rate);
+    for (k /= 2; k > 0; k /= 2) {
+        m_tree[k] = m_tree[2*k] + m_tree[2*k+1];
+    }
+}
+
+inline int RateTree::find(double u) const
+{
+    if (m_tree[1] <= 0.0) {
+        return -1;
+    }
+    size_t k = 1;
+    while (k < static_cast<size_t>(m_leaves)) {
+        const double left = m_tree[2*k];
+        // a rounding error must not lead us to an empty subtree
+        if (u < left || m_tree[2*k+1] <= 0.0) {
+            k = 2*k;
+        } else {
+            u -= left;
+            k = 2*k + 1;
+        }
+    }
+    return static_cast<int>(k) - m_leaves;
+}
+
+} // evoplex
+#endif // RATETREE_H
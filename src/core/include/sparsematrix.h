@@ -0,0 +1,98 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SPARSEMATRIX_H
+#define SPARSEMATRIX_H
+
+#include <vector>
+#include <QtGlobal>
+
+namespace evoplex {
+
+/**
+ * @brief A square sparse matrix in the compressed sparse row (CSR) format.
+ *
+ * The entries of row @c i are columns()[k] and values()[k] for @c k in
+ * [offsets()[i], offsets()[i+1]). It's meant for linear network dynamics
+ * (eg., DeGroot, diffusion, random walks), where a step is one
+ * matrix-vector product; see AbstractGraph::adjacency().
+ * @ingroup PublicAPI
+ */
+class SparseMatrix
+{
+public:
+    //! Creates an empty (0x0) matrix.
+    SparseMatrix();
+
+    /**
+     * @brief Creates a @p size x @p size matrix from its CSR arrays.
+     * @p offsets must have size+1 non-decreasing entries, starting at 0
+     * and ending at the number of entries of @p columns and @p values.
+     */
+    SparseMatrix(int size, std::vector<int> offsets,
+                 std::vector<int> columns, std::vector<double> values);
+
+    //! Gets the number of rows (and columns).
+    inline int size() const;
+    //! Gets the number of stored entries.
+    inline int numEntries() const;
+
+    inline const std::vector<int>& offsets() const;
+    inline const std::vector<int>& columns() const;
+    inline const std::vector<double>& values() const;
+
+    /**
+     * @brief Computes @p y = A @p x.
+     * The rows are split across @p threads (1 by default, ie, the calling
+     * thread only). @p y is resized to size(); it must not be @p x.
+     */
+    void multiply(const std::vector<double>& x, std::vector<double>& y, int threads=1) const;
+
+    /**
+     * @brief Gets the transpose of this matrix; it's O(entries).
+     * Within each row, the entries keep the order of the original rows.
+     */
+    SparseMatrix transposed() const;
+
+private:
+    int m_size;
+    std::vector<int> m_offsets;
+    std::vector<int> m_columns;
+    std::vector<double> m_values;
+};
+
+/************************************************************************
+   SparseMatrix: Inline member functions
+ ************************************************************************/
+
+inline int SparseMatrix::size() const
+{ return m_size; }
+
+inline int SparseMatrix::numEntries() const
+{ return static_cast<int>(m_columns.size()); }
+
+inline const std::vector<int>& SparseMatrix::offsets() const
+{ return m_offsets; }
+
+inline const std::vector<int>& SparseMatrix::columns() const
+{ return m_columns; }
+
+inline const std::vector<double>& SparseMatrix::values() const
+{ return m_values; }
+
+} // evoplex
+#endif // SPARSEMATRIX_H
@@ -17,6 +17,9 @@
 #ifndef STATS_H
 #define STATS_H
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 #include "attributes.h"
@@ -61,5 +64,159 @@ public:
     }
 };
 
+/**
+ * @brief Streaming mean and variance (Welford's algorithm).
+ *
+ * The observations are folded one at a time, in constant memory and
+ * without the loss of precision of the naive sum of squares.
+ */
+class RunningStats
+{
+public:
+    RunningStats() : m_count(0), m_mean(0.), m_m2(0.) {}
+
+    //! Adds an observation.
+    inline void add(double x)
+    {
+        ++m_count;
+        const double delta = x - m_mean;
+        m_mean += delta / m_count;
+        m_m2 += delta * (x - m_mean);
+    }
+
+    //! Number of observations.
+    inline size_t count() const { return m_count; }
+    //! Mean of the observations; NaN if there are none.
+    inline double mean() const
+    { return m_count ? m_mean : std::numeric_limits<double>::quiet_NaN(); }
+    //! Sample variance; 0 if there are less than two observations.
+    inline double variance() const
+    { return m_count > 1 ? m_m2 / (m_count - 1) : 0.; }
+    //! Sample standard deviation.
+    inline double stdev() const { return std::sqrt(variance()); }
+
+private:
+    size_t m_count;
+    double m_mean;
+    double m_m2;
+};
+
+/**
+ * @brief Streaming estimate of the p-quantile (P-square algorithm).
+ *
+ * It keeps only five markers, whose heights are adjusted with a piecewise
+ * parabolic formula as the observations arrive. See Jain and Chlamtac, "The
+ * P2 algorithm for dynamic calculation of quantiles and histograms without
+ * storing observations", Communications of the ACM, 1985.
+ *
+ * With less than five observations, the exact quantile is returned.
+ */
+class P2Quantile
+{
+public:
+    //! @param p the quantile to be estimated, in [0,1]; eg., 0.5 for the median
+    explicit P2Quantile(double p) : m_p(p), m_count(0) {}
+
+    //! Adds an observation.
+    inline void add(double x);
+
+    //! Number of observations.
+    inline size_t count() const { return m_count; }
+    //! Current estimate of the quantile; NaN if there are no observations.
+    inline double value() const;
+
+private:
+    double m_p;
+    size_t m_count;
+    double m_q[5];  // markers' heights
+    double m_n[5];  // markers' actual positions
+    double m_np[5]; // markers' desired positions
+    double m_dn[5]; // increments of the desired positions
+
+    inline double parabolic(int i, double d) const;
+    inline double linear(int i, int d) const;
+};
+
+/************************************************************************
+   P2Quantile: Inline member functions
+ ************************************************************************/
+
+inline void P2Quantile::add(double x)
+{
+    if (m_count < 5) {
+        m_q[m_count++] = x;
+        if (m_count == 5) {
+            std::sort(m_q, m_q + 5);
+            for (int i = 0; i < 5; ++i) {
+                m_n[i] = i + 1;
+            }
+            m_np[0] = 1.; m_np[1] = 1. + 2.*m_p; m_np[2] = 1. + 4.*m_p; m_np[3] = 3. + 2.*m_p; m_np[4] = 5.;
+            m_dn[0] = 0.; m_dn[1] = m_p / 2.; m_dn[2] = m_p; m_dn[3] = (1. + m_p) / 2.; m_dn[4] = 1.;
+        }
+        return;
+    }
+
+    // find the cell k such that q[k] <= x < q[k+1]
+    int k;
+    if (x < m_q[0]) {
+        m_q[0] = x;
+        k = 0;
+    } else if (x >= m_q[4]) {
+        m_q[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (x >= m_q[k+1]) ++k;
+    }
+
+    for (int i = k + 1; i < 5; ++i) {
+        m_n[i] += 1.;
+    }
+    for (int i = 0; i < 5; ++i) {
+        m_np[i] += m_dn[i];
+    }
+    ++m_count;
+
+    // adjust the heights of the middle markers if they are off their positions
+    for (int i = 1; i < 4; ++i) {
+        const double d = m_np[i] - m_n[i];
+        if ((d >= 1. && m_n[i+1] - m_n[i] > 1.) || (d <= -1. && m_n[i-1] - m_n[i] < -1.)) {
+            const int ds = d > 0. ? 1 : -1;
+            const double q = parabolic(i, ds);
+            m_q[i] = (m_q[i-1] < q && q < m_q[i+1]) ? q : linear(i, ds);
+            m_n[i] += ds;
+        }
+    }
+}
+
+inline double P2Quantile::value() const
+{
+    if (m_count == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    } else if (m_count >= 5) {
+        return m_q[2];
+    }
+    // exact quantile (linear interpolation) of the few observations
+    double q[5];
+    std::copy(m_q, m_q + m_count, q);
+    std::sort(q, q + m_count);
+    const double pos = m_p * (m_count - 1);
+    const size_t lo = static_cast<size_t>(pos);
+    const size_t hi = std::min(lo + 1, m_count - 1);
+    return q[lo] + (pos - lo) * (q[hi] - q[lo]);
+}
+
+inline double P2Quantile::parabolic(int i, double d) const
+{
+    return m_q[i] + d / (m_n[i+1] - m_n[i-1])
+            * ((m_n[i] - m_n[i-1] + d) * (m_q[i+1] - m_q[i]) / (m_n[i+1] - m_n[i])
+             + (m_n[i+1] - m_n[i] - d) * (m_q[i] - m_q[i-1]) / (m_n[i] - m_n[i-1]));
+}
+
+inline double P2Quantile::linear(int i, int d) const
+{
+    return m_q[i] + d * (m_q[i+d] - m_q[i]) / (m_n[i+d] - m_n[i]);
+}
+
 }
 #endif // STATS_H
@@ -21,6 +21,8 @@
 #include <vector>
 #include <QString>
 
+class QDataStream;
+
 namespace evoplex {
 
 class Value;
@@ -308,6 +310,17 @@ inline quint32 Value::toUInt() const {
     throw throwError();
 }
 
+/**
+ * @brief Writes the Value \p v (type and data) to the stream \p out.
+ * It is a compact binary format meant for checkpoints and temporary files.
+ */
+QDataStream& operator<<(QDataStream& out, const Value& v);
+
+/**
+ * @brief Reads a Value written by operator<<() from the stream \p in.
+ */
+QDataStream& operator>>(QDataStream& in, Value& v);
+
 } // evoplex
 
 
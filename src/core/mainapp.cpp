@@ -80,7 +80,23 @@ MainApp::MainApp()
 
     addAttrScope(id, OUTPUT_DIR, "string");
     addAttrScope(id, OUTPUT_HEADER, "string");
-    // FIXME: addAttrScope(id, OUTPUT_AVGTRIALS, "bool");
+
+    // optional attributes, ie., they take a default value when missing
+    auto addOptionalAttrScope = [this, addAttrScope](int& id, const QString& name,
+            const QString& attrRangeStr, const Value& defaultValue) {
+        addAttrScope(id, name, attrRangeStr);
+        m_generalAttrsDefaults.insert(name, defaultValue);
+    };
+    addOptionalAttrScope(id, GENERAL_ATTR_CYCLEWINDOW, "int[0,100000]", Value(0));
+    addOptionalAttrScope(id, GENERAL_ATTR_CYCLEFILL, "bool", Value(false));
+    // for doubles, 'min' is the smallest positive value, ie, it must be > 0
+    addOptionalAttrScope(id, GENERAL_ATTR_TIMESTEP, "double[min,max]", Value(1.0));
+    addOptionalAttrScope(id, GENERAL_ATTR_REPLICATES, "int[1,64]", Value(1));
+    addOptionalAttrScope(id, OUTPUT_FILEMODE, "string{trial,experiment,project,none}", Value("trial"));
+    addOptionalAttrScope(id, OUTPUT_AVGTRIALS, "bool", Value(false));
+    addOptionalAttrScope(id, OUTPUT_MEMLIMIT, "int[0,1048576]", Value(1024));
+    addOptionalAttrScope(id, OUTPUT_MEMPOLICY, "string{flush,block,spill}", Value("flush"));
+    addOptionalAttrScope(id, OUTPUT_CHECKPOINT, "int[0,86400]", Value(0));
 
     QStringList searchPaths;
     searchPaths << qApp->applicationDirPath() + "/lib/evoplex/plugins";
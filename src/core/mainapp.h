@@ -88,6 +88,8 @@ public:
     ProjectPtr project(int projId) const;
 
     inline const AttributesScope& generalAttrsScope() const;
+    // default values of the optional general attributes
+    inline const QHash<QString, Value>& generalAttrsDefaults() const;
 
     void addPathToRecentProjects(const QString& projectFilePath);
 
@@ -148,6 +150,7 @@ private:
     // let's build a hash with the name and attrRange of the essential attributes
     // it is important to validate the contents of csv files
     AttributesScope m_generalAttrsScope;
+    QHash<QString, Value> m_generalAttrsDefaults;
 };
 
 /************************************************************************
@@ -181,5 +184,8 @@ inline const std::map<int, ProjectPtr>& MainApp::projects() const
 inline const AttributesScope& MainApp::generalAttrsScope() const
 { return m_generalAttrsScope; }
 
+inline const QHash<QString, Value>& MainApp::generalAttrsDefaults() const
+{ return m_generalAttrsDefaults; }
+
 } // evoplex
 #endif // MAINAPP_H
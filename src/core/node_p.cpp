@@ -24,7 +24,11 @@ BaseNode::BaseNode(const constructor_key&, int id, const Attributes& attrs, floa
     : m_id(id),
       m_attrs(attrs),
       m_x(x),
-      m_y(y)
+      m_y(y),
+      m_stateHash(nullptr),
+      m_changedNodes(nullptr),
+      m_changed(false),
+      m_activeStamp(0)
 {
 }
 
@@ -35,6 +39,15 @@ BaseNode::~BaseNode()
 {
 }
 
+quint64 BaseNode::stateKeys() const
+{
+    quint64 keys = 0;
+    for (int id = 0; id < m_attrs.size(); ++id) {
+        keys ^= stateKey(id, m_attrs.value(id));
+    }
+    return keys;
+}
+
 Node BaseNode::randNeighbour(PRG* prg) const
 {
     if (m_outEdges.empty()) {
@@ -18,6 +18,7 @@
 #define NODE_P_H
 
 #include <memory>
+#include <vector>
 
 #include "attributes.h"
 #include "edges.h"
@@ -152,6 +153,17 @@ protected:
      */
     struct constructor_key { };
 
+    /**
+     * @brief Gets a Zobrist-like key of the attribute @p attrId holding
+     * @p value in this node. The state hash of a graph is the XOR of the
+     * keys of all attributes of all nodes.
+     */
+    inline quint64 stateKey(int attrId, const Value& value) const;
+    /**
+     * @brief Gets the XOR of the keys of all attributes of this node.
+     */
+    quint64 stateKeys() const;
+
     explicit BaseNode(const constructor_key&, int id, const Attributes& attrs, float x, float y);
     explicit BaseNode(const constructor_key& k, int id, const Attributes& attr);
     ~BaseNode() override;
@@ -161,6 +173,12 @@ private:
     Attributes m_attrs;
     float m_x;
     float m_y;
+    quint64* m_stateHash; // the graph's state hash; null if it's not tracked
+
+    // see AbstractGraph::activeNodes()
+    std::vector<int>* m_changedNodes; // the graph's changed nodes; null if it's not tracked
+    bool m_changed;        // true if it's in 'm_changedNodes'
+    quint32 m_activeStamp; // the last call of activeNodes() which has taken this node
 };
 
 /**
@@ -233,7 +251,26 @@ inline Value BaseNode::attr(const QString& name, Value defaultValue) const
 { return m_attrs.value(name, defaultValue); }
 
 inline void BaseNode::setAttr(int id, const Value& value)
-{ m_attrs.setValue(id, value); }
+{
+    if (m_stateHash) {
+        *m_stateHash ^= stateKey(id, m_attrs.value(id)) ^ stateKey(id, value);
+    }
+    if (m_changedNodes && !m_changed && m_attrs.value(id) != value) {
+        m_changed = true;
+        m_changedNodes->emplace_back(m_id);
+    }
+    m_attrs.setValue(id, value);
+}
+
+inline quint64 BaseNode::stateKey(int attrId, const Value& value) const
+{
+    // splitmix64 finalizer; it spreads the bits of (node, attr, value)
+    quint64 k = (static_cast<quint64>(static_cast<quint32>(m_id)) << 32)
+              ^ static_cast<quint32>(attrId) ^ (std::hash<Value>()(value) * 0x9E3779B97F4A7C15ULL);
+    k = (k ^ (k >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    k = (k ^ (k >> 27)) * 0x94D049BB133111EBULL;
+    return k ^ (k >> 31);
+}
 
 inline int BaseNode::id() const
 { return m_id; }
@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <QDataStream>
 #include <QDebug>
 #include <QStringList>
 
@@ -24,13 +28,104 @@
 namespace evoplex
 {
 
+namespace {
+// maximum number of rows loaded back from a spill file at once
+const int kSpillChunk = 256;
+} // namespace
+
+const QChar SamplingPolicy::kSeparator('@');
+
+SamplingPolicy::SamplingPolicy(Type type, int n)
+    : m_type(type),
+      m_n(n)
+{
+    Q_ASSERT_X(m_n > 0, "SamplingPolicy", "n must be positive");
+}
+
+SamplingPolicy SamplingPolicy::fromString(const QString& str, QString& error)
+{
+    const QStringList parts = str.split(':');
+    const QString& name = parts.first();
+    if (parts.size() == 1) {
+        if (name == "onchange") return SamplingPolicy(Type::OnChange);
+        if (name == "last") return SamplingPolicy(Type::LastStep);
+    } else if (parts.size() == 2) {
+        bool ok = false;
+        const int n = parts.at(1).toInt(&ok);
+        if (ok && n > 0) {
+            if (name == "stride") return SamplingPolicy(Type::Stride, n);
+            if (name == "log") return SamplingPolicy(Type::LogSpaced, n);
+        }
+    }
+    error = QString("invalid sampling policy '%1'. Expected 'stride:n', "
+                    "'log:n', 'onchange' or 'last' (n > 0).").arg(str);
+    return SamplingPolicy();
+}
+
+bool SamplingPolicy::isDue(const int step) const
+{
+    switch (m_type) {
+    case Type::EveryStep:
+    case Type::OnChange:
+        return true;
+    case Type::Stride:
+        return step % m_n == 0;
+    case Type::LogSpaced:
+        // n points per decade; ie, the steps in which floor(n*log10(step)) changes
+        if (step < 2) return true;
+        return std::floor(m_n * std::log10(step)) > std::floor(m_n * std::log10(step - 1));
+    case Type::LastStep:
+        return false;
+    }
+    return true;
+}
+
+int SamplingPolicy::nextDue(const int step) const
+{
+    switch (m_type) {
+    case Type::EveryStep:
+    case Type::OnChange:
+        return step + 1;
+    case Type::Stride:
+        return (step / m_n + 1) * m_n;
+    case Type::LogSpaced: {
+        if (step < 1) return step + 1;
+        // the first step of the next 1/n decade; the loops only fix rounding
+        const double k = std::floor(m_n * std::log10(step)) + 1;
+        int next = std::max(step + 1, static_cast<int>(std::ceil(std::pow(10.0, k / m_n))));
+        while (next > step + 1 && isDue(next - 1)) --next;
+        while (!isDue(next)) ++next;
+        return next;
+    }
+    case Type::LastStep:
+        return std::numeric_limits<int>::max();
+    }
+    return step + 1;
+}
+
+QString SamplingPolicy::toString() const
+{
+    switch (m_type) {
+    case Type::Stride: return QString("stride:%1").arg(m_n);
+    case Type::LogSpaced: return QString("log:%1").arg(m_n);
+    case Type::OnChange: return "onchange";
+    case Type::LastStep: return "last";
+    default: return "";
+    }
+}
+
+/*******************************************************/
+/*******************************************************/
+
+const Value Cache::kInvalid;
+
 Cache::Cache(const Values& inputs, const std::vector<int>& trialIds, OutputPtr parent)
     : m_parent(parent)
     , m_inputs(inputs)
 {
     Q_ASSERT_X(!m_inputs.empty(), "Cache", "inputs cannot be empty");
     for (int trialId : trialIds) {
-        m_trials.insert({trialId, Data()});
+        m_cursors.insert({trialId, 0});
     }
 }
 
@@ -41,11 +136,38 @@ void Cache::deleteCache()
 
 bool Cache::isEmpty(const int trialId) const
 {
-    std::unordered_map<int, Data>::const_iterator trial = m_trials.find(trialId);
-    if (trial != m_trials.end()) {
-        return trial->second.rows.empty();
+    auto cursor = m_cursors.find(trialId);
+    if (cursor == m_cursors.end()) {
+        return true;
+    }
+    Output::Rows& r = m_parent->m_rows.at(trialId);
+    QMutexLocker locker(&r.mutex);
+    return cursor->second >= r.end();
+}
+
+const Cache::Row& Cache::readFrontRow(const int trialId) const
+{
+    Output::Rows& r = m_parent->m_rows.at(trialId);
+    QMutexLocker locker(&r.mutex);
+    const quint64 cursor = m_cursors.at(trialId);
+    Q_ASSERT_X(cursor >= r.first && cursor < r.end(), "Cache", "there are no rows to be read");
+    while (cursor >= r.first + r.rows.size()) {
+        m_parent->loadSpilledRows(r);
+    }
+    // deque::push_back does not invalidate references to the other rows,
+    // and this one will not be released until we move the cursor
+    return r.rows[cursor - r.first];
+}
+
+void Cache::flushFrontRow(const int trialId)
+{
+    Output::Rows& r = m_parent->m_rows.at(trialId);
+    QMutexLocker locker(&r.mutex);
+    quint64& cursor = m_cursors.at(trialId);
+    if (cursor < r.end()) {
+        ++cursor;
+        m_parent->releaseRows(trialId, r);
     }
-    return false;
 }
 
 QString Cache::printableHeader(const char sep, const bool joinInputs) const
@@ -56,16 +178,20 @@ QString Cache::printableHeader(const char sep, const bool joinInputs) const
 
 void Cache::flushAll()
 {
-    for (auto& it : m_trials) {
-        it.second.rows.clear();
+    for (auto& it : m_cursors) {
+        Output::Rows& r = m_parent->m_rows.at(it.first);
+        QMutexLocker locker(&r.mutex);
+        it.second = r.end();
+        m_parent->releaseRows(it.first, r);
     }
 }
 
 /*******************************************************/
 /*******************************************************/
 
-DefaultOutput::DefaultOutput(Function f, Entity e, AttributeRangePtr attrRange)
-    : Output()
+DefaultOutput::DefaultOutput(Function f, Entity e, AttributeRangePtr attrRange,
+                             const SamplingPolicy& sampling)
+    : Output(sampling)
     , m_func(f)
     , m_entity(e)
     , m_attrRange(attrRange)
@@ -76,25 +202,18 @@ DefaultOutput::DefaultOutput(Function f, Entity e, AttributeRangePtr attrRange)
                         m_attrRange->attrName());
 }
 
-void DefaultOutput::doOperation(const Trial* trial)
+Values DefaultOutput::compute(const Trial* trial, const Values& inputs) const
 {
-    if (m_allTrialIds.find(trial->id()) == m_allTrialIds.end()) {
-        return;
-    }
-
-    Values allValues;
     switch (m_func) {
     case F_Count:
         if (m_entity == E_Nodes) {
-            allValues = Stats::count(trial->graph()->nodes(), m_attrRange->id(), m_allInputs);
-        } else {
-            allValues = Stats::count(trial->graph()->edges(), m_attrRange->id(), m_allInputs);
+            return Stats::count(trial->graph()->nodes(), m_attrRange->id(), inputs);
         }
-        break;
+        return Stats::count(trial->graph()->edges(), m_attrRange->id(), inputs);
     default:
         qFatal("invalid function!");
     }
-    updateCaches(trial->id(), trial->step(), allValues);
+    return Values();
 }
 
 bool DefaultOutput::operator==(const OutputPtr output) const
@@ -104,32 +223,34 @@ bool DefaultOutput::operator==(const OutputPtr output) const
     if (m_func != other->function()) return false;
     if (m_entity != other->entity()) return false;
     if (m_attrRange->id() != other->attrRange()->id()) return false;
+    if (m_sampling != other->sampling()) return false;
     return true;
 }
 
 /*******************************************************/
 /*******************************************************/
 
-CustomOutput::CustomOutput() : Output()
+CustomOutput::CustomOutput(const SamplingPolicy& sampling)
+    : Output(sampling)
 {
     m_headerPrefix = "custom_";
 }
 
-void CustomOutput::doOperation(const Trial* trial)
+Values CustomOutput::compute(const Trial* trial, const Values& inputs) const
 {
-    if (m_allTrialIds.find(trial->id()) == m_allTrialIds.end()) {
-        return;
-    }
-    updateCaches(trial->id(), trial->step(), trial->model()->customOutputs(m_allInputs));
+    return trial->model()->customOutputs(inputs);
 }
 
 bool CustomOutput::operator==(const OutputPtr output) const
 {
     auto other = std::dynamic_pointer_cast<const CustomOutput>(output);
     if (!other) return false;
-    if (m_allInputs.size() != other->allInputs().size()) return false;
-    for (size_t i = 0; i < m_allInputs.size(); ++i) {
-        if (m_allInputs.at(i) != other->allInputs().at(i))
+    if (m_sampling != other->sampling()) return false;
+    const Values inputs = allInputs();
+    const Values otherInputs = other->allInputs();
+    if (inputs.size() != otherInputs.size()) return false;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (inputs.at(i) != otherInputs.at(i))
             return false;
     }
     return true;
@@ -138,17 +259,144 @@ bool CustomOutput::operator==(const OutputPtr output) const
 /*******************************************************/
 /*******************************************************/
 
+Output::Output(const SamplingPolicy& sampling)
+    : m_sampling(sampling),
+      m_layout(std::make_shared<const Layout>())
+{
+}
+
 Output::~Output()
 {
+    setBudget(nullptr);
     for (Cache* c :  m_caches) {
         delete c;
     }
 }
 
+void Output::setBudget(OutputBudgetPtr budget)
+{
+    if (budget == m_budget) {
+        return;
+    }
+    // the rows in memory are now accounted by the new budget
+    for (auto& it : m_rows) {
+        QMutexLocker locker(&it.second.mutex);
+        for (const Cache::Row& row : it.second.rows) {
+            const quint64 bytes = OutputBudget::rowSize(row.second);
+            if (m_budget) m_budget->release(bytes);
+            if (budget) budget->acquire(bytes);
+        }
+    }
+    m_budget = budget;
+}
+
 void Output::flushAll()
 {
-    for (Cache* c : m_caches) {
-        c->flushAll();
+    for (auto& it : m_rows) {
+        QMutexLocker locker(&it.second.mutex);
+        if (m_budget) {
+            for (const Cache::Row& row : it.second.rows) {
+                m_budget->release(OutputBudget::rowSize(row.second));
+            }
+        }
+        it.second.rows.clear();
+        it.second.first = 0;
+        it.second.spillFile.reset();
+        it.second.spillReadPos = 0;
+        it.second.spilled = 0;
+        it.second.lastValues.clear();
+        for (Cache* c : m_caches) {
+            auto cursor = c->m_cursors.find(it.first);
+            if (cursor != c->m_cursors.end()) {
+                cursor->second = 0;
+            }
+        }
+    }
+}
+
+bool Output::isDue(const Trial* trial, const bool isLastStep) const
+{
+    const LayoutPtr l = layout();
+    return l->trialIds.find(trial->id()) != l->trialIds.end()
+            && (isLastStep || m_sampling.isDue(trial->step()));
+}
+
+int Output::nextDue(const Trial* trial) const
+{
+    const LayoutPtr l = layout();
+    if (l->trialIds.find(trial->id()) == l->trialIds.end()) {
+        return std::numeric_limits<int>::max();
+    }
+    return m_sampling.nextDue(trial->step());
+}
+
+void Output::doOperation(const Trial* trial, const bool isLastStep)
+{
+    const LayoutPtr l = layout();
+    if (l->trialIds.find(trial->id()) == l->trialIds.end()
+            || (!isLastStep && !m_sampling.isDue(trial->step()))) {
+        return;
+    }
+
+    store(trial->id(), trial->step(), compute(trial, l->inputs), isLastStep);
+}
+
+void Output::record(const Trial* trial, const int step, const Values& values, const bool isLastStep)
+{
+    const LayoutPtr l = layout();
+    if (l->trialIds.find(trial->id()) == l->trialIds.end()) {
+        return;
+    }
+
+    if (!isLastStep && !m_sampling.isDue(step)) {
+        return;
+    }
+
+    store(trial->id(), step, values, isLastStep);
+}
+
+void Output::store(const int trialId, const int step, Values allValues, const bool isLastStep)
+{
+    auto it = m_rows.find(trialId);
+    if (it == m_rows.end()) {
+        return;
+    }
+    Rows& r = it->second;
+    QMutexLocker locker(&r.mutex);
+
+    if (m_sampling.type() == SamplingPolicy::Type::OnChange) {
+        if (!isLastStep && !r.lastValues.empty() && r.lastValues == allValues) {
+            return;
+        }
+        r.lastValues = allValues;
+    }
+
+    pushRow(r, step, std::move(allValues));
+}
+
+Values Output::lastValues(const int trialId) const
+{
+    auto it = m_rows.find(trialId);
+    if (it == m_rows.end()) {
+        return Values();
+    }
+    QMutexLocker locker(&it->second.mutex);
+    return it->second.lastValues;
+}
+
+void Output::setLastValues(const int trialId, Values values)
+{
+    auto it = m_rows.find(trialId);
+    if (it != m_rows.end()) {
+        QMutexLocker locker(&it->second.mutex);
+        it->second.lastValues = std::move(values);
+    }
+}
+
+void Output::createRows(const int numTrials)
+{
+    for (int trialId = 0; trialId < numTrials; ++trialId) {
+        m_rows[trialId];
     }
 }
 
@@ -156,10 +404,35 @@ Cache* Output::addCache(const Values& inputs, const std::vector<int>& trialIds)
 {
     Cache* cache = new Cache(inputs, trialIds, shared_from_this());
     for (int trialId : trialIds) {
-        m_allTrialIds.insert(trialId);
+        m_rows[trialId]; // it's a no-op if the trials are running
+    }
+
+    // the new inputs go after the current ones
+    Values allInputs = layout()->inputs;
+    for (const Value& input : inputs) {
+        auto it = std::find(allInputs.begin(), allInputs.end(), input);
+        cache->m_columns.emplace_back(static_cast<size_t>(it - allInputs.begin()));
+        if (it == allInputs.end()) {
+            allInputs.emplace_back(input);
+        }
+    }
+
+    // The running trials go through the cursors of all caches when they
+    // release their rows; so, the cursors of the new cache must be set and
+    // the cache must be registered while none of them holds its rows.
+    for (auto& r : m_rows) {
+        r.second.mutex.lock();
+    }
+    for (int trialId : trialIds) {
+        // the cache will read only the rows computed from now on
+        cache->m_cursors.at(trialId) = m_rows.at(trialId).end();
     }
     m_caches.emplace_back(cache);
-    updateListOfInputs();
+    for (auto& r : m_rows) {
+        r.second.mutex.unlock();
+    }
+
+    updateLayout();
     return cache;
 }
 
@@ -169,56 +442,168 @@ void Output::deleteCache(Cache* cache)
     if (it == m_caches.end()) {
         qFatal("tried to remove a non-existent cache.");
     }
+    for (auto& r : m_rows) {
+        r.second.mutex.lock();
+    }
     m_caches.erase(it);
-    updateListOfInputs();
+    for (auto& r : m_rows) {
+        r.second.mutex.unlock();
+    }
+    updateLayout();
     delete cache;
     cache = nullptr;
+
+    // the rows might be waiting only for the deleted cache
+    for (auto& r : m_rows) {
+        QMutexLocker locker(&r.second.mutex);
+        releaseRows(r.first, r.second);
+    }
+}
+
+void Output::updateLayout()
+{
+    auto l = std::make_shared<Layout>();
+    // The inputs of the deleted caches are kept; the rows waiting to be read
+    // (and the ones being computed) have them, and the columns of the other
+    // caches point after them.
+    l->inputs = layout()->inputs;
+    for (const Cache* cache : m_caches) {
+        for (const Value& input : cache->m_inputs) {
+            if (std::find(l->inputs.begin(), l->inputs.end(), input) == l->inputs.end()) {
+                l->inputs.emplace_back(input);
+            }
+        }
+        for (const auto& it : cache->m_cursors) {
+            l->trialIds.insert(it.first);
+        }
+    }
+    std::atomic_store(&m_layout, LayoutPtr(std::move(l)));
 }
 
-void Output::updateListOfInputs()
+void Output::releaseRows(const int trialId, Rows& r)
 {
-    m_allTrialIds.clear();
-    m_allInputs.clear();
-    for (Cache* cache : m_caches) {
-        m_allInputs.insert(m_allInputs.end(), cache->m_inputs.begin(), cache->m_inputs.end());
-        for (const auto& it : cache->m_trials) {
-            m_allTrialIds.insert(it.first);
+    quint64 minCursor = r.end();
+    for (const Cache* cache : m_caches) {
+        auto cursor = cache->m_cursors.find(trialId);
+        if (cursor != cache->m_cursors.end() && cursor->second < minCursor) {
+            minCursor = cursor->second;
         }
     }
-    // remove duplicates
-    std::sort(m_allInputs.begin(), m_allInputs.end());
-    m_allInputs.erase(std::unique(m_allInputs.begin(), m_allInputs.end()), m_allInputs.end());
+    while (r.first < minCursor) {
+        popFrontRow(r);
+    }
+}
+
+void Output::popFrontRow(Rows& r)
+{
+    if (r.rows.empty()) {
+        loadSpilledRows(r);
+    }
+    if (m_budget) {
+        m_budget->release(OutputBudget::rowSize(r.rows.front().second));
+    }
+    r.rows.pop_front();
+    ++r.first;
 }
 
-void Output::updateCaches(const int trialId, const int currStep, const Values& allValues)
+void Output::updateCaches(const int trialId, const int currStep, Values allValues)
 {
-    if (m_caches.size() == 0) {
+    auto it = m_rows.find(trialId);
+    if (it == m_rows.end()) {
         return;
     }
+    QMutexLocker locker(&it->second.mutex);
+    pushRow(it->second, currStep, std::move(allValues));
+}
 
-    for (Cache* cache : m_caches) {
-        std::unordered_map<int, Cache::Data>::iterator itData = cache->m_trials.find(trialId);
-        if (itData == cache->m_trials.end()) {
-            continue;
+void Output::pushRow(Rows& r, const int step, Values values)
+{
+    // once a row is spilled, the next ones must be spilled too to keep the order
+    if (r.spilled > 0 || (m_budget && m_budget->isFull()
+            && m_budget->policy() == OutputBudget::Policy::Spill)) {
+        if (spillRow(r, step, values)) {
+            return;
         }
+        // unable to spill; let's keep everything in memory then
+        while (r.spilled > 0) {
+            loadSpilledRows(r);
+        }
+    }
 
-        Cache::Data& data = itData->second;
-        Cache::Row newRow;
-        newRow.first = currStep;
-        newRow.second.reserve(cache->m_inputs.size());
+    if (m_budget) {
+        m_budget->acquire(OutputBudget::rowSize(values));
+    }
+    r.rows.emplace_back(step, std::move(values));
+}
 
-        for (const Value& input : cache->m_inputs) {
-            const size_t col = std::find(m_allInputs.begin(), m_allInputs.end(), input) - m_allInputs.begin();
-            newRow.second.emplace_back(allValues.at(col));
+bool Output::spillRow(Rows& r, const int step, const Values& values)
+{
+    if (!r.spillFile) {
+        r.spillFile.reset(new QTemporaryFile());
+        if (!r.spillFile->open()) {
+            qWarning() << "unable to create a temporary file to spill the output rows.";
+            r.spillFile.reset();
+            return false;
+        }
+    }
+
+    const qint64 prevSize = r.spillFile->size();
+    r.spillFile->seek(prevSize);
+    QDataStream out(r.spillFile.get());
+    out << static_cast<qint32>(step) << static_cast<quint32>(values.size());
+    for (const Value& v : values) {
+        out << v;
+    }
+    if (out.status() != QDataStream::Ok) {
+        qWarning() << "unable to spill the output rows to" << r.spillFile->fileName();
+        r.spillFile->resize(prevSize); // discard the partial row
+        return false;
+    }
+    ++r.spilled;
+    return true;
+}
+
+void Output::loadSpilledRows(Rows& r)
+{
+    Q_ASSERT_X(r.spilled > 0 && r.spillFile, "Output", "there are no spilled rows");
+    r.spillFile->seek(r.spillReadPos);
+    QDataStream in(r.spillFile.get());
+    for (int i = 0; i < kSpillChunk && r.spilled > 0; ++i, --r.spilled) {
+        qint32 step;
+        quint32 size;
+        in >> step >> size;
+        Values values;
+        values.reserve(size);
+        for (quint32 j = 0; j < size; ++j) {
+            Value v;
+            in >> v;
+            values.emplace_back(std::move(v));
+        }
+        if (in.status() != QDataStream::Ok) {
+            qFatal("unable to read the output rows from %s", qPrintable(r.spillFile->fileName()));
+        }
+        if (m_budget) {
+            m_budget->acquire(OutputBudget::rowSize(values));
         }
-        if (data.rows.empty()) data.last = data.rows.before_begin();
-        data.last = data.rows.emplace_after(data.last, newRow);
+        r.rows.emplace_back(step, std::move(values));
+    }
+
+    if (r.spilled == 0) {
+        // the file is empty now; let's reuse it
+        r.spillFile->resize(0);
+        r.spillReadPos = 0;
+    } else {
+        r.spillReadPos = r.spillFile->pos();
     }
 }
 
 QString Output::printableHeader(const char sep, const bool joinInputs) const
 {
-    return printableHeader(m_headerPrefix, m_allInputs, sep, joinInputs);
+    QString ret = printableHeader(m_headerPrefix, layout()->inputs, sep, joinInputs);
+    if (joinInputs && !m_sampling.isDense()) {
+        ret += SamplingPolicy::kSeparator + m_sampling.toString();
+    }
+    return ret;
 }
 
 QString Output::printableHeader(const QString& prefix, const Values& inputs,
@@ -243,8 +628,23 @@ std::vector<Cache*> Output::parseHeader(const QStringList& header, const std::ve
                                         const ModelPlugin* model, QString& errorMsg)
 {
     std::vector<Cache*> caches;
-    std::vector<Value> customHeader;
+    // custom outputs are grouped by their sampling policy
+    std::vector<std::pair<SamplingPolicy, Values>> customHeaders;
     for (QString h : header) {
+        SamplingPolicy sampling;
+        const int samplingIdx = h.indexOf(SamplingPolicy::kSeparator);
+        if (samplingIdx >= 0) {
+            QString error;
+            sampling = SamplingPolicy::fromString(h.mid(samplingIdx + 1), error);
+            if (!error.isEmpty()) {
+                errorMsg = QString("invalid header! %1 (%2)\n").arg(error, h);
+                qWarning() << errorMsg;
+                Utils::deleteAndShrink(caches);
+                return caches;
+            }
+            h.truncate(samplingIdx);
+        }
+
         if (h.startsWith("custom_")) {
             h.remove("custom_");
             if (h.isEmpty()) {
@@ -253,7 +653,13 @@ std::vector<Cache*> Output::parseHeader(const QStringList& header, const std::ve
                 Utils::deleteAndShrink(caches);
                 return caches;
             }
-            customHeader.emplace_back(h);
+            auto it = std::find_if(customHeaders.begin(), customHeaders.end(),
+                [sampling](const std::pair<SamplingPolicy, Values>& c) { return c.first == sampling; });
+            if (it == customHeaders.end()) {
+                customHeaders.push_back({sampling, {Value(h)}});
+            } else {
+                it->second.emplace_back(h);
+            }
             continue;
         }
 
@@ -314,13 +720,13 @@ std::vector<Cache*> Output::parseHeader(const QStringList& header, const std::ve
             return caches;
         }
 
-        OutputPtr output = std::make_shared<DefaultOutput>(func, entity, attrRange);
+        OutputPtr output = std::make_shared<DefaultOutput>(func, entity, attrRange, sampling);
         caches.emplace_back(output->addCache(attrHeader, trialIds));
     }
 
-    if (!customHeader.empty()) {
-        OutputPtr output = std::make_shared<CustomOutput>();
-        caches.emplace_back(output->addCache(customHeader, trialIds));
+    for (const auto& customHeader : customHeaders) {
+        OutputPtr output = std::make_shared<CustomOutput>(customHeader.first);
+        caches.emplace_back(output->addCache(customHeader.second, trialIds));
     }
 
     return caches;
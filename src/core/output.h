@@ -16,15 +16,19 @@
 #ifndef OUTPUT_H
 #define OUTPUT_H
 
-#include <forward_list>
+#include <deque>
 #include <memory>
 #include <set>
 #include <unordered_map>
 #include <vector>
 
+#include <QMutex>
+#include <QTemporaryFile>
+
 #include "attributes.h"
 #include "attributerange.h"
 #include "modelplugin.h"
+#include "outputbudget.h"
 #include "stats.h"
 
 namespace evoplex
@@ -38,12 +42,85 @@ typedef std::shared_ptr<Output> OutputPtr;
 typedef std::shared_ptr<CustomOutput> CustomOutputPtr;
 typedef std::shared_ptr<DefaultOutput> DefaultOutputPtr;
 
+/**
+ * @brief Defines in which steps an Output computes its statistics.
+ *
+ * The policy is set by appending a suffix to an entry of the output
+ * header, eg.: "count_nodes_live_true@stride:1000". Available policies:
+ *   - no suffix: every step (default);
+ *   - "stride:n": every n-th step;
+ *   - "log:n": n log-spaced steps per decade;
+ *   - "onchange": only the steps in which the values differ from
+ *     the last recorded ones (run-length style);
+ *   - "last": only the final step.
+ *
+ * The final step of a trial is always sampled, regardless of the policy.
+ */
+class SamplingPolicy
+{
+public:
+    enum class Type {
+        EveryStep,
+        Stride,
+        LogSpaced,
+        OnChange,
+        LastStep
+    };
+
+    // separates an entry of the output header from its sampling policy
+    static const QChar kSeparator;
+
+    // Parses a policy string, eg. "stride:1000" (without the separator).
+    // If the string is invalid, 'error' is filled and EveryStep is returned.
+    static SamplingPolicy fromString(const QString& str, QString& error);
+
+    explicit SamplingPolicy(Type type=Type::EveryStep, int n=1);
+
+    // Returns true if the statistics must be computed at 'step'.
+    // Note that the final step is not known here, it's handled by Output.
+    bool isDue(const int step) const;
+
+    // Returns the first step after 'step' in which isDue() is true;
+    // std::numeric_limits<int>::max() if there is none.
+    int nextDue(const int step) const;
+
+    // Returns the policy string, or an empty string for EveryStep.
+    QString toString() const;
+
+    inline Type type() const { return m_type; }
+    inline int n() const { return m_n; }
+
+    // true if every step is sampled
+    inline bool isDense() const { return m_type == Type::EveryStep; }
+
+    inline bool operator==(const SamplingPolicy& p) const
+    { return m_type == p.m_type && m_n == p.m_n; }
+    inline bool operator!=(const SamplingPolicy& p) const
+    { return !operator==(p); }
+
+private:
+    Type m_type;
+    int m_n;
+};
+
+/**
+ * @brief A consumer of the rows computed by an Output (eg., file, chart).
+ *
+ * The rows of each trial are stored once in the parent Output and shared
+ * by all its caches. Each cache reads them through its own cursor, and a
+ * row is released only after all caches have read it. Thus, consumers
+ * never compete for the rows nor need to copy them.
+ */
 class Cache
 {
     friend class Output;
 public:
-    typedef std::pair<int, Values> Row; // <rowNumber, values>
+    // <step, values of all inputs of the parent Output>
+    // use Cache::value() to get the columns of this cache
+    typedef std::pair<int, Values> Row;
 
+    // true if this cache has read all rows of the trial;
+    // also true if the trial is not read by this cache (nothing to read)
     bool isEmpty(const int trialId) const;
 
     void deleteCache();
@@ -52,19 +129,33 @@ public:
 
     inline OutputPtr output() const { return m_parent; }
     inline const Values& inputs() const { return m_inputs; }
-    inline const Row& readFrontRow(const int trialId) const { return m_trials.at(trialId).rows.front(); }
-    inline void flushFrontRow(const int trialId) { m_trials.at(trialId).rows.pop_front(); }
+
+    // Returns the next row of the trial not read by this cache yet.
+    // The reference is valid until flushFrontRow() is called.
+    // Make sure the cache is not empty first.
+    const Row& readFrontRow(const int trialId) const;
+
+    // Moves the cursor of this cache to the next row of the trial.
+    void flushFrontRow(const int trialId);
+
+    // Skips all rows not read yet.
     void flushAll();
 
+    // The value of the i-th input (column) of this cache in the row.
+    // It's invalid if the row was computed before this cache was added.
+    inline const Value& value(const Row& row, const size_t i) const
+    { return m_columns[i] < row.second.size() ? row.second[m_columns[i]] : kInvalid; }
+
 private:
-    struct Data {
-        std::forward_list<Row> rows;
-        std::forward_list<Row>::const_iterator last;
-    };
+    static const Value kInvalid;
 
     OutputPtr m_parent;
     Values m_inputs; // columns
-    std::unordered_map<int, Data> m_trials;
+    // Index of each input in the rows; it never changes, as the inputs of
+    // the parent Output are only appended (see Output::Layout).
+    std::vector<size_t> m_columns;
+    // <trialId, next row to be read>; guarded by the mutex of the rows of the trial
+    std::unordered_map<int, quint64> m_cursors;
 
     // let's keep it private to ensure that only Output can create a Cache
     explicit Cache(const Values& inputs, const std::vector<int>& trialIds, OutputPtr parent);
@@ -72,6 +163,8 @@ private:
 
 class Output : public std::enable_shared_from_this<Output>
 {
+    friend class Cache;
+
 public:
     static std::vector<Cache*> parseHeader(const QStringList& header,
         const std::vector<int>& trialIds, const ModelPlugin* model, QString& errorMsg);
@@ -81,11 +174,35 @@ public:
 
     virtual ~Output();
 
-    virtual void doOperation(const Trial* trial) = 0;
+    // Computes the statistics for the current step of the trial if it is
+    // due according to the sampling policy. Skipped steps are not computed
+    // at all. The final step of a trial ('isLastStep') is always computed.
+    void doOperation(const Trial* trial, const bool isLastStep=false);
+
+    // Returns true if doOperation() would compute the current step.
+    bool isDue(const Trial* trial, const bool isLastStep=false) const;
+
+    // Returns the next step (after the current one) that doOperation()
+    // would compute, not counting the final step of the trial;
+    // std::numeric_limits<int>::max() if there is none.
+    int nextDue(const Trial* trial) const;
+
+    // Computes the statistics for the current state of the trial,
+    // regardless of the sampling policy. See record().
+    inline Values computeNow(const Trial* trial) const { return compute(trial, layout()->inputs); }
+
+    // Records precomputed 'values' as the row of the trial at 'step', if
+    // it is due according to the sampling policy (as in doOperation()).
+    // It's used to fill the steps skipped by a trial which has reached a
+    // cycle; see GENERAL_ATTR_CYCLEFILL.
+    void record(const Trial* trial, const int step, const Values& values,
+                const bool isLastStep=false);
 
     // Printable header with all columns of this operation separated by 'sep'.
     // If joinInputs is enabled: eg: func_attr_input1[sep]input2
     // If joinInputs is disabled: eg: func_attr_input1[sep]func_attr_input2
+    // When joinInputs is enabled, the sampling policy (if any) is appended
+    // as in the output header, eg: func_attr_input1[sep]input2@stride:10
     QString printableHeader(const char sep, const bool joinInputs) const;
 
     // Format for CustomOutput: "custom_nameDefinedInTheModel"
@@ -94,43 +211,119 @@ public:
 
     virtual bool operator==(const OutputPtr output) const = 0;
 
+    // Creates the rows of the trials [0, numTrials), if needed. The rows
+    // are never created while the trials run, so they can look them up
+    // without a lock; Experiment::addOutput() calls it.
+    void createRows(const int numTrials);
+
+    // Adds a cache which reads the rows of 'trialIds' computed from now on.
+    // It's safe while the trials run, as long as their rows already exist
+    // (ie., the output has been added to the experiment); otherwise, the
+    // output must not be visible to the trials yet.
     Cache* addCache(const Values& inputs, const std::vector<int>& trialIds);
 
-    // CAUTION! We trust it will NEVER be called in a running experiment.
-    // Make sure it is paused first.
+    // It's safe while the trials run; the inputs read only by the deleted
+    // cache are still computed until the output is discarded.
     void deleteCache(Cache* cache);
 
     // flushes all its child caches
     void flushAll();
 
+    // Sets the budget which accounts for the memory used by the rows.
+    // When the budget is full and its policy is OutputBudget::Policy::Spill,
+    // the new rows are kept in a temporary file until they are read.
+    void setBudget(OutputBudgetPtr budget);
+
+    // The values last recorded for the trial (SamplingPolicy::OnChange).
+    // They are part of the state of a trial, so they go into its checkpoints.
+    Values lastValues(const int trialId) const;
+    void setLastValues(const int trialId, Values values);
+
     inline const std::vector<Cache*>& caches() const { return m_caches; }
     inline bool isEmpty() const { return m_caches.empty(); }
-    inline const Values& allInputs() const { return m_allInputs; }
-    inline const std::set<int>& trialIds() const { return m_allTrialIds; }
+    inline Values allInputs() const { return layout()->inputs; }
+    inline std::set<int> trialIds() const { return layout()->trialIds; }
+    inline const SamplingPolicy& sampling() const { return m_sampling; }
 
 protected:
+    // The trials and the inputs computed for them, as read by the caches.
+    // The caches might be added or deleted while the trials run; so, it's
+    // an immutable snapshot, replaced as a whole. The inputs are only
+    // appended, so the columns of the rows computed so far never change.
+    struct Layout {
+        std::set<int> trialIds;
+        Values inputs;
+    };
+    typedef std::shared_ptr<const Layout> LayoutPtr;
+
+    const SamplingPolicy m_sampling;
     QString m_headerPrefix;
     std::vector<Cache*> m_caches; // child caches
-    std::set<int> m_allTrialIds;  // convenient to handle 'doOperation' requests
-    Values m_allInputs;
+
+    OutputBudgetPtr m_budget;
+
+    explicit Output(const SamplingPolicy& sampling);
+
+    inline LayoutPtr layout() const { return std::atomic_load(&m_layout); }
+
+    // Computes the statistics of the inputs for the current step of the trial.
+    virtual Values compute(const Trial* trial, const Values& inputs) const = 0;
 
     // auxiliar method for 'doOperation()'
-    void updateCaches(const int trialId, const int currStep, const Values& allValues);
+    void updateCaches(const int trialId, const int currStep, Values allValues);
+
+    // applies the OnChange policy and updates the caches
+    void store(const int trialId, const int step, Values allValues, const bool isLastStep);
 
 private:
-    // auxiliar method to update the vector with all the current inputs
-    void updateListOfInputs();
+    // The rows of a trial, shared by all caches.
+    // The producer (trial) and the consumers (caches) might run in
+    // different threads, so the rows and the cursors are guarded by 'mutex'.
+    // The spilled rows come after the ones in memory; they are loaded back
+    // in chunks as soon as a cache needs to read them.
+    struct Rows {
+        mutable QMutex mutex;
+        std::deque<Cache::Row> rows;
+        quint64 first = 0; // cursor of the front row
+        std::unique_ptr<QTemporaryFile> spillFile;
+        qint64 spillReadPos = 0;
+        quint64 spilled = 0;  // number of rows in the spill file
+        // the last recorded values; used by SamplingPolicy::OnChange
+        Values lastValues;
+        inline quint64 end() const { return first + rows.size() + spilled; }
+    };
+    // <trialId, rows>; the keys are created before the trials run (see
+    // createRows()), so the map itself never changes while they do
+    std::unordered_map<int, Rows> m_rows;
+    LayoutPtr m_layout; // use layout() and std::atomic_store()
+
+    // Writes the row at the end of the spill file. Returns false if it fails.
+    bool spillRow(Rows& r, const int step, const Values& values);
+    // Moves a chunk of rows from the spill file to the memory.
+    void loadSpilledRows(Rows& r);
+    // Removes the front row from the memory (or from the spill file).
+    void popFrontRow(Rows& r);
+
+    // publishes the trials and inputs of the current caches
+    void updateLayout();
+
+    // releases the rows already read by all caches; it needs the lock
+    void releaseRows(const int trialId, Rows& r);
+
+    // appends a row to the trial's rows; it needs the lock
+    void pushRow(Rows& r, const int step, Values values);
 };
 
 
 class CustomOutput: public Output
 {
 public:
-    explicit CustomOutput();
-
-    virtual void doOperation(const Trial* trial);
+    explicit CustomOutput(const SamplingPolicy& sampling=SamplingPolicy());
 
     virtual bool operator==(const OutputPtr output) const;
+
+protected:
+    virtual Values compute(const Trial* trial, const Values& inputs) const;
 };
 
 
@@ -158,9 +351,8 @@ public:
         return "invalid";
     }
 
-    explicit DefaultOutput(Function f, Entity e, AttributeRangePtr attrRange);
-
-    virtual void doOperation(const Trial* trial);
+    explicit DefaultOutput(Function f, Entity e, AttributeRangePtr attrRange,
+                           const SamplingPolicy& sampling=SamplingPolicy());
 
     virtual bool operator==(const OutputPtr output) const;
 
@@ -169,6 +361,9 @@ public:
     inline Entity entity() const { return m_entity; }
     inline const AttributeRangePtr attrRange() const { return m_attrRange; }
 
+protected:
+    virtual Values compute(const Trial* trial, const Values& inputs) const;
+
 private:
     const Function m_func;
     const Entity m_entity;
@@ -0,0 +1,157 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <QDebug>
+
+#include "outputaggregator.h"
+
+namespace evoplex
+{
+
+QString OutputAggregator::header(const QStringList& columns)
+{
+    QString ret = "step";
+    for (const QString& col : columns) {
+        ret += QString(",%1_n,%1_mean,%1_std,%1_q25,%1_q50,%1_q75").arg(col);
+    }
+    return ret + "\n";
+}
+
+OutputAggregator::OutputAggregator(const QStringList& columns, int numTrials,
+                                   OutputFilePtr file, OutputBudgetPtr budget)
+    : m_numColumns(columns.size()),
+      // a node of the map (ie., its key, the vector and two pointers) and the stats
+      m_stepSize(sizeof(std::pair<const int, std::vector<ColumnStats>>) + 2 * sizeof(void*)
+                 + static_cast<quint64>(columns.size()) * sizeof(ColumnStats)),
+      m_file(file),
+      m_budget(budget),
+      m_usage(0),
+      m_lastSteps(static_cast<size_t>(numTrials), -1)
+{
+    Q_ASSERT_X(m_file, "OutputAggregator", "the summary file must be valid");
+}
+
+OutputAggregator::~OutputAggregator()
+{
+    QMutexLocker locker(&m_mutex);
+    releaseSteps(m_steps.size());
+}
+
+bool OutputAggregator::fold(const int trialId, const Observations& observations, const int lastStep)
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (const Observation& o : observations) {
+        Q_ASSERT_X(o.col >= 0 && o.col < m_numColumns, "OutputAggregator", "invalid column");
+        std::vector<ColumnStats>& stats = m_steps[o.step];
+        if (stats.empty()) {
+            stats.resize(static_cast<size_t>(m_numColumns));
+            m_usage += m_stepSize;
+            if (m_budget) {
+                m_budget->acquire(m_stepSize);
+            }
+        }
+        ColumnStats& s = stats[static_cast<size_t>(o.col)];
+        s.moments.add(o.value);
+        s.q25.add(o.value);
+        s.q50.add(o.value);
+        s.q75.add(o.value);
+    }
+
+    int& trialLastStep = m_lastSteps.at(static_cast<size_t>(trialId));
+    trialLastStep = std::max(trialLastStep, lastStep);
+
+    return writeCompletedSteps();
+}
+
+bool OutputAggregator::allTrialsFinished()
+{
+    QMutexLocker locker(&m_mutex);
+    std::fill(m_lastSteps.begin(), m_lastSteps.end(), std::numeric_limits<int>::max());
+    return writeCompletedSteps();
+}
+
+bool OutputAggregator::restart(QString& error)
+{
+    QMutexLocker locker(&m_mutex);
+    std::fill(m_lastSteps.begin(), m_lastSteps.end(), -1);
+    releaseSteps(m_steps.size());
+    m_steps.clear();
+    return m_file->truncate(error);
+}
+
+bool OutputAggregator::isAhead(const int trialId)
+{
+    QMutexLocker locker(&m_mutex);
+    const int completed = *std::min_element(m_lastSteps.cbegin(), m_lastSteps.cend());
+    return m_lastSteps.at(static_cast<size_t>(trialId)) > completed && !m_steps.empty();
+}
+
+bool OutputAggregator::waitForProgress(unsigned long msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_progress.wait(&m_mutex, msecs);
+}
+
+void OutputAggregator::releaseSteps(const size_t n)
+{
+    const quint64 bytes = n * m_stepSize;
+    m_usage -= bytes;
+    if (m_budget && bytes > 0) {
+        m_budget->release(bytes);
+    }
+}
+
+bool OutputAggregator::writeCompletedSteps()
+{
+    // the steps that all trials have gone past are complete
+    const int completed = *std::min_element(m_lastSteps.cbegin(), m_lastSteps.cend());
+    QString block;
+    size_t written = 0;
+    auto it = m_steps.begin();
+    while (it != m_steps.end() && it->first <= completed) {
+        block += QString::number(it->first);
+        for (const ColumnStats& s : it->second) {
+            if (s.moments.count() == 0) {
+                block += ",,,,,,"; // sparse outputs might skip a step
+                continue;
+            }
+            block += QString(",%1,%2,%3,%4,%5,%6")
+                        .arg(s.moments.count())
+                        .arg(s.moments.mean(), 0, 'g', 12)
+                        .arg(s.moments.stdev(), 0, 'g', 12)
+                        .arg(s.q25.value(), 0, 'g', 12)
+                        .arg(s.q50.value(), 0, 'g', 12)
+                        .arg(s.q75.value(), 0, 'g', 12);
+        }
+        block += "\n";
+        it = m_steps.erase(it);
+        ++written;
+    }
+    if (written > 0) {
+        releaseSteps(written);
+        m_progress.wakeAll();
+    }
+
+    if (!block.isEmpty() && !m_file->append(block.toUtf8())) {
+        qWarning() << "unable to write the summary in" << m_file->filePath();
+        return false;
+    }
+    return true;
+}
+
+} // evoplex
@@ -0,0 +1,141 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OUTPUTAGGREGATOR_H
+#define OUTPUTAGGREGATOR_H
+
+#include <atomic>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+#include <QStringList>
+#include <QWaitCondition>
+
+#include "outputbudget.h"
+#include "outputfile.h"
+#include "stats.h"
+
+namespace evoplex
+{
+
+class OutputAggregator;
+using OutputAggregatorPtr = std::shared_ptr<OutputAggregator>;
+
+/**
+ * @brief Folds the outputs of all trials of an experiment into streaming
+ * statistics per step, which are written to a single summary file.
+ *
+ * For each step and column, it keeps the count, mean and standard deviation
+ * (Welford) and the quartiles (P-square) across trials. The trials fold
+ * their rows as they flush them, and a step is written (and released) as
+ * soon as all trials have gone past it, or have failed or been aborted.
+ * Thus, the memory grows with the number of steps between the slowest trial
+ * and the fastest one, not with the number of trials. Note that a trial
+ * which is still queued has not gone past any step; so, when there are more
+ * trials than threads, the statistics would pile up until the last trials
+ * start. To avoid that, they are charged to the experiment's OutputBudget:
+ * when it's full, the trials ahead (see isAhead()) wait for the others or,
+ * if some are queued, give them their threads. See Trial::runSteps().
+ */
+class OutputAggregator
+{
+public:
+    // a value of the 'col'-th column of a trial at a step
+    struct Observation {
+        int step;
+        int col;
+        double value;
+    };
+    using Observations = std::vector<Observation>;
+
+    // the header of the summary file for these columns
+    static QString header(const QStringList& columns);
+
+    // 'file' must be already opened with the header();
+    // the memory held by the statistics is charged to 'budget', if any
+    explicit OutputAggregator(const QStringList& columns, int numTrials,
+                              OutputFilePtr file, OutputBudgetPtr budget=nullptr);
+    ~OutputAggregator();
+
+    // Folds the observations of the trial into the statistics of their steps.
+    // 'lastStep' is the step up to which the trial has been folded, ie., the
+    // trial will not send any observation for steps <= lastStep anymore.
+    // The steps completed by all trials are written to the file.
+    // This method IS thread-safe.
+    // Returns false if the file is not writable.
+    bool fold(const int trialId, const Observations& observations, const int lastStep);
+
+    // The trial will not send observations anymore (it has finished or failed).
+    inline bool trialFinished(const int trialId);
+
+    // None of the trials will send observations anymore (eg., the experiment
+    // has been aborted); the remaining steps are written as they are.
+    bool allTrialsFinished();
+
+    // Discards all statistics and writes the summary file from scratch;
+    // it's used when the trials start over.
+    bool restart(QString& error);
+
+    // True if the trial has gone past steps which other trials have not
+    // reached yet, ie., their statistics are held because of it.
+    // This method IS thread-safe.
+    bool isAhead(const int trialId);
+
+    // Blocks the calling thread until some steps are written or 'msecs'
+    // elapse. Returns true if some steps have been written.
+    bool waitForProgress(unsigned long msecs);
+
+    // The memory (bytes) held by the statistics of the steps not written yet.
+    inline quint64 usage() const { return m_usage; }
+
+private:
+    struct ColumnStats {
+        RunningStats moments;
+        P2Quantile q25{0.25};
+        P2Quantile q50{0.5};
+        P2Quantile q75{0.75};
+    };
+
+    QMutex m_mutex;
+    QWaitCondition m_progress; // woken when steps are written
+    const int m_numColumns;
+    const quint64 m_stepSize; // estimated memory of a step in 'm_steps'
+    OutputFilePtr m_file;
+    OutputBudgetPtr m_budget;
+    std::atomic<quint64> m_usage;
+    std::vector<int> m_lastSteps; // <trialId, lastStep>
+    std::map<int, std::vector<ColumnStats>> m_steps; // <step, stats of each column>
+
+    // Releases the memory of 'n' steps. The mutex must be locked.
+    void releaseSteps(const size_t n);
+
+    // Writes (and releases) the steps that all trials have gone past.
+    // The mutex must be locked.
+    bool writeCompletedSteps();
+};
+
+/************************************************************************
+   OutputAggregator: Inline member functions
+ ************************************************************************/
+
+inline bool OutputAggregator::trialFinished(const int trialId)
+{ return fold(trialId, Observations(), std::numeric_limits<int>::max()); }
+
+} // evoplex
+#endif // OUTPUTAGGREGATOR_H
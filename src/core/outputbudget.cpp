@@ -0,0 +1,78 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+
+#include "outputbudget.h"
+#include "output.h"
+
+namespace evoplex
+{
+
+OutputBudget::Policy OutputBudget::policyFromString(const QString& policy)
+{
+    if (policy == "block") return Policy::Block;
+    if (policy == "spill") return Policy::Spill;
+    return Policy::Flush;
+}
+
+quint64 OutputBudget::rowSize(const Values& values)
+{
+    quint64 bytes = sizeof(Cache::Row) + values.size() * sizeof(Value);
+    for (const Value& v : values) {
+        if (v.isString()) {
+            bytes += std::strlen(v.toString()) + 1;
+        }
+    }
+    return bytes;
+}
+
+OutputBudget::OutputBudget(quint64 limit, Policy policy)
+    : m_limit(limit),
+      m_policy(policy),
+      m_usage(0),
+      m_peak(0)
+{
+}
+
+void OutputBudget::acquire(quint64 bytes)
+{
+    const quint64 usage = m_usage.fetch_add(bytes) + bytes;
+    quint64 peak = m_peak.load();
+    while (usage > peak && !m_peak.compare_exchange_weak(peak, usage)) {}
+}
+
+void OutputBudget::release(quint64 bytes)
+{
+    Q_ASSERT_X(m_usage >= bytes, "OutputBudget", "released more than acquired");
+    m_usage -= bytes;
+    if (m_policy == Policy::Block && !isFull()) {
+        QMutexLocker locker(&m_mutex);
+        m_roomAvailable.wakeAll();
+    }
+}
+
+bool OutputBudget::waitForRoom(unsigned long msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!isFull()) {
+        return true;
+    }
+    m_roomAvailable.wait(&m_mutex, msecs);
+    return !isFull();
+}
+
+} // evoplex
@@ -0,0 +1,92 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OUTPUTBUDGET_H
+#define OUTPUTBUDGET_H
+
+#include <atomic>
+#include <memory>
+
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+#include "value.h"
+
+namespace evoplex
+{
+
+class OutputBudget;
+using OutputBudgetPtr = std::shared_ptr<OutputBudget>;
+
+/**
+ * @brief Accounts for the memory used by the output rows of an experiment.
+ *
+ * The rows computed by the trials stay in memory until all their consumers
+ * (eg., the output file, charts) have read them. An OutputBudget keeps track
+ * of how much memory they take and tells the trials when the ceiling is
+ * reached, so they can react according to the Policy.
+ */
+class OutputBudget
+{
+public:
+    enum class Policy {
+        Block, // trials write their files and wait until the other consumers catch up
+        Spill, // new rows are kept in temporary files until they are read
+        Flush  // trials write their files earlier than 'stepsToFlush'
+    };
+    static Policy policyFromString(const QString& policy);
+
+    // Estimated memory (bytes) taken by a row with these values.
+    static quint64 rowSize(const Values& values);
+
+    // 'limit' is the memory ceiling in bytes; 0 means unlimited
+    explicit OutputBudget(quint64 limit, Policy policy);
+
+    // Accounts for a new row. It never blocks.
+    void acquire(quint64 bytes);
+    // Accounts for a released row.
+    void release(quint64 bytes);
+
+    // Blocks the calling thread until the memory usage gets below the limit
+    // or 'msecs' elapse. Returns true if it is below the limit.
+    bool waitForRoom(unsigned long msecs);
+
+    inline bool isFull() const;
+    inline quint64 usage() const { return m_usage; }
+    inline quint64 peak() const { return m_peak; }
+    inline quint64 limit() const { return m_limit; }
+    inline Policy policy() const { return m_policy; }
+
+private:
+    const quint64 m_limit;
+    const Policy m_policy;
+    std::atomic<quint64> m_usage;
+    std::atomic<quint64> m_peak;
+
+    QMutex m_mutex;
+    QWaitCondition m_roomAvailable;
+};
+
+/************************************************************************
+   OutputBudget: Inline member functions
+ ************************************************************************/
+
+inline bool OutputBudget::isFull() const
+{ return m_limit > 0 && m_usage >= m_limit; }
+
+} // evoplex
+#endif // OUTPUTBUDGET_H
@@ -0,0 +1,124 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QDebug>
+
+#include "outputfile.h"
+
+namespace evoplex
+{
+
+OutputFile::Mode OutputFile::modeFromString(const QString& mode)
+{
+    if (mode == "experiment") return Mode::Experiment;
+    if (mode == "project") return Mode::Project;
+    if (mode == "none") return Mode::None;
+    return Mode::Trial;
+}
+
+OutputFile::OutputFile(const QString& filePath, const QString& header)
+    : m_filePath(filePath),
+      m_header(header),
+      m_file(filePath),
+      m_pending(nullptr),
+      m_writing(false),
+      m_failed(false)
+{
+}
+
+OutputFile::~OutputFile()
+{
+    writePending();
+    Q_ASSERT_X(!m_pending.load(), "OutputFile", "all blocks should have been written");
+    m_file.close();
+}
+
+bool OutputFile::open(QString& error)
+{
+    if (!m_file.open(QFile::WriteOnly | QFile::Truncate)
+            || m_file.write(m_header.toUtf8()) < 0 || !m_file.flush()) {
+        error += QString("Could not write in %1\n").arg(m_filePath);
+        qWarning() << error;
+        m_failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool OutputFile::truncate(QString& error)
+{
+    writePending();
+    if (!m_file.isOpen() || !m_file.resize(0) || !m_file.seek(0)
+            || m_file.write(m_header.toUtf8()) < 0 || !m_file.flush()) {
+        error += QString("Could not write in %1\n").arg(m_filePath);
+        qWarning() << error;
+        m_failed = true;
+        return false;
+    }
+    m_failed = false;
+    return true;
+}
+
+bool OutputFile::append(QByteArray&& block)
+{
+    if (m_failed) {
+        return false;
+    }
+
+    Block* b = new Block{std::move(block), m_pending.load()};
+    while (!m_pending.compare_exchange_weak(b->next, b)) {}
+
+    writePending();
+    return !m_failed;
+}
+
+void OutputFile::writePending()
+{
+    // If another thread is writing, it will check the pending list again
+    // after it releases the file; so our blocks will not be left behind.
+    while (m_pending.load()) {
+        if (m_writing.exchange(true)) {
+            return;
+        }
+
+        // the pending list is a stack; reverse it to keep the order of the blocks
+        Block* b = m_pending.exchange(nullptr);
+        Block* ordered = nullptr;
+        while (b) {
+            Block* next = b->next;
+            b->next = ordered;
+            ordered = b;
+            b = next;
+        }
+
+        while (ordered) {
+            if (!m_failed && m_file.write(ordered->data) != ordered->data.size()) {
+                qWarning() << "unable to write in" << m_filePath;
+                m_failed = true;
+            }
+            Block* next = ordered->next;
+            delete ordered;
+            ordered = next;
+        }
+        if (!m_failed && !m_file.flush()) {
+            m_failed = true;
+        }
+
+        m_writing = false;
+    }
+}
+
+} // evoplex
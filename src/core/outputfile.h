@@ -0,0 +1,90 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OUTPUTFILE_H
+#define OUTPUTFILE_H
+
+#include <atomic>
+#include <memory>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+namespace evoplex
+{
+
+class OutputFile;
+using OutputFilePtr = std::shared_ptr<OutputFile>;
+
+/**
+ * @brief An appendable csv file shared by several trials.
+ *
+ * It is used to multiplex the outputs of all trials of an experiment (or
+ * of a whole project) into a single file. Trials format their rows into a
+ * local block and append it at once. The writes are coordinated without
+ * locks: blocks are pushed to a pending list and whichever thread finds
+ * the file idle writes all pending blocks, so other trials just leave
+ * their blocks and carry on.
+ */
+class OutputFile
+{
+public:
+    enum class Mode {
+        Trial,      // one file per trial (default)
+        Experiment, // one file per experiment, with a 'trial' column
+        Project,    // one file per project, with 'experiment' and 'trial' columns
+        None        // no file with the rows of the trials
+    };
+    static Mode modeFromString(const QString& mode);
+
+    explicit OutputFile(const QString& filePath, const QString& header);
+    ~OutputFile();
+
+    // Creates (truncates) the file and writes the header.
+    bool open(QString& error);
+
+    // Discards the rows written so far, leaving the header only.
+    // This method is NOT thread-safe; no one may append to the file meanwhile.
+    bool truncate(QString& error);
+
+    // Appends a block of lines to the file.
+    // This method IS thread-safe and does not block on other writers.
+    // The blocks of each thread are written in the order they were appended.
+    // Returns false if the file is not writable.
+    bool append(QByteArray&& block);
+
+    inline const QString& filePath() const { return m_filePath; }
+    inline const QString& header() const { return m_header; }
+
+private:
+    struct Block {
+        QByteArray data;
+        Block* next;
+    };
+
+    const QString m_filePath;
+    const QString m_header;
+    QFile m_file;
+    std::atomic<Block*> m_pending; // lock-free stack of blocks to be written
+    std::atomic<bool> m_writing;   // true while a thread is writing to the file
+    std::atomic<bool> m_failed;
+
+    // Writes all pending blocks, unless another thread is already doing it.
+    void writePending();
+};
+
+} // evoplex
+#endif // OUTPUTFILE_H
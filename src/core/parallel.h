@@ -0,0 +1,50 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <QtConcurrent>
+
+namespace evoplex {
+
+/**
+ * @brief Calls f(begin, end) for consecutive chunks of [0, size), split
+ *        across up to @p threads threads of the global thread pool.
+ * The calling thread takes part, so it's safe to call it from a worker.
+ * Small ranges (or threads <= 1) run in the calling thread only.
+ */
+template <typename F>
+void parallelFor(int size, int threads, F f)
+{
+    if (threads <= 1 || size < 2 * threads) {
+        f(0, size);
+        return;
+    }
+    const int chunk = (size + threads - 1) / threads;
+    std::vector<std::pair<int,int>> chunks;
+    for (int begin = 0; begin < size; begin += chunk) {
+        chunks.emplace_back(begin, std::min(size, begin + chunk));
+    }
+    QtConcurrent::blockingMap(chunks, [&f](const std::pair<int,int>& c) { f(c.first, c.second); });
+}
+
+} // evoplex
+#endif // PARALLEL_H
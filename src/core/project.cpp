@@ -57,6 +57,56 @@ bool Project::init(QString& error, const QString& filepath)
     return !error.isEmpty();
 }
 
+OutputFilePtr Project::outputFile(const QString& filePath, const QString& header,
+                                  int expId, QString& error)
+{
+    QMutexLocker locker(&m_mutex);
+    OutputFilePtr file = m_outputFiles.value(filePath);
+    if (file) {
+        if (file->header() != header) {
+            error += QString("The experiments writing to '%1' must have "
+                             "the same output header.\n").arg(filePath);
+            qWarning() << error;
+            return nullptr;
+        }
+
+        QSet<int>& writers = m_outputFileWriters[filePath];
+        if (writers.contains(expId)) {
+            // the experiment starts over; as the rows of its previous run
+            // can't be singled out, the file starts over as well
+            for (int id : writers) {
+                auto it = m_experiments.find(id);
+                if (id == expId || it == m_experiments.cend()) {
+                    continue;
+                }
+                const Status s = it->second->expStatus();
+                if (s == Status::Running || s == Status::Queued || s == Status::Paused) {
+                    error += QString("Could not start over the experiment %1 while the "
+                                     "experiment %2 is writing to '%3'.\n"
+                                     "Please, wait for it to finish and try again.\n")
+                                     .arg(expId).arg(id).arg(filePath);
+                    qWarning() << error;
+                    return nullptr;
+                }
+            }
+            if (!file->truncate(error)) {
+                return nullptr;
+            }
+            writers.clear();
+        }
+        writers.insert(expId);
+        return file;
+    }
+
+    file = std::make_shared<OutputFile>(filePath, header);
+    if (!file->open(error)) {
+        return nullptr;
+    }
+    m_outputFiles.insert(filePath, file);
+    m_outputFileWriters.insert(filePath, {expId});
+    return file;
+}
+
 void Project::setFilePath(const QString& path)
 {
     m_filepath = path;
@@ -21,10 +21,12 @@
 
 #include <QMutex>
 #include <QObject>
+#include <QSet>
 
 #include "abstractmodel.h"
 #include "experiment.h"
 #include "mainapp.h"
+#include "outputfile.h"
 
 namespace evoplex {
 
@@ -67,6 +69,17 @@ public:
     // generate a valid experiment id
     int generateExpId() const;
 
+    // Returns the output file shared by all experiments of this project
+    // which write to 'filePath'. It's created at the first request and kept
+    // open while the project is alive. The experiments must use the same header.
+    // The file holds a single run of each experiment; so, when the experiment
+    // 'expId' requests it again (ie, it starts over), the file is truncated,
+    // which is refused while other experiments are still writing to it.
+    // This method IS thread-safe.
+    // @return nullptr if unsuccessful
+    OutputFilePtr outputFile(const QString& filePath, const QString& header,
+                             int expId, QString& error);
+
     inline int id() const;
     inline const QString& name() const;
     inline const QString& filepath() const;
@@ -97,6 +110,8 @@ private:
     QString m_name;
     bool m_hasUnsavedChanges;
     Experiments m_experiments;
+    QHash<QString, OutputFilePtr> m_outputFiles; // shared output files <filePath, file>
+    QHash<QString, QSet<int>> m_outputFileWriters; // experiments in each shared file
 };
 
 inline const QString& Project::name() const
@@ -0,0 +1,92 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <utility>
+
+#include "sparsematrix.h"
+#include "parallel.h"
+
+namespace evoplex {
+
+SparseMatrix::SparseMatrix()
+    : m_size(0),
+      m_offsets(1, 0)
+{
+}
+
+SparseMatrix::SparseMatrix(int size, std::vector<int> offsets,
+                           std::vector<int> columns, std::vector<double> values)
+    : m_size(size),
+      m_offsets(std::move(offsets)),
+      m_columns(std::move(columns)),
+      m_values(std::move(values))
+{
+    Q_ASSERT_X(size >= 0 && m_offsets.size() == static_cast<size_t>(size) + 1,
+               "SparseMatrix", "there must be one offset per row plus one");
+    Q_ASSERT_X(m_offsets.front() == 0 && m_offsets.back() == numEntries()
+               && m_columns.size() == m_values.size(),
+               "SparseMatrix", "the offsets must match the entries");
+}
+
+void SparseMatrix::multiply(const std::vector<double>& x, std::vector<double>& y, int threads) const
+{
+    Q_ASSERT_X(x.size() == static_cast<size_t>(m_size), "SparseMatrix::multiply",
+               "the vector must have one element per column");
+    Q_ASSERT_X(&x != &y, "SparseMatrix::multiply", "the output cannot be the input");
+
+    y.resize(static_cast<size_t>(m_size));
+    const int* offsets = m_offsets.data();
+    const int* columns = m_columns.data();
+    const double* values = m_values.data();
+    const double* xs = x.data();
+    double* ys = y.data();
+    parallelFor(m_size, threads, [=](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            double sum = 0.0;
+            for (int k = offsets[r]; k < offsets[r+1]; ++k) {
+                sum += values[k] * xs[columns[k]];
+            }
+            ys[r] = sum;
+        }
+    });
+}
+
+SparseMatrix SparseMatrix::transposed() const
+{
+    // counting sort of the entries by column
+    std::vector<int> offsets(static_cast<size_t>(m_size) + 1, 0);
+    for (int c : m_columns) {
+        ++offsets[static_cast<size_t>(c) + 1];
+    }
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        offsets[i] += offsets[i-1];
+    }
+
+    std::vector<int> next(offsets.begin(), offsets.end() - 1);
+    std::vector<int> columns(m_columns.size());
+    std::vector<double> values(m_values.size());
+    for (int r = 0; r < m_size; ++r) {
+        for (int k = m_offsets[static_cast<size_t>(r)]; k < m_offsets[static_cast<size_t>(r)+1]; ++k) {
+            const size_t pos = static_cast<size_t>(next[static_cast<size_t>(m_columns[static_cast<size_t>(k)])]++);
+            columns[pos] = r;
+            values[pos] = m_values[static_cast<size_t>(k)];
+        }
+    }
+    return SparseMatrix(m_size, std::move(offsets), std::move(columns), std::move(values));
+}
+
+} // evoplex
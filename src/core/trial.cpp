@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <QDataStream>
 #include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
@@ -21,18 +25,34 @@
 
 #include "abstractgraph.h"
 #include "abstractmodel.h"
-#include "nodes_p.h"
+#include "cputopology.h"
+#include "edge_p.h"
+#include "node_p.h"
 #include "trial.h"
 #include "project.h"
 #include "utils.h"
 
 namespace evoplex {
 
+namespace {
+// the target duration of a batch of steps; see Trial::grantSteps()
+const qint64 kBatchNsecs = 10000000; // 10ms
+} // namespace
+
 Trial::Trial(const quint16 id, ExperimentPtr exp)
     : m_id(id),
       m_exp(exp),
       m_step(-1), // important! a trial starts from -1
       m_status(Status::Disabled),
+      m_yielded(false),
+      m_footprint(0),
+      m_numaNode(-1),
+      m_watchers(0),
+      m_cycleWindow(0),
+      m_cyclePeriod(0),
+      m_timeStep(1.0),
+      m_batchSteps(2), // doubled while the batches are fast, down to 1 otherwise
+      m_group({this}),
       m_prg(nullptr),
       m_graph(nullptr),
       m_model(nullptr)
@@ -60,13 +80,49 @@ GraphType Trial::graphType() const
     return  m_exp->graphType();
 }
 
+quint64 Trial::estimateFootprint(GraphType type, quint64 nodes, quint64 edges,
+                                 int nodeAttrs, int edgeAttrs)
+{
+    // an entry of an unordered_map costs its value plus a 'next' pointer
+    // and a bucket pointer; a shared_ptr adds a control block
+    const quint64 entry = 2 * sizeof(void*);
+    const quint64 ctrlBlock = 2 * sizeof(void*) + 2 * sizeof(long);
+    const quint64 attr = sizeof(Value) + sizeof(QString);
+
+    const quint64 node = (type == GraphType::Directed ? sizeof(DNode) : sizeof(UNode))
+            + ctrlBlock + sizeof(Node) + sizeof(int) + entry
+            + static_cast<quint64>(nodeAttrs) * attr;
+
+    // an edge is in the graph and in the edges of both ends (the out-edges
+    // of the origin, and the in- or out-edges of the neighbour)
+    const quint64 edge = sizeof(BaseEdge) + ctrlBlock
+            + 3 * (sizeof(Edge) + sizeof(int) + entry)
+            + (edgeAttrs > 0 ? sizeof(Attributes) + static_cast<quint64>(edgeAttrs) * attr : 0);
+
+    return nodes * node + edges * edge;
+}
+
+quint64 Trial::footprint() const
+{
+    if (!m_graph) {
+        return 0;
+    }
+
+    const Nodes& nodes = m_graph->nodes();
+    const Edges& edges = m_graph->edges();
+    const int nodeAttrs = nodes.empty() ? 0 : nodes.cbegin()->second.attrs().size();
+    const Attributes* edgeAttrs = edges.empty() ? nullptr : edges.cbegin()->second.attrs();
+    return estimateFootprint(graphType(), nodes.size(), edges.size(), nodeAttrs,
+                             edgeAttrs ? edgeAttrs->size() : 0) + m_exp->outputFootprint();
+}
+
 bool Trial::init()
 {
-    if (m_exp->expStatus() == Status::Invalid || m_exp->pauseAt() < 0) {
+    if (initAborted()) {
         return false;
     }
 
-    Nodes nodes = m_exp->cloneCachedNodes(m_id);
+    Nodes nodes = m_exp->cloneCachedNodes();
     if (nodes.empty()) {
         nodes = m_exp->createNodes();
         if (nodes.empty()) {
@@ -83,9 +139,35 @@ bool Trial::init()
         return false;
     }
 
+    // a trial resumes from its latest checkpoint, if any
+    QByteArray checkpoint;
+    const QString checkpointPath = m_exp->checkpointPath(m_id);
+    if (m_exp->m_resumeFromCheckpoints && !m_exp->m_checkpointPrefix.isEmpty()
+            && QFileInfo::exists(checkpointPath)) {
+        QString error;
+        checkpoint = CheckpointWriter::read(checkpointPath, error);
+        if (checkpoint.isEmpty()) {
+            qWarning() << "unable to resume the trial." << error
+                       << "Experiment:" << m_exp->id();
+            return false;
+        }
+    }
+
+    // the graph is allocated by this thread; if the worker is pinned to a
+    // NUMA node, the memory is local to it (first-touch policy)
+    m_numaNode = CpuTopology::currentNode();
+
     const quint32 seed = m_exp->inputs()->general(GENERAL_ATTR_SEED).toUInt();
     m_prg = new PRG(seed + m_id);
 
+    // the model might need it in its init()
+    m_timeStep = m_exp->inputs()->general(GENERAL_ATTR_TIMESTEP).toDouble();
+    if (!(m_timeStep > 0.0) || !std::isfinite(m_timeStep)) {
+        qWarning() << "unable to create the trials. The time step must be positive,"
+                   << "got" << m_timeStep << "Experiment:" << m_exp->id();
+        return false;
+    }
+
     m_graph = dynamic_cast<AbstractGraph*>(m_exp->graphPlugin()->create());
     if (!m_graph || !m_graph->setup(m_exp->graphId(), m_exp->graphType(), *m_prg,
                                     std::move(edgeAttrsGen), nodes, *m_exp->inputs()->graph())) {
@@ -95,6 +177,10 @@ bool Trial::init()
         return false;
     }
 
+    if (initAborted()) {
+        return false;
+    }
+
     m_model = dynamic_cast<AbstractModel*>(m_exp->modelPlugin()->create());
     if (!m_model || !m_model->setup(*this, *m_exp->inputs()->model())) {
         qWarning() << "unable to create the trials."
@@ -103,30 +189,30 @@ bool Trial::init()
         return false;
     }
 
-    if (!m_exp->inputs()->fileCaches().empty()) {
-        const QString fpath = m_exp->m_filePathPrefix + QString("%4.csv").arg(m_id);
-        QFile file(fpath);
-        if (file.open(QFile::WriteOnly | QFile::Truncate)) {
-            QTextStream stream(&file);
-            stream << m_exp->m_fileHeader;
-            file.close();
-        } else {
-            qWarning() << "unable to create the trials. Could not write in " << fpath;
-            return false;
+    // a resumed trial carries on with the rows in its file
+    if (!m_exp->inputs()->fileCaches().empty() && checkpoint.isEmpty()) {
+        // the shared files (OutputFile) are created by the experiment
+        if (hasOwnFile()) {
+            const QString fpath = filePath();
+            QFile file(fpath);
+            if (file.open(QFile::WriteOnly | QFile::Truncate)) {
+                QTextStream stream(&file);
+                stream << m_exp->m_fileHeader;
+                file.close();
+            } else {
+                qWarning() << "unable to create the trials. Could not write in " << fpath;
+                return false;
+            }
         }
 
         // write this initial step to file
+        m_step = 0;
         for (auto const& output : m_exp->m_outputs) {
             output->doOperation(this);
         }
         writeCachedSteps(m_exp.get());
     }
 
-    // make the set of nodes available for other trials
-    if (m_exp->numTrials() > 1 && m_exp->m_clonableNodes.empty()) {
-        m_exp->m_clonableNodes = NodesPrivate::clone(nodes);
-    }
-
     m_step = 0; // important!
 
     // set-up the edges for the first time
@@ -137,13 +223,28 @@ bool Trial::init()
         return false;
     }
 
+    if (!checkpoint.isEmpty()) {
+        if (!loadState(checkpoint)) {
+            qWarning() << "unable to resume the trial from" << checkpointPath
+                       << "Experiment:" << m_exp->id();
+            return false;
+        }
+        qDebug() << QString("[E%1:T%2] resumed at step %3").arg(m_exp->id()).arg(m_id).arg(m_step);
+    }
+
+    m_cycleWindow = m_exp->inputs()->general(GENERAL_ATTR_CYCLEWINDOW).toInt();
+    if (m_cycleWindow > 0) {
+        m_graph->trackStateHash(true);
+        detectCycle(); // records the initial state
+    }
+
     return true;
 }
 
 void Trial::run()
 {
     if (m_exp->expStatus() == Status::Invalid) {
-        m_status = Status::Invalid;
+        setStatus(Status::Invalid);
     }
 
     if (m_status == Status::Invalid || m_status == Status::Running
@@ -153,34 +254,119 @@ void Trial::run()
     }
 
     if (m_status == Status::Disabled) {
-        // Ensure we init one trial at a time.
-        // Thus, if one trial fail, the others will be aborted earlier.
-        m_exp->m_mutex.lock();
+        // The trials are initialized concurrently; the shared state has been
+        // built by Experiment::prepareTrials(). If one trial fail, the others
+        // are aborted earlier through the 'm_initFailed' flag.
         if (!init()) {
-            m_exp->m_mutex.unlock();
-            m_status = Status::Invalid;
+            m_exp->m_initFailed = true;
+            setStatus(Status::Invalid);
+            m_exp->trialFinished(this);
+            return;
+        }
+        // replaces the estimate with the actual memory
+        m_exp->m_mainApp->expMgr()->updateFootprint(this);
+
+        if (!initReplicas()) {
+            m_exp->m_initFailed = true;
+            setStatus(Status::Invalid);
             m_exp->trialFinished(this);
             return;
         }
-        m_exp->m_mutex.unlock();
     }
 
-    m_status = Status::Running;
-    emit (m_exp->trialCreated(m_id));
+    const bool resuming = m_yielded;
+    setStatus(Status::Running);
+    if (!resuming) {
+        for (const Trial* trial : m_group) {
+            emit (m_exp->trialCreated(trial->m_id));
+        }
+        m_checkpointTimer.start();
+    }
 
-    if (!runSteps() || m_step >= m_exp->stopAt()) {
-        if (writeCachedSteps(m_exp.get())) {
-            m_status = Status::Finished;
-        } else {
-            m_status = Status::Invalid;
+    const bool hasNext = runSteps();
+    if (m_yielded) {
+        // the quantum has expired; back to the end of the queue
+        setStatus(Status::Queued);
+        m_exp->m_mainApp->expMgr()->trialYielded(this);
+        return;
+    }
+
+    if (!hasNext || m_step >= m_exp->stopAt()) {
+        const OutputAggregatorPtr& aggregator = m_exp->m_aggregator;
+        bool ok = true;
+        for (const Trial* trial : m_group) {
+            ok = ok && trial->writeCachedSteps(m_exp.get())
+                    && (!aggregator || aggregator->trialFinished(trial->m_id));
+        }
+        setStatus(ok ? Status::Finished : Status::Invalid);
+        if (ok && m_cyclePeriod > 0) {
+            m_exp->cycleFound(m_cyclePeriod);
         }
     } else {
-        m_status = Status::Paused;
+        setStatus(Status::Paused);
     }
 
     m_exp->trialFinished(this);
 }
 
+void Trial::freeState()
+{
+    delete m_model;
+    m_model = nullptr;
+    delete m_graph;
+    m_graph = nullptr;
+}
+
+bool Trial::initReplicas()
+{
+    if (m_group.size() < 2) {
+        return true;
+    }
+
+    ExperimentsMgr* expMgr = m_exp->m_mainApp->expMgr();
+    std::vector<AbstractModel*> replicas;
+    replicas.reserve(m_group.size() - 1);
+    for (auto it = m_group.cbegin() + 1; it != m_group.cend(); ++it) {
+        Trial* trial = *it;
+        if (!trial->init()) {
+            return false;
+        }
+        expMgr->updateFootprint(trial);
+        replicas.emplace_back(trial->m_model);
+    }
+
+    if (m_model->takeReplicas(replicas)) {
+        return true;
+    }
+
+    // the model can't step them together; they're ready to run on their own
+    std::vector<Trial*> replicaTrials(m_group.cbegin() + 1, m_group.cend());
+    m_group.resize(1);
+    for (Trial* trial : replicaTrials) {
+        trial->m_group = {trial};
+        trial->m_status = Status::Queued;
+    }
+    expMgr->replicasReleased(replicaTrials);
+    return true;
+}
+
+void Trial::setStatus(Status s)
+{
+    for (Trial* trial : m_group) {
+        trial->m_status = s;
+    }
+}
+
+bool Trial::isWatched() const
+{
+    for (const Trial* trial : m_group) {
+        if (trial->m_watchers > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool Trial::runSteps()
 {
     const Experiment* exp = m_exp.get();
@@ -188,18 +374,104 @@ bool Trial::runSteps()
     QElapsedTimer t;
     t.start();
 
-    m_model->beforeLoop();
+    // a trial which yielded is still in the same loop
+    if (!m_yielded) {
+        m_model->beforeLoop();
+    }
+    m_yielded = false;
+
+    const ExperimentsMgr* expMgr = exp->m_mainApp->expMgr();
+    const int quantumSteps = expMgr->quantumSteps();
+    const int quantumMsecs = expMgr->quantumMsecs();
+    int sliceSteps = 0;
+    QElapsedTimer slice;
+    slice.start();
 
     bool hasNext = true;
     while (m_step < exp->pauseAt() && hasNext) {
-        hasNext = m_model->algorithmStep();
-        ++m_step;
+        const int grant = grantSteps(exp, quantumSteps > 0 ? quantumSteps - sliceSteps : 0);
+        if (grant > 1) {
+            QElapsedTimer batch;
+            batch.start();
+            int steps = 1;
+            hasNext = m_model->algorithmSteps(grant, steps);
+            m_step += steps;
+            sliceSteps += steps;
+            // keeps the batches short, so that a pause is still honoured asap
+            const qint64 nsecs = batch.nsecsElapsed();
+            if (nsecs < kBatchNsecs / 2) {
+                m_batchSteps = std::min(m_batchSteps * 2, EVOPLEX_MAX_STEPS);
+            } else if (nsecs > kBatchNsecs * 2) {
+                m_batchSteps = std::max(m_batchSteps / 2, 1);
+            }
+        } else {
+            hasNext = m_model->algorithmStep();
+            ++m_step;
+            ++sliceSteps;
+        }
+        for (Trial* trial : m_group) {
+            trial->m_step = m_step;
+        }
 
-        for (const OutputPtr& output : exp->m_outputs) {
-            output->doOperation(this);
+        // the nodes' attributes are read by someone else at this step
+        bool synced = m_cycleWindow > 0 || isWatched();
+        if (synced) {
+            m_model->syncNodes();
         }
 
-        if (m_step % exp->m_mainApp->stepsToFlush() == 0 && !writeCachedSteps(exp)) {
+        // a fixed point or a cycle; the next steps would just repeat it
+        const bool cycle = m_cycleWindow > 0 && hasNext
+                && m_step < exp->stopAt() && detectCycle();
+        const bool fill = cycle && exp->inputs()->general(GENERAL_ATTR_CYCLEFILL).toBool();
+
+        // the final step is always sampled
+        const bool isLastStep = !hasNext || m_step >= exp->stopAt() || (cycle && !fill);
+        for (Trial* trial : m_group) {
+            for (const OutputPtr& output : exp->m_outputs) {
+                if (!output->isDue(trial, isLastStep)) {
+                    continue;
+                }
+                if (!synced) {
+                    m_model->syncNodes();
+                    synced = true;
+                }
+                output->doOperation(trial, isLastStep);
+            }
+        }
+
+        if (cycle) {
+            qDebug() << QString("[E%1:T%2] cycle of period %3 at step %4")
+                        .arg(exp->id()).arg(m_id).arg(m_cyclePeriod).arg(m_step);
+            if (fill && !fillCycle(exp)) {
+                m_status = Status::Invalid;
+                return false;
+            }
+            hasNext = false; // Finished
+        }
+
+        if (m_step % exp->m_mainApp->stepsToFlush() == 0 && !writeGroupSteps(exp)) {
+            m_status = Status::Invalid;
+            return false;
+        }
+
+        if (exp->m_outputBudget && exp->m_outputBudget->isFull() && !relieveOutputBudget(exp)) {
+            m_status = Status::Invalid;
+            return false;
+        }
+
+        if (exp->m_aggregator && exp->m_outputBudget && exp->m_outputBudget->isFull()
+                && hasNext && m_step < exp->pauseAt() && waitForTrialsBehind(exp)) {
+            m_model->syncNodes();
+            if (!writeGroupSteps(exp)) {
+                m_status = Status::Invalid;
+                return false;
+            }
+            m_yielded = true;
+            return true;
+        }
+
+        if (exp->m_checkpointWriter && m_checkpointTimer.hasExpired(exp->m_checkpointInterval)
+                && !checkpoint(exp)) {
             m_status = Status::Invalid;
             return false;
         }
@@ -207,6 +479,23 @@ bool Trial::runSteps()
         if (exp->delay() > 0) {
             QThread::msleep(exp->delay());
         }
+
+        // time-sliced mode: yield only if there is someone waiting
+        if ((quantumSteps > 0 && sliceSteps >= quantumSteps) ||
+                (quantumMsecs > 0 && slice.hasExpired(quantumMsecs))) {
+            if (hasNext && m_step < exp->pauseAt() && expMgr->hasQueuedTrials()) {
+                // partial results are available straight away
+                m_model->syncNodes();
+                if (!writeGroupSteps(exp)) {
+                    m_status = Status::Invalid;
+                    return false;
+                }
+                m_yielded = true;
+                return true;
+            }
+            sliceSteps = 0;
+            slice.restart();
+        }
     }
 
     m_model->afterLoop();
@@ -217,39 +506,339 @@ bool Trial::runSteps()
     return hasNext;
 }
 
-bool Trial::writeCachedSteps(const Experiment* exp) const
+int Trial::grantSteps(const Experiment* exp, int quantumLeft) const
+{
+    // someone looks at the trial after each step
+    if (m_cycleWindow > 0 || isWatched() || exp->delay() > 0) {
+        return 1;
+    }
+
+    // pauseAt is never beyond stopAt, so the final step is never skipped
+    int grant = std::min(m_batchSteps, exp->pauseAt() - m_step);
+    const int stepsToFlush = exp->m_mainApp->stepsToFlush();
+    grant = std::min(grant, stepsToFlush - m_step % stepsToFlush);
+    if (quantumLeft > 0) {
+        grant = std::min(grant, quantumLeft);
+    }
+    for (const Trial* trial : m_group) {
+        for (const OutputPtr& output : exp->m_outputs) {
+            if (grant <= 1) {
+                break;
+            }
+            grant = std::min(grant, output->nextDue(trial) - m_step);
+        }
+    }
+    return std::max(grant, 1);
+}
+
+bool Trial::detectCycle()
 {
-    if (exp->inputs()->fileCaches().empty() ||
-            exp->inputs()->fileCaches().front()->isEmpty(m_id)) {
+    const quint64 hash = m_graph->stateHash();
+    auto it = m_seenStates.find(hash);
+    if (it != m_seenStates.end()) {
+        m_cyclePeriod = m_step - it->second;
         return true;
     }
 
-    const QString fpath = exp->m_filePathPrefix + QString("%1.csv").arg(m_id);
-    QFile file(fpath);
-    if (!file.open(QFile::WriteOnly | QFile::Append)) {
-        qWarning() << "unable to create the trials. Could not write in " << fpath;
+    m_seenStates.insert({hash, m_step});
+    m_stateHistory.emplace_back(hash);
+    if (static_cast<int>(m_stateHistory.size()) > m_cycleWindow) {
+        m_seenStates.erase(m_stateHistory.front());
+        m_stateHistory.pop_front();
+    }
+    return false;
+}
+
+bool Trial::fillCycle(const Experiment* exp)
+{
+    const int start = m_step;
+    const int last = exp->stopAt();
+    const int period = m_cyclePeriod;
+
+    // The state at 'start + k' is the phase 'k % period' of the cycle.
+    // It takes at most 'period - 1' steps to compute the outputs of all
+    // phases; the following steps are copies of them.
+    std::vector<std::vector<Values>> phases;
+    phases.reserve(static_cast<size_t>(period));
+    for (int k = 0; k < period && start + k <= last; ++k) {
+        if (k > 0) {
+            m_model->algorithmStep();
+            m_model->syncNodes();
+        }
+        std::vector<Values> values;
+        for (const OutputPtr& output : exp->m_outputs) {
+            values.emplace_back(output->computeNow(this));
+        }
+        phases.emplace_back(std::move(values));
+    }
+
+    // leaves the graph as it would be at the last step
+    const int lastPhase = (last - start) % period;
+    for (int k = static_cast<int>(phases.size()) - 1; k != lastPhase; k = (k + 1) % period) {
+        m_model->algorithmStep();
+    }
+
+    for (m_step = start + 1; m_step <= last; ++m_step) {
+        const std::vector<Values>& values = phases.at(static_cast<size_t>((m_step - start) % period));
+        size_t i = 0;
+        for (const OutputPtr& output : exp->m_outputs) {
+            output->record(this, m_step, values.at(i++), m_step == last);
+        }
+
+        if (m_step % exp->m_mainApp->stepsToFlush() == 0 && !writeCachedSteps(exp)) {
+            return false;
+        }
+
+        if (exp->m_outputBudget && exp->m_outputBudget->isFull() && !relieveOutputBudget(exp)) {
+            return false;
+        }
+    }
+    m_step = last;
+    return true;
+}
+
+bool Trial::relieveOutputBudget(const Experiment* exp)
+{
+    OutputBudget* budget = exp->m_outputBudget.get();
+    if (budget->policy() == OutputBudget::Policy::Spill) {
+        return true; // the new rows go to disk
+    }
+
+    // this trial is the consumer of its file rows (and of those of its
+    // replicas); let's write them earlier
+    if (!writeGroupSteps(exp)) {
         return false;
     }
 
-    QTextStream stream(&file);
-    do {
-        QString row;
-        for (Cache* cache : exp->inputs()->fileCaches()) {
-            Values vals = cache->readFrontRow(m_id).second;
-            cache->flushFrontRow(m_id);
-            for (auto const& val : vals) {
-                row += val.toQString() + ",";
+    if (budget->policy() == OutputBudget::Policy::Block) {
+        // wait for the other consumers (eg., charts), but not longer than
+        // the experiment is meant to run; if the memory is mostly held by
+        // the summary instead, see waitForTrialsBehind()
+        const OutputAggregator* aggregator = exp->m_aggregator.get();
+        while (!budget->waitForRoom(100) && m_step < exp->pauseAt()
+               && !(aggregator && aggregator->usage() >= budget->limit() / 2)) {}
+    }
+    return true;
+}
+
+bool Trial::waitForTrialsBehind(const Experiment* exp) const
+{
+    // The trials behind might be still queued, waiting for a thread; so,
+    // it can't just block as with OutputBudget::Policy::Block.
+    OutputAggregator* aggregator = exp->m_aggregator.get();
+    const OutputBudget* budget = exp->m_outputBudget.get();
+    const ExperimentsMgr* expMgr = exp->m_mainApp->expMgr();
+    while (budget->isFull() && aggregator->usage() >= budget->limit() / 2
+           && aggregator->isAhead(m_id) && m_step < exp->pauseAt()) {
+        if (expMgr->hasQueuedTrials()) {
+            return true;
+        }
+        aggregator->waitForProgress(100);
+    }
+    return false;
+}
+
+bool Trial::checkpoint(const Experiment* exp)
+{
+    if (!writeCachedSteps(exp)) {
+        return false;
+    }
+
+    m_model->syncNodes();
+
+    // the rows written after the checkpoint are discarded when resuming
+    const qint64 fileSize = hasOwnFile() ? QFileInfo(filePath()).size() : -1;
+
+    QByteArray state;
+    QDataStream out(&state, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_8);
+    out << static_cast<qint32>(m_step) << QByteArray::fromStdString(m_prg->state()) << fileSize;
+
+    const std::vector<Cache*>& caches = exp->inputs()->fileCaches();
+    out << static_cast<quint32>(caches.size());
+    for (const Cache* cache : caches) {
+        const Values lastValues = cache->output()->lastValues(m_id);
+        out << static_cast<quint32>(lastValues.size());
+        for (const Value& v : lastValues) {
+            out << v;
+        }
+    }
+
+    if (m_graph->saveState(out) && m_model->saveState(out) && out.status() == QDataStream::Ok) {
+        exp->m_checkpointWriter->write(exp->checkpointPath(m_id), std::move(state));
+    } else {
+        // not critical; the previous checkpoint is still there
+        qWarning() << "unable to save the state of the trial" << m_id
+                   << "Experiment:" << exp->id();
+    }
+
+    m_checkpointTimer.restart();
+    return true;
+}
+
+bool Trial::loadState(const QByteArray& state)
+{
+    QDataStream in(state);
+    in.setVersion(QDataStream::Qt_5_8);
+
+    qint32 step;
+    QByteArray prgState;
+    qint64 fileSize;
+    in >> step >> prgState >> fileSize;
+    if (in.status() != QDataStream::Ok || step < 0 || step > m_exp->stopAt()
+            || !m_prg->setState(prgState.toStdString())) {
+        return false;
+    }
+
+    // the outputs must be the same as when the checkpoint was saved
+    const std::vector<Cache*>& caches = m_exp->inputs()->fileCaches();
+    quint32 numCaches;
+    in >> numCaches;
+    if (numCaches != caches.size() || (fileSize >= 0) != hasOwnFile()) {
+        qWarning() << "the outputs have changed since the checkpoint was saved.";
+        return false;
+    }
+    for (Cache* cache : caches) {
+        quint32 size;
+        in >> size;
+        Values lastValues(size);
+        for (Value& v : lastValues) {
+            in >> v;
+        }
+        cache->output()->setLastValues(m_id, std::move(lastValues));
+    }
+
+    if (in.status() != QDataStream::Ok || !m_graph->loadState(in)
+            || !m_model->loadState(in) || in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    if (fileSize >= 0) {
+        QFile file(filePath());
+        if (file.size() < fileSize || !file.resize(fileSize)) {
+            qWarning() << "the output file does not match the checkpoint:" << file.fileName();
+            return false;
+        }
+    }
+
+    m_step = step;
+    return true;
+}
+
+bool Trial::writeCachedSteps(const Experiment* exp) const
+{
+    const std::vector<Cache*>& caches = exp->inputs()->fileCaches();
+    OutputAggregator* aggregator = exp->m_aggregator.get();
+    auto isEmpty = [this](const Cache* c) { return c->isEmpty(m_id); };
+    if (!aggregator && std::all_of(caches.cbegin(), caches.cend(), isEmpty)) {
+        return true;
+    }
+
+    // in a shared file, the rows start with the ids
+    const bool writeRows = exp->m_fileMode != OutputFile::Mode::None;
+    QString rowPrefix;
+    if (exp->m_fileMode == OutputFile::Mode::Experiment) {
+        rowPrefix = QString("%1,").arg(m_id);
+    } else if (exp->m_fileMode == OutputFile::Mode::Project) {
+        rowPrefix = QString("%1,%2,").arg(exp->id()).arg(m_id);
+    }
+
+    QString block;
+    OutputAggregator::Observations observations;
+    while (true) {
+        // Outputs might have different sampling policies, so their rows are
+        // not necessarily aligned. As all outputs of a step are computed
+        // together, we write one line per step (the earliest one cached),
+        // leaving empty the cells of the outputs which skipped it.
+        int step = std::numeric_limits<int>::max();
+        for (const Cache* cache : caches) {
+            if (!cache->isEmpty(m_id)) {
+                step = std::min(step, cache->readFrontRow(m_id).first);
+            }
+        }
+        if (step == std::numeric_limits<int>::max()) {
+            break;
+        }
+
+        QString row = rowPrefix;
+        if (exp->m_fileHasStepColumn) {
+            row += QString::number(step) + ",";
+        }
+        int firstCol = 0; // index of the first column of the cache in the file
+        for (Cache* cache : caches) {
+            const int numCols = static_cast<int>(cache->inputs().size());
+            if (!cache->isEmpty(m_id) && cache->readFrontRow(m_id).first == step) {
+                const Cache::Row& cachedRow = cache->readFrontRow(m_id);
+                for (int col = 0; col < numCols; ++col) {
+                    const Value& value = cache->value(cachedRow, static_cast<size_t>(col));
+                    if (writeRows) {
+                        row += value.toQString() + ",";
+                    }
+                    if (aggregator) {
+                        // only numbers can be aggregated
+                        if (value.isInt()) {
+                            observations.push_back({step, firstCol + col, static_cast<double>(value.toInt())});
+                        } else if (value.isDouble()) {
+                            observations.push_back({step, firstCol + col, value.toDouble()});
+                        } else if (value.isBool()) {
+                            observations.push_back({step, firstCol + col, value.toBool() ? 1. : 0.});
+                        }
+                    }
+                }
+                cache->flushFrontRow(m_id);
+            } else if (writeRows) {
+                row += QString(numCols, ',');
             }
+            firstCol += numCols;
+        }
+        if (writeRows) {
+            row.chop(1);
+            block += row + "\n";
         }
-        row.chop(1);
-        stream << row << "\n";
+    }
+
+    // all rows up to the current step have been read
+    if (aggregator && !aggregator->fold(m_id, observations, m_step)) {
+        return false;
+    }
+
+    if (!writeRows || block.isEmpty()) {
+        return true;
+    }
 
-    // we synchronously flush all the io stuff. So, it's safe to say
-    // that if the front Output is empty, then all others are also empty.
-    } while (!exp->inputs()->fileCaches().front()->isEmpty(m_id));
+    if (exp->m_fileMode != OutputFile::Mode::Trial) {
+        // never fall back to the per-trial files, which have another header
+        if (!exp->m_outputFile) {
+            qWarning() << "unable to write the trial" << m_id << ": the shared output file is not open";
+            return false;
+        }
+        if (!exp->m_outputFile->append(block.toUtf8())) {
+            qWarning() << "unable to write the trial" << m_id << "in" << exp->m_outputFile->filePath();
+            return false;
+        }
+        return true;
+    }
 
+    const QString fpath = filePath();
+    QFile file(fpath);
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+        qWarning() << "unable to create the trials. Could not write in " << fpath;
+        return false;
+    }
+    QTextStream stream(&file);
+    stream << block;
     file.close();
     return true;
 }
 
+bool Trial::writeGroupSteps(const Experiment* exp) const
+{
+    for (const Trial* trial : m_group) {
+        if (!trial->writeCachedSteps(exp)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 } // evoplex
@@ -17,7 +17,11 @@
 #ifndef TRIAL_H
 #define TRIAL_H
 
+#include <atomic>
+#include <deque>
 #include <unordered_map>
+#include <vector>
+#include <QElapsedTimer>
 #include <QRunnable>
 
 #include "enum.h"
@@ -37,6 +41,8 @@ namespace evoplex {
  */
 class Trial : public QRunnable
 {
+    friend class AbstractModel;
+    friend class Experiment;
     friend class ExperimentsMgr;
 
 public:
@@ -55,32 +61,146 @@ public:
     inline Status status() const;
     inline int step() const;
     inline int stopAt() const;
+    // The period of the cycle where the trial has stopped (1 for a fixed
+    // point); 0 if none has been detected. See GENERAL_ATTR_CYCLEWINDOW.
+    inline int cyclePeriod() const;
+    // The (continuous) time between two steps; see GENERAL_ATTR_TIMESTEP.
+    inline double timeStep() const;
+    // The number of trials stepped together by this one (see
+    // GENERAL_ATTR_REPLICATES); 1 if it runs individually (ie, also when
+    // the model did not take the replicas) and 0 if another trial runs it.
+    inline int groupSize() const;
+
+    // The GUI registers itself while it displays the trial's nodes, so
+    // that the model writes them back at every step (see
+    // AbstractModel::syncNodes()). This method IS thread-safe.
+    inline void watch() const;
+    inline void unwatch() const;
 
     inline PRG* prg() const;
     inline const AbstractModel* model() const;
     inline AbstractGraph* graph() const;
 
+    // An estimate of the memory (in bytes) held by a graph with the given
+    // number of nodes, edges and attributes, including the containers.
+    static quint64 estimateFootprint(GraphType type, quint64 nodes, quint64 edges,
+                                     int nodeAttrs, int edgeAttrs);
+
+    // The memory (in bytes) held by this trial; ie, its graph measured with
+    // estimateFootprint() plus its share of the output rows.
+    // It's zero if the trial has not been initialized yet.
+    quint64 footprint() const;
+
 private:
     const quint16 m_id;
     ExperimentPtr m_exp;
     int m_step;
     Status m_status;
+    bool m_yielded; // true if the last runSteps() ended because of the quantum
+    quint64 m_footprint; // memory reserved by ExperimentsMgr::admit(); 0 if not admitted yet
+    int m_numaNode; // NUMA node where the trial has been initialized; -1 if unknown
+    mutable std::atomic<int> m_watchers; // see watch()
+
+    // cycle detection; see GENERAL_ATTR_CYCLEWINDOW
+    int m_cycleWindow;  // max period to be detected; 0 if disabled
+    int m_cyclePeriod;
+    std::unordered_map<quint64, int> m_seenStates; // <graph's state hash, step>
+    std::deque<quint64> m_stateHistory; // hashes in 'm_seenStates', oldest first
+
+    double m_timeStep; // see GENERAL_ATTR_TIMESTEP
+
+    int m_batchSteps; // max steps granted at once; adapted to the model's speed
+
+    // The trials of a group of replicates (see GENERAL_ATTR_REPLICATES) are
+    // run by the first one, which holds the group; it's just {this} for a
+    // trial run individually, and empty for the others of a group.
+    std::vector<Trial*> m_group;
 
     PRG* m_prg;
     AbstractGraph* m_graph;
     AbstractModel* m_model;
 
+    QElapsedTimer m_checkpointTimer; // time since the last checkpoint
+
     // We can safely consider that all parameters are valid at this point.
     // However, some things might fail (eg, missing nodes, broken graph etc),
     // and, in that case, false is returned.
     bool init();
 
+    // Initializes the other trials of the group and hands them to the model
+    // (see AbstractModel::takeReplicas()). If the model does not take them,
+    // they are submitted to run individually.
+    // Returns false if any of them could not be initialized.
+    bool initReplicas();
+
+    // Frees the graph and the model of a trial which has ended. It's only
+    // done when the trials are deleted at the end of the experiment anyway
+    // (see Experiment::autoDeleteTrials()), as nothing reads them anymore.
+    void freeState();
+
+    // sets the status of all trials of the group
+    void setStatus(Status s);
+
+    // true if the GUI displays any trial of the group; see watch()
+    bool isWatched() const;
+
+    // true if the experiment is no longer running or if any other trial
+    // failed to initialize; it is checked between the expensive init stages
+    inline bool initAborted() const;
+
     // The main loop for calling the model steps
     // Returns true if it has a next step
+    // In time-sliced mode (see ExperimentsMgr::setQuantum), it might return
+    // earlier, setting 'm_yielded', so the queued trials can run too.
     bool runSteps();
 
+    // The number of steps the model can perform at once from the current
+    // step (see AbstractModel::algorithmSteps()), ie, up to the next
+    // output sample, flush, pause/stop point or end of the quantum; 1 if
+    // the trial must be looked at after every step.
+    int grantSteps(const Experiment* exp, int quantumLeft) const;
+
+    // Records the state of the graph at the current step. Returns true
+    // if it has been seen within the window; 'm_cyclePeriod' is set then.
+    // Note that it only looks at the nodes' attributes, so it's only
+    // meaningful for models without any other (eg, random) state.
+    bool detectCycle();
+
+    // Fills the outputs of the remaining steps (up to stopAt) by repeating
+    // the cycle detected at the current step, and leaves the graph at the
+    // state it would have at stopAt. Returns false if the rows could not
+    // be written.
+    bool fillCycle(const Experiment* exp);
+
     // If any file output is set, it'll write the cached steps to file.
     bool writeCachedSteps(const Experiment* exp) const;
+    // writeCachedSteps() for all trials of the group
+    bool writeGroupSteps(const Experiment* exp) const;
+
+    // Called when the memory for the output rows is full; it reacts
+    // according to the OutputBudget::Policy of the experiment.
+    // Returns false if the cached steps could not be written.
+    bool relieveOutputBudget(const Experiment* exp);
+
+    // Called when the memory for the output rows is full. If most of it is
+    // held by the statistics of the summary (see OutputAggregator) because
+    // this trial is ahead of others, it waits for them to catch up.
+    // Returns true if it should give its thread to the queued trials.
+    bool waitForTrialsBehind(const Experiment* exp) const;
+
+    // Saves the full state of the trial (step, PRG, nodes, edges, model and
+    // output state) in the background. The cached steps are written first,
+    // so the output file matches the checkpoint.
+    // Returns false if the cached steps could not be written.
+    bool checkpoint(const Experiment* exp);
+
+    // Restores the state saved by checkpoint(). It must be called at the
+    // end of init(), when the graph and the model are ready.
+    bool loadState(const QByteArray& state);
+
+    // true if this trial writes its own output file
+    inline bool hasOwnFile() const;
+    inline QString filePath() const;
 };
 
 /************************************************************************
@@ -93,12 +213,27 @@ inline quint16 Trial::id() const
 inline int Trial::step() const
 { return m_step; }
 
+inline int Trial::cyclePeriod() const
+{ return m_cyclePeriod; }
+
+inline double Trial::timeStep() const
+{ return m_timeStep; }
+
+inline int Trial::groupSize() const
+{ return static_cast<int>(m_group.size()); }
+
 inline int Trial::stopAt() const
 { return m_exp->stopAt(); }
 
 inline Status Trial::status() const
 { return m_status; }
 
+inline void Trial::watch() const
+{ ++m_watchers; }
+
+inline void Trial::unwatch() const
+{ --m_watchers; }
+
 inline PRG* Trial::prg() const
 { return m_prg; }
 
@@ -108,5 +243,14 @@ inline const AbstractModel* Trial::model() const
 inline AbstractGraph* Trial::graph() const
 { return m_graph; }
 
+inline bool Trial::initAborted() const
+{ return m_exp->m_initFailed || m_exp->expStatus() == Status::Invalid || m_exp->pauseAt() < 0; }
+
+inline bool Trial::hasOwnFile() const
+{ return !m_exp->m_filePathPrefix.isEmpty() && m_exp->m_fileMode == OutputFile::Mode::Trial; }
+
+inline QString Trial::filePath() const
+{ return m_exp->m_filePathPrefix + QString("%1.csv").arg(m_id); }
+
 } // evoplex
 #endif // TRIAL_H
@@ -0,0 +1,281 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cputopology.h"
+#include "trialscheduler.h"
+
+namespace evoplex
+{
+
+TrialScheduler::Affinity TrialScheduler::affinityFromString(const QString& affinity)
+{
+    if (affinity == "cores") return Affinity::Cores;
+    if (affinity == "nodes") return Affinity::Nodes;
+    return Affinity::None;
+}
+
+QString TrialScheduler::affinityToString(Affinity affinity)
+{
+    switch (affinity) {
+    case Affinity::Cores: return "cores";
+    case Affinity::Nodes: return "nodes";
+    default: return "none";
+    }
+}
+
+TrialScheduler::TrialScheduler(int numWorkers, std::function<void(Trial*)> runTrial)
+    : m_runTrial(runTrial),
+      m_numActive(0),
+      m_affinity(Affinity::None),
+      m_affinityEpoch(0),
+      m_nextWorker(0),
+      m_queued(0),
+      m_stop(false)
+{
+    Q_ASSERT_X(numWorkers > 0, "TrialScheduler", "there must be at least one worker");
+    const int maxWorkers = std::max(numWorkers, QThread::idealThreadCount());
+    m_workers.reserve(static_cast<size_t>(maxWorkers));
+    for (int i = 0; i < maxWorkers; ++i) {
+        m_workers.emplace_back(new Worker(this, i));
+    }
+    resize(numWorkers);
+}
+
+TrialScheduler::~TrialScheduler()
+{
+    m_sleepMutex.lock();
+    m_stop = true;
+    m_wakeUp.wakeAll();
+    m_sleepMutex.unlock();
+    for (auto& w : m_workers) {
+        w->wait();
+    }
+}
+
+void TrialScheduler::resize(int numWorkers)
+{
+    numWorkers = std::min(std::max(1, numWorkers), maxWorkers());
+
+    QMutexLocker locker(&m_resizeMutex);
+    m_numActive = numWorkers;
+    for (int i = 0; i < numWorkers; ++i) {
+        Worker* w = m_workers[static_cast<size_t>(i)].get();
+        if (!w->alive) {
+            w->wait(); // it might be still returning from run()
+            w->alive = true;
+            w->start();
+        }
+    }
+    locker.unlock();
+
+    // the excess workers might be sleeping
+    QMutexLocker sleepLocker(&m_sleepMutex);
+    m_wakeUp.wakeAll();
+}
+
+void TrialScheduler::setAffinity(Affinity affinity)
+{
+    const CpuTopology& topology = CpuTopology::instance();
+    if (topology.numNodes() < 2) {
+        affinity = Affinity::None; // nothing to gain
+    }
+
+    // the nodes are read by the workers at any time (atomically), but they
+    // are only written here; concurrent calls must not interleave them
+    QMutexLocker locker(&m_resizeMutex);
+    if (affinity == m_affinity) {
+        return;
+    }
+
+    m_affinity = affinity;
+    for (int i = 0; i < maxWorkers(); ++i) {
+        const std::vector<int> cpus = workerCpus(i);
+        m_workers[static_cast<size_t>(i)]->node = cpus.empty() ? -1 : topology.nodeOf(cpus.front());
+    }
+    ++m_affinityEpoch;
+}
+
+std::vector<int> TrialScheduler::workerCpus(int index) const
+{
+    const CpuTopology& topology = CpuTopology::instance();
+    const int numNodes = topology.numNodes();
+    if (m_affinity == Affinity::Nodes) {
+        return topology.cpus(index % numNodes);
+    } else if (m_affinity == Affinity::Cores) {
+        // interleaves the nodes, so a few workers use all the memory controllers
+        std::vector<int> cores;
+        for (size_t i = 0; cores.size() < static_cast<size_t>(topology.numCpus()); ++i) {
+            for (int node = 0; node < numNodes; ++node) {
+                if (i < topology.cpus(node).size()) {
+                    cores.emplace_back(topology.cpus(node).at(i));
+                }
+            }
+        }
+        return {cores.at(static_cast<size_t>(index) % cores.size())};
+    }
+    return std::vector<int>();
+}
+
+void TrialScheduler::submit(const std::vector<Trial*>& trials, int node)
+{
+    if (trials.empty()) {
+        return;
+    }
+
+    deal(trials, node);
+
+    m_queued += static_cast<int>(trials.size());
+    QMutexLocker locker(&m_sleepMutex);
+    m_wakeUp.wakeAll();
+}
+
+void TrialScheduler::deal(const std::vector<Trial*>& trials, int node)
+{
+    // a retiring worker might still get a few trials here;
+    // they are stolen by the others
+    std::vector<Worker*> workers;
+    const int numActive = m_numActive;
+    for (int i = 0; i < numActive; ++i) {
+        Worker* w = m_workers[static_cast<size_t>(i)].get();
+        if (node < 0 || w->node == node) {
+            workers.emplace_back(w);
+        }
+    }
+    if (workers.empty()) { // no active worker in that node
+        for (int i = 0; i < numActive; ++i) {
+            workers.emplace_back(m_workers[static_cast<size_t>(i)].get());
+        }
+    }
+
+    const size_t numWorkers = workers.size();
+    const size_t first = m_nextWorker.fetch_add(static_cast<unsigned>(trials.size())) % numWorkers;
+    for (size_t w = 0; w < numWorkers && w < trials.size(); ++w) {
+        Worker* worker = workers[(first + w) % numWorkers];
+        QMutexLocker locker(&worker->mutex);
+        for (size_t i = w; i < trials.size(); i += numWorkers) {
+            worker->trials.emplace_back(trials[i]);
+        }
+    }
+}
+
+int TrialScheduler::removeIf(const std::function<bool(const Trial*)>& pred)
+{
+    int removed = 0;
+    for (auto& w : m_workers) {
+        QMutexLocker locker(&w->mutex);
+        auto it = std::remove_if(w->trials.begin(), w->trials.end(), pred);
+        removed += static_cast<int>(std::distance(it, w->trials.end()));
+        w->trials.erase(it, w->trials.end());
+    }
+    m_queued -= removed;
+    return removed;
+}
+
+Trial* TrialScheduler::take(const int index)
+{
+    Worker* self = m_workers[static_cast<size_t>(index)].get();
+    {
+        QMutexLocker locker(&self->mutex);
+        if (!self->trials.empty()) {
+            Trial* trial = self->trials.front();
+            self->trials.pop_front();
+            --m_queued;
+            return trial;
+        }
+    }
+
+    // steal from the others, starting from the next one;
+    // the workers in the same node come first, so the trials stay close
+    // to the memory they have allocated
+    const size_t numWorkers = m_workers.size();
+    const int node = self->node;
+    for (int pass = node < 0 ? 1 : 0; pass < 2; ++pass) {
+        for (size_t i = 1; i < numWorkers; ++i) {
+            Worker* victim = m_workers[(static_cast<size_t>(index) + i) % numWorkers].get();
+            if (pass == 0 && victim->node != node) {
+                continue;
+            }
+            QMutexLocker locker(&victim->mutex);
+            if (!victim->trials.empty()) {
+                Trial* trial = victim->trials.back();
+                victim->trials.pop_back();
+                --m_queued;
+                return trial;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void TrialScheduler::work(const int index)
+{
+    while (!m_stop) {
+        if (index >= m_numActive && retire(index)) {
+            return;
+        }
+
+        Worker* self = m_workers[static_cast<size_t>(index)].get();
+        if (self->affinityEpoch != m_affinityEpoch) {
+            self->affinityEpoch = m_affinityEpoch;
+            std::vector<int> cpus = workerCpus(index);
+            if (cpus.empty()) { // unpinned
+                const CpuTopology& topology = CpuTopology::instance();
+                for (int node = 0; node < topology.numNodes(); ++node) {
+                    cpus.insert(cpus.end(), topology.cpus(node).begin(), topology.cpus(node).end());
+                }
+            }
+            CpuTopology::pinCurrentThread(cpus);
+        }
+
+        Trial* trial = take(index);
+        if (trial) {
+            m_runTrial(trial);
+            continue;
+        }
+
+        QMutexLocker locker(&m_sleepMutex);
+        while (m_queued <= 0 && !m_stop && index < m_numActive) {
+            m_wakeUp.wait(&m_sleepMutex);
+        }
+    }
+}
+
+bool TrialScheduler::retire(const int index)
+{
+    QMutexLocker locker(&m_resizeMutex);
+    if (index < m_numActive) {
+        return false;
+    }
+
+    Worker* self = m_workers[static_cast<size_t>(index)].get();
+    self->alive = false;
+
+    // hands the queued trials over to the active workers
+    std::vector<Trial*> trials;
+    {
+        QMutexLocker selfLocker(&self->mutex);
+        trials.assign(self->trials.begin(), self->trials.end());
+        self->trials.clear();
+    }
+    if (!trials.empty()) {
+        deal(trials);
+        QMutexLocker sleepLocker(&m_sleepMutex);
+        m_wakeUp.wakeAll();
+    }
+    return true;
+}
+
+} // evoplex
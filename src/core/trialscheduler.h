@@ -0,0 +1,151 @@
+/* Evoplex <https://evoplex.org>
+ * Copyright (C) 2016-present - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRIALSCHEDULER_H
+#define TRIALSCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace evoplex
+{
+
+class Trial;
+
+/**
+ * @brief Runs trials in a fixed set of worker threads with work stealing.
+ *
+ * Each worker owns a deque of trials guarded by its own mutex. New trials
+ * are dealt round-robin to the workers; a worker takes the trials from the
+ * front of its own deque (ie., in the order they were submitted) and, when
+ * it runs out of work, steals from the back of the other deques. So, the
+ * workers only contend with each other when they steal, and there is no
+ * lock shared by all of them. Idle workers sleep until new trials arrive.
+ *
+ * The pool is elastic: resize() starts new workers immediately, while the
+ * excess ones finish their current trial (or quantum; see
+ * ExperimentsMgr::setQuantum), hand their queued trials over to the active
+ * workers and exit. The queued and running trials are not affected.
+ *
+ * Optionally, the workers are pinned to cores or to NUMA nodes (see
+ * setAffinity()). A trial can then be submitted to the workers of a
+ * given node, and idle workers steal from their own node first.
+ */
+class TrialScheduler
+{
+public:
+    enum class Affinity {
+        None,  // the OS places the workers (default)
+        Cores, // each worker is pinned to a core; the cores are spread across the nodes
+        Nodes  // each worker is pinned to the cores of a node, round-robin
+    };
+    static Affinity affinityFromString(const QString& affinity);
+    static QString affinityToString(Affinity affinity);
+
+    // 'runTrial' is called in the worker threads for each trial.
+    // The pool can grow up to max(numWorkers, QThread::idealThreadCount()).
+    explicit TrialScheduler(int numWorkers, std::function<void(Trial*)> runTrial);
+    // Waits for the running trials; the queued ones are dropped.
+    ~TrialScheduler();
+
+    // Queues the trials. If 'node' is a NUMA node, they go to the workers
+    // pinned to it, if any. This method IS thread-safe.
+    void submit(const std::vector<Trial*>& trials, int node=-1);
+
+    // Removes the queued trials which satisfy 'pred'.
+    // Returns the number of trials removed.
+    int removeIf(const std::function<bool(const Trial*)>& pred);
+
+    // Sets the number of active workers; it does not block.
+    // This method IS thread-safe.
+    void resize(int numWorkers);
+
+    // Sets how the workers are placed on the CPUs. Each worker applies it
+    // before taking its next trial. It's a no-op on single-node machines.
+    // This method IS thread-safe.
+    void setAffinity(Affinity affinity);
+    inline Affinity affinity() const { return m_affinity; }
+    // the cpus the worker 'index' is (or will be) pinned to; empty if none
+    std::vector<int> workerCpus(int index) const;
+    // the NUMA node of the worker 'index'; -1 if it's not pinned to one
+    inline int workerNode(int index) const { return m_workers.at(static_cast<size_t>(index))->node; }
+
+    inline int numWorkers() const { return m_numActive; }
+    inline int maxWorkers() const { return static_cast<int>(m_workers.size()); }
+    // number of trials waiting for a worker
+    inline int numQueued() const { return std::max(0, m_queued.load()); }
+
+private:
+    class Worker : public QThread
+    {
+    public:
+        Worker(TrialScheduler* scheduler, int index)
+            : m_scheduler(scheduler), m_index(index) {}
+        QMutex mutex;
+        std::deque<Trial*> trials;
+        bool alive = false; // guarded by m_resizeMutex
+        std::atomic<int> node{-1}; // see workerNode(); written under m_resizeMutex
+        int affinityEpoch = 0; // only used by the worker thread
+    protected:
+        void run() override { m_scheduler->work(m_index); }
+    private:
+        TrialScheduler* m_scheduler;
+        const int m_index;
+    };
+
+    const std::function<void(Trial*)> m_runTrial;
+    // all possible workers; only the first 'm_numActive' take new trials,
+    // so this vector never changes and can be read without a lock
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<int> m_numActive;
+    QMutex m_resizeMutex; // guards the start/exit of the workers and their nodes
+    std::atomic<Affinity> m_affinity;
+    std::atomic<int> m_affinityEpoch; // incremented whenever the affinity changes
+    std::atomic<unsigned> m_nextWorker; // round-robin
+    // Trials in the deques. It's incremented after the trials are pushed,
+    // so it might be transiently negative, but never above the actual number.
+    std::atomic<int> m_queued;
+    std::atomic<bool> m_stop;
+
+    QMutex m_sleepMutex; // only used by idle workers
+    QWaitCondition m_wakeUp;
+
+    // pushes the trials to the active workers (of the 'node', if any);
+    // it does not touch 'm_queued'
+    void deal(const std::vector<Trial*>& trials, int node=-1);
+
+    // the main loop of the worker 'index'
+    void work(const int index);
+
+    // Called when the worker 'index' is no longer active. Returns false
+    // (keep working) if it has been activated again meanwhile.
+    bool retire(const int index);
+    // takes a trial from the front of its own deque or
+    // from the back of another one; nullptr if there is nothing to do
+    Trial* take(const int index);
+};
+
+} // evoplex
+#endif // TRIALSCHEDULER_H
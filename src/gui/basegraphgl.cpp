@@ -102,6 +102,9 @@ BaseGraphGL::~BaseGraphGL()
 {
     m_exp->disconnect(this); // important to avoid triggering statusChanged()
     m_attrWidgets.clear();
+    if (m_trial) {
+        m_trial->unwatch();
+    }
     m_trial = nullptr;
     m_exp = nullptr;
     delete m_ui;
@@ -264,7 +267,13 @@ void BaseGraphGL::setNodeCMap(ColorMap* cmap)
 void BaseGraphGL::setTrial(quint16 trialId)
 {
     m_currTrialId = trialId;
+    if (m_trial) {
+        m_trial->unwatch();
+    }
     m_trial = m_exp->trial(trialId);
+    if (m_trial) {
+        m_trial->watch();
+    }
     if (m_trial && m_trial->model()) {
         m_ui->currStep->setText(QString::number(m_trial->step()));
     } else {
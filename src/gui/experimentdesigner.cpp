@@ -125,6 +125,12 @@ ExperimentDesigner::ExperimentDesigner(MainApp* mainApp, QWidget *parent)
     addGeneralAttr(m_treeItemGeneral, GENERAL_ATTR_TRIALS);
     // --  auto delete
     addGeneralAttr(m_treeItemGeneral, GENERAL_ATTR_AUTODELETE);
+    // --  stop when the state repeats (fixed point or cycle)
+    addGeneralAttr(m_treeItemGeneral, GENERAL_ATTR_CYCLEWINDOW);
+    addGeneralAttr(m_treeItemGeneral, GENERAL_ATTR_CYCLEFILL);
+    addGeneralAttr(m_treeItemGeneral, GENERAL_ATTR_TIMESTEP);
+    // --  replicates stepped together
+    addGeneralAttr(m_treeItemGeneral, GENERAL_ATTR_REPLICATES);
 
     // setup the tree widget: outputs
     m_treeItemOutputs = newTreeItem("File Outputs", false);
@@ -141,12 +147,18 @@ ExperimentDesigner::ExperimentDesigner(MainApp* mainApp, QWidget *parent)
     LineButton* outHeader = new LineButton(this, LineButton::None);
     connect(outHeader->button(), SIGNAL(pressed()), SLOT(slotOutputWidget()));
     addGeneralAttr(m_treeItemOutputs, OUTPUT_HEADER, outHeader);
-
-/* TODO: make the buttons to avgTrials and saveSteps work*/
-/*    // -- avgTrials
-    QtMaterialCheckBox* outAvgTrials = new QtMaterialCheckBox("average trials");
-    addGeneralAttr(m_treeItemOutputs, OUTPUT_AVGTRIALS, QVariant::fromValue(outAvgTrials));
-    // -- steps to save
+    // -- file mode: one file per trial, experiment or project
+    AttrWidget* outFileMode = addGeneralAttr(m_treeItemOutputs, OUTPUT_FILEMODE);
+    // -- avgTrials: summary statistics across trials
+    AttrWidget* outAvgTrials = addGeneralAttr(m_treeItemOutputs, OUTPUT_AVGTRIALS);
+    // -- memory for the rows waiting to be read (by files and charts)
+    addGeneralAttr(m_treeItemOutputs, OUTPUT_MEMLIMIT)->setValue(1024);
+    addGeneralAttr(m_treeItemOutputs, OUTPUT_MEMPOLICY);
+    // -- seconds between checkpoints of the trials
+    addGeneralAttr(m_treeItemOutputs, OUTPUT_CHECKPOINT);
+
+/* TODO: make the saveSteps button work*/
+/*    // -- steps to save
     QRadioButton* outAllSteps = new QRadioButton("all");
     outAllSteps->setChecked(true);
     QRadioButton* outLastSteps = new QRadioButton("last");
@@ -165,11 +177,12 @@ ExperimentDesigner::ExperimentDesigner(MainApp* mainApp, QWidget *parent)
     m_ui->treeWidget->setItemWidget(itemOut, 1, outStepsLayout->parentWidget());
 */
     connect(m_enableOutputs, &AttrWidget::valueChanged,
-        [this, outDir, outHeader]() {
+        [this, outDir, outHeader, outFileMode, outAvgTrials]() {
             bool b = m_enableOutputs->value().toBool();
             outDir->setEnabled(b);
             outHeader->setEnabled(b);
-//          outAvgTrials->setEnabled(b);
+            outFileMode->setEnabled(b);
+            outAvgTrials->setEnabled(b);
         });
     m_enableOutputs->setValue(true);
     m_enableOutputs->setValue(false);
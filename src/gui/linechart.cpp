@@ -189,6 +189,16 @@ void LineChart::removeAllSeries()
 
 void LineChart::updateSeries()
 {
+    // a hidden chart does not read its rows; so, if they are taking too
+    // much memory, let's skip them instead of holding the trials back
+    const OutputBudget* budget = m_exp->outputBudget();
+    if (!m_chart->isVisible() && budget && budget->isFull()
+            && budget->policy() != OutputBudget::Policy::Spill) {
+        for (Series& s : m_series) {
+            s.cache->flushAll();
+        }
+    }
+
     if (!m_trial || !m_trial->model() || !m_chart->isVisible() ||
             m_series.empty() || m_trial->step() == m_currStep) {
         return;
@@ -210,13 +220,20 @@ void LineChart::updateSeries()
         bool lastWasDuplicated = false;
         do {
             const Cache::Row& row = s.cache->readFrontRow(m_currTrialId);
-            Q_ASSERT_X(row.second.size() == 1, "LineChart", "it must have only one column");
+            Q_ASSERT_X(s.cache->inputs().size() == 1, "LineChart", "it must have only one column");
+
+            const Value& value = s.cache->value(row, 0);
+            if (!value.isValid()) {
+                // computed just before the series was added
+                s.cache->flushFrontRow(m_currTrialId);
+                continue;
+            }
 
             x = row.first;
-            if (row.second.at(0).type() == Value::INT) {
-                y = row.second.at(0).toInt();
-            } else if (row.second.at(0).type() == Value::DOUBLE) {
-                y = row.second.at(0).toDouble();
+            if (value.type() == Value::INT) {
+                y = value.toInt();
+            } else if (value.type() == Value::DOUBLE) {
+                y = value.toDouble();
             } else {
                 qFatal("the type is invalid!");
             }
@@ -74,6 +74,7 @@ OutputWidget::OutputWidget(const ModelPlugin* modelPlugin, const std::vector<int
                 RowInfo rowInfo;
                 rowInfo.id = m_ui->table->rowCount();
                 rowInfo.equalToId = rowInfo.id == rootId ? -1 : rootId;
+                rowInfo.sampling = df->sampling();
                 insertRow(rowInfo, df->functionStr(), DefaultFunc, entityStr, df->entity(),
                           df->attrRange()->attrName(), input.toQString());
             }
@@ -82,6 +83,7 @@ OutputWidget::OutputWidget(const ModelPlugin* modelPlugin, const std::vector<int
                 RowInfo rowInfo;
                 rowInfo.id = m_ui->table->rowCount();
                 rowInfo.equalToId = rowInfo.id == rootId ? -1 : rootId;
+                rowInfo.sampling = cache->output()->sampling();
                 insertRow(rowInfo, func.toQString(), CustomFunc);
             }
         } else {
@@ -140,10 +142,10 @@ void OutputWidget::slotClose(bool canceled)
                 Value input = entityAttrRange->validate(inputStr);
                 DefaultOutput::Function func = DefaultOutput::funcFromString(funcStr);
                 Q_ASSERT(func != DefaultOutput::F_Invalid && input.isValid());
-                OutputPtr newOutput (new DefaultOutput(func, entity, entityAttrRange));
+                OutputPtr newOutput (new DefaultOutput(func, entity, entityAttrRange, rinfo.sampling));
                 cache = newOutput->addCache({input}, m_trialIds);
             } else {
-                OutputPtr newOutput (new CustomOutput());
+                OutputPtr newOutput (new CustomOutput(rinfo.sampling));
                 cache = newOutput->addCache({Value(funcStr)}, m_trialIds);
             }
             m_allCaches.insert({rinfo.id, cache});
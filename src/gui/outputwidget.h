@@ -38,6 +38,7 @@ public:
     struct RowInfo {
         int id = -1;
         int equalToId = -1; // when Output* is the same, but with different inputs
+        SamplingPolicy sampling; // keeps the policy set in the output header
     };
 
     // It creates a new Cache* for each row (which can take only one input).
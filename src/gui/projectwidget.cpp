@@ -62,6 +62,8 @@ ProjectWidget::ProjectWidget(ProjectPtr project, MainGUI* mainGUI, ProjectsPage*
             SLOT(slotHasUnsavedChanges(bool)));
 
     m_ui->table->init(mainGUI->mainApp()->expMgr());
+    connect(mainGUI->mainApp()->expMgr(), SIGNAL(progressUpdated()),
+            SLOT(slotUpdateOutputMem()));
 
     connect(m_ui->table, SIGNAL(itemSelectionChanged()), SLOT(slotSelectionChanged()));
     connect(m_ui->table, SIGNAL(itemDoubleClicked(QTableWidgetItem*)),
@@ -156,6 +158,7 @@ void ProjectWidget::fillRow(int row, const ExperimentPtr& exp)
     insertItem(row, TableWidget::H_SEED, exp->inputs()->general(GENERAL_ATTR_SEED).toQString());
     insertItem(row, TableWidget::H_STOPAT, exp->inputs()->general(GENERAL_ATTR_STOPAT).toQString());
     insertItem(row, TableWidget::H_TRIALS, exp->inputs()->general(GENERAL_ATTR_TRIALS).toQString());
+    insertItem(row, TableWidget::H_OUTPUTMEM, "-", "memory taken by the output rows waiting to be read");
 
     if (exp->expStatus() == Status::Invalid) {
         m_ui->table->setSortingEnabled(true);
@@ -214,6 +217,30 @@ void ProjectWidget::slotRemoveRow(int expId)
     }
 }
 
+void ProjectWidget::slotUpdateOutputMem()
+{
+    const double mb = 1024. * 1024.;
+    for (int row = 0; row < m_ui->table->rowCount(); ++row) {
+        const int expId = m_ui->table->item(row, TableWidget::H_EXPID)->text().toInt();
+        const ExperimentPtr exp = m_project->experiment(expId);
+        QTableWidgetItem* item = m_ui->table->item(row, TableWidget::H_OUTPUTMEM);
+        if (!exp || !item) {
+            continue;
+        }
+
+        const OutputBudget* budget = exp->outputBudget();
+        QString text("-");
+        if (budget) {
+            text = QString::number(budget->usage() / mb, 'f', 1);
+            if (budget->limit() > 0) {
+                text += QString(" / %1").arg(budget->limit() / mb, 0, 'f', 0);
+            }
+            text += " MB";
+        }
+        item->setText(text);
+    }
+}
+
 void ProjectWidget::insertItem(int row, TableWidget::Header header,
                                const QString& label, const QString& tooltip)
 {
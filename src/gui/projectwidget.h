@@ -67,6 +67,8 @@ public slots:
 private slots:
     void slotSelectionChanged();
     void onItemDoubleClicked(QTableWidgetItem* item);
+    // shows how much of the output budget each experiment is using
+    void slotUpdateOutputMem();
 
 private:
     Ui_ProjectWidget* m_ui;
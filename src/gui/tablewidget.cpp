@@ -65,6 +65,7 @@ TableWidget::TableWidget(QWidget *parent)
     m_headerLabel.insert(H_MODEL, "Model");
     m_headerLabel.insert(H_GRAPH, "Graph");
     m_headerLabel.insert(H_TRIALS, "Trials");
+    m_headerLabel.insert(H_OUTPUTMEM, "Output buffer");
 
     setColumnCount(m_headerLabel.size());
     setHorizontalHeaderLabels(m_headerLabel.values());
@@ -81,6 +82,7 @@ TableWidget::TableWidget(QWidget *parent)
     horizontalHeader()->setSectionResizeMode(H_SEED, QHeaderView::ResizeToContents);
     horizontalHeader()->setSectionResizeMode(H_STOPAT, QHeaderView::ResizeToContents);
     horizontalHeader()->setSectionResizeMode(H_TRIALS, QHeaderView::ResizeToContents);
+    horizontalHeader()->setSectionResizeMode(H_OUTPUTMEM, QHeaderView::ResizeToContents);
     horizontalHeader()->setSectionResizeMode(H_MODEL, QHeaderView::Stretch);
     horizontalHeader()->setSectionResizeMode(H_GRAPH, QHeaderView::Stretch);
 
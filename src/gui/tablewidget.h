@@ -47,7 +47,8 @@ public:
         H_STOPAT,
         H_MODEL,
         H_GRAPH,
-        H_TRIALS
+        H_TRIALS,
+        H_OUTPUTMEM
     };
 
     explicit TableWidget(QWidget* parent);
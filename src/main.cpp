@@ -30,6 +30,7 @@
 #include <QStyleFactory>
 
 #include "config.h"
+#include "cli/batchrunner.h"
 #include "core/logger.h"
 #include "core/mainapp.h"
 #include "gui/maingui.h"
@@ -137,7 +138,7 @@ int main(int argc, char* argv[])
         result = app->exec();
     } else {
         // start console application
-        // TODO: handle args
+        result = evoplex::BatchRunner::exec(&mainApp, coreApp->arguments());
     }
 
     evoplex::Logger::instance()->destroy();
@@ -6,6 +6,9 @@
  * the LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <QDataStream>
+
 #include "plugin.h"
 
 namespace evoplex {
@@ -20,6 +23,7 @@ bool CellularAutomata1D::init()
 
     // starts reading from row=0
     m_currRow = 0;
+    m_syncedRow = 0;
 
     // checks if the `squareGrid` was set with periodic bondary conditions (i.e., a toroid)
     m_toroidal = graph()->attr("boundary") == "periodic";
@@ -37,36 +41,27 @@ bool CellularAutomata1D::init()
     m_stateAttrId = node(0).attrs().indexOf("state");
 
     // determines which rule to use
-    m_binrule = std::bitset<8>(attr("rule").toInt());
+    m_rule = static_cast<quint8>(attr("rule").toInt());
 
     return m_stateAttrId >= 0;
 }
 
-bool CellularAutomata1D::algorithmStep()
+void CellularAutomata1D::beforeLoop()
 {
-    // 1. gets first node in the current row
-    Node first = node(linearIdx(m_currRow, 0));
-
-    // 2. for each node (starting from the second),
-    int lastColumn = m_width - 1;
-    for (int col = 1; col < lastColumn; ++col) {
-        Node central = node(first.id() + col);
-        // a. compute the next state based on its neighbours on the left and right
-        Value state = nextState(node(central.id()-1), central, node(central.id()+1));
-        // b. assign the next state to the node below the current node
-        node(central.id()+m_width).setAttr(m_stateAttrId, state);
-    }
-
-    // 3. edge case: if the graph is a toroid, we compute the state for the last column
-    if (m_toroidal) {
-        Node last = node(linearIdx(m_currRow, lastColumn));
-        // a. compute the next state based on its left neighbour and the first node in the row
-        Value state = nextState(node(last.id()-1), last, first);
-        // b. assign the next state to the first node of the next row
-        node(first.id()+m_width).setAttr(m_stateAttrId, state);
+    // the nodes might have been edited while the trial was paused
+    m_cells.assign(nodes().size(), Node());
+    m_rows.assign(static_cast<size_t>(m_height), BitRow(m_width));
+    for (auto const& p : nodes()) {
+        m_cells.at(static_cast<size_t>(p.first)) = p.second;
+        m_rows.at(static_cast<size_t>(p.first / m_width))
+                .setCell(p.first % m_width, p.second.attr(m_stateAttrId).toBool());
     }
+    m_syncedRow = m_currRow;
+}
 
-    ++m_currRow;
+bool CellularAutomata1D::algorithmStep()
+{
+    advance(1);
     if (m_currRow == m_height-1) {
         // all rows have been filled; return false to stop the simulation
         return false;
@@ -74,18 +69,60 @@ bool CellularAutomata1D::algorithmStep()
     return true;
 }
 
-Value CellularAutomata1D::nextState(const Node& leftNode, const Node& node, const Node& rightNode) const
+bool CellularAutomata1D::algorithmSteps(int n, int& steps)
 {
-    bool left = leftNode.attr(m_stateAttrId).toBool();
-    bool center = node.attr(m_stateAttrId).toBool();
-    bool right = rightNode.attr(m_stateAttrId).toBool();
+    // as many rows as possible at once; the step which fills the last
+    // row is the last one, as in algorithmStep()
+    steps = std::max(advance(n), 1);
+    return m_currRow != m_height-1;
+}
 
-    return Value(m_binrule[left*4 + center*2 + right]);
+void CellularAutomata1D::afterLoop()
+{
+    syncNodes();
 }
 
-int CellularAutomata1D::linearIdx(int row, int col) const
+int CellularAutomata1D::advance(int rows)
 {
-    return row * m_width + col;
+    rows = std::min(rows, m_height - 1 - m_currRow);
+    for (int i = 0; i < rows; ++i) {
+        // the whole row below the current one at once; if the graph is not
+        // a toroid, the first and last columns are left untouched
+        m_rows[static_cast<size_t>(m_currRow + 1)].applyRule(
+                    m_rows[static_cast<size_t>(m_currRow)], m_rule, m_toroidal);
+        ++m_currRow;
+    }
+    return rows;
+}
+
+void CellularAutomata1D::syncNodes()
+{
+    const int first = m_toroidal ? 0 : 1;
+    const int last = m_toroidal ? m_width - 1 : m_width - 2;
+    for (int row = m_syncedRow + 1; row <= m_currRow; ++row) {
+        const BitRow& cells = m_rows[static_cast<size_t>(row)];
+        for (int col = first; col <= last; ++col) {
+            m_cells[static_cast<size_t>(row * m_width + col)].setAttr(m_stateAttrId, Value(cells.cell(col)));
+        }
+    }
+    m_syncedRow = m_currRow;
+}
+
+bool CellularAutomata1D::saveState(QDataStream& out) const
+{
+    out << static_cast<qint32>(m_currRow);
+    return out.status() == QDataStream::Ok;
+}
+
+bool CellularAutomata1D::loadState(QDataStream& in)
+{
+    qint32 row;
+    in >> row;
+    if (in.status() != QDataStream::Ok || row < 0 || row >= m_height) {
+        return false;
+    }
+    m_currRow = row;
+    return true;
 }
 
 } // evoplex
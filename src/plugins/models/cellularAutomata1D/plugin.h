@@ -9,7 +9,8 @@
 #ifndef CELLULARAUTOMATA1D_H
 #define CELLULARAUTOMATA1D_H
 
-#include <bitset>
+#include <vector>
+#include <bitgrid.h>
 #include <plugininterface.h>
 
 namespace evoplex {
@@ -17,24 +18,32 @@ class CellularAutomata1D: public AbstractModel
 {
 public:
     bool init() override;
+    void beforeLoop() override;
     bool algorithmStep() override;
+    bool algorithmSteps(int n, int& steps) override;
+    void afterLoop() override;
+    void syncNodes() override;
+    bool saveState(QDataStream& out) const override;
+    bool loadState(QDataStream& in) override;
 
 private:
     int m_currRow;
 
     int m_stateAttrId;  // the id of the `state` node attribute
-    std::bitset<8> m_binrule;  // binary representation of the automaton rule
+    quint8 m_rule;      // the automaton rule; bit i is the next state of the neighbourhood i
 
     bool m_toroidal;    // true if the graph is a toroid
     int m_width;        // the number of columns in the `squareGrid` graph
     int m_height;       // the number of rows in the `squareGrid` graph
 
-    // returns the next state of a node based on the state
-    // of itself and its neighbours on the left and right
-    Value nextState(const Node& leftNode, const Node& node, const Node& rightNode) const;
+    // The rows are kept bit-packed during the loop and are only written
+    // back to the nodes when they are read (see syncNodes()).
+    std::vector<BitRow> m_rows;
+    std::vector<Node> m_cells; // the node of each cell
+    int m_syncedRow;           // the last row written back to the nodes
 
-    // return the linear index of an element in a matrix.
-    int linearIdx(int row, int col) const;
+    // Fills up to 'rows' rows below the current one; returns how many.
+    int advance(int rows);
 };
 } // evoplex
 #endif // CELLULARAUTOMATA1D_H
@@ -14,15 +14,70 @@ bool GameOfLife::init()
 {
     // gets the id of the `live` node's attribute, which is the same for all nodes
     m_liveAttrId = node(0).attrs().indexOf("live");
-    return m_liveAttrId >= 0;
+    if (m_liveAttrId < 0) {
+        return false;
+    }
+
+    // The fast path relies on the node ids used by the squareGrid graph.
+    // Tiny periodic grids are left to the generic path, as a node might
+    // be linked to the same neighbour more than once.
+    m_packed = false;
+    const AbstractGraph* g = graph();
+    if (g->id() == "squareGrid") {
+        const int width = g->attr("width").toInt();
+        const int height = g->attr("height").toInt();
+        const bool periodic = g->attr("boundary").toQString() == "periodic";
+        m_packed = width * height == g->numNodes() && (!periodic || (width >= 3 && height >= 3));
+        if (m_packed) {
+            m_grid = BitGrid(width, height, g->attr("neighbours").toInt(), periodic);
+        }
+    }
+    return true;
+}
+
+void GameOfLife::beforeLoop()
+{
+    if (!m_packed) {
+        return;
+    }
+
+    // the nodes might have been edited while the trial was paused
+    m_cells.assign(nodes().size(), Node());
+    for (auto const& p : nodes()) {
+        m_cells.at(static_cast<size_t>(p.first)) = p.second;
+        m_grid.setCell(p.first, p.second.attr(m_liveAttrId).toBool());
+    }
+    m_grid.resetChanges();
+}
+
+void GameOfLife::afterLoop()
+{
+    syncNodes();
+}
+
+void GameOfLife::syncNodes()
+{
+    if (m_packed) {
+        m_grid.takeChanges([this](int id, bool live) {
+            m_cells[static_cast<size_t>(id)].setAttr(m_liveAttrId, Value(live));
+        });
+    }
 }
 
 bool GameOfLife::algorithmStep()
 {
-    std::vector<Value> nextStates;
-    nextStates.reserve(nodes().size());
+    if (m_packed) {
+        m_grid.lifeStep();
+        return true;
+    }
 
-    for (Node node : nodes()) {
+    // Only the nodes with a live neighbourhood which has changed in the
+    // last step might change now; the others are left untouched.
+    const std::vector<Node>& activeNodes = graph()->activeNodes();
+
+    m_nextStates.clear();
+    m_nextStates.reserve(activeNodes.size());
+    for (const Node& node : activeNodes) {
         int liveNeighbourCount = 0;
         for (Node neighbour : node.outEdges()){
             if (neighbour.attr(m_liveAttrId).toBool()) {
@@ -32,24 +87,27 @@ bool GameOfLife::algorithmStep()
 
         if (node.attr(m_liveAttrId).toBool()) {
             if (liveNeighbourCount < 2) { // Dies due to underpopulation
-                nextStates.emplace_back(false);
+                m_nextStates.emplace_back(false);
             } else if (liveNeighbourCount < 4) { // Lives to next state
-                nextStates.emplace_back(true);
+                m_nextStates.emplace_back(true);
             }  else { // Dies due to overpopulation
-                nextStates.emplace_back(false);
+                m_nextStates.emplace_back(false);
             }
         } else {
             // Any dead node with exactly three live neighbors
             // becomes a live node, as if by reproduction.
-            nextStates.emplace_back(liveNeighbourCount == 3);
+            m_nextStates.emplace_back(liveNeighbourCount == 3);
         }
     }
 
-    // For each node, load the next state into the current state
-    size_t i = 0;
-    for (Node node : nodes()) {
-        node.setAttr(m_liveAttrId, nextStates.at(i));
-        ++i;
+    // For each active node, load the next state into the current state;
+    // only the nodes which have actually changed are touched
+    for (size_t i = 0; i < activeNodes.size(); ++i) {
+        const bool next = m_nextStates[i];
+        if (activeNodes[i].attr(m_liveAttrId).toBool() != next) {
+            Node node = activeNodes[i];
+            node.setAttr(m_liveAttrId, next);
+        }
     }
     return true;
 }
@@ -9,6 +9,8 @@
 #ifndef GAME_OF_LIFE_H
 #define GAME_OF_LIFE_H
 
+#include <vector>
+#include <bitgrid.h>
 #include <plugininterface.h>
 
 namespace evoplex {
@@ -16,10 +18,20 @@ class GameOfLife: public AbstractModel
 {
 public:
     bool init() override;
+    void beforeLoop() override;
     bool algorithmStep() override;
+    void afterLoop() override;
+    void syncNodes() override;
 
 private:
     int m_liveAttrId;  // the id of the 'live' node's attribute
+    std::vector<bool> m_nextStates; // the next state of each active node
+
+    // On a 'squareGrid' graph, the cells are kept bit-packed during the
+    // loop and are only written back to the nodes when they are read.
+    bool m_packed;
+    BitGrid m_grid;
+    std::vector<Node> m_cells; // the node of each cell in 'm_grid'
 };
 } // evoplex
 #endif // GAME_OF_LIFEL_H
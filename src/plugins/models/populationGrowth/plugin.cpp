@@ -6,6 +6,9 @@
  * the LICENSE file in the root directory of this source tree.
  */
 
+#include <unordered_map>
+#include <QtAlgorithms>
+
 #include "plugin.h"
 
 namespace evoplex {
@@ -17,46 +20,155 @@ bool PopulationGrowth::init()
     // initializing model attribute, which is constant throughout the simulation
     m_prob = attr("prob").toDouble();
 
+    m_replicas.assign(1, this);
+    m_synced = true;
     return m_infectedAttrId >= 0;
 }
 
-bool PopulationGrowth::algorithmStep()
+bool PopulationGrowth::takeReplicas(const std::vector<AbstractModel*>& replicas)
 {
-    std::vector<Value> nextInfectedStates;
-    nextInfectedStates.reserve(nodes().size());
+    // one bit per replica
+    if (replicas.size() >= 64) {
+        return false;
+    }
 
-    for (Node node : nodes()) {
-        if (node.attr(m_infectedAttrId).toBool()) {
-            nextInfectedStates.emplace_back(true);
-            continue; // the node is already infected; skip
+    // a random neighbour is picked by its position in outEdges(); so, the
+    // replicas are only stepped together if they have the same positions
+    std::vector<PopulationGrowth*> models(1, this);
+    for (AbstractModel* replica : replicas) {
+        auto model = dynamic_cast<PopulationGrowth*>(replica);
+        if (!model || !hasSameTopology(model)) {
+            return false;
         }
+        models.emplace_back(model);
+    }
+    m_replicas = std::move(models);
+    return true;
+}
 
-        if (node.outDegree() < 1) {
-            nextInfectedStates.emplace_back(false);
-            continue; // the node does not have neighbours; skip
+bool PopulationGrowth::hasSameTopology(const PopulationGrowth* other) const
+{
+    if (nodes().size() != other->nodes().size()) {
+        return false;
+    }
+
+    auto otherIt = other->nodes().cbegin();
+    for (const auto& p : nodes()) {
+        const Node& node = p.second;
+        const Node& otherNode = (otherIt++)->second;
+        if (node.id() != otherNode.id() || node.outDegree() != otherNode.outDegree()) {
+            return false;
+        }
+        auto otherEdgeIt = otherNode.outEdges().cbegin();
+        for (const Node& neighbour : node.outEdges()) {
+            if (neighbour.id() != Node(*(otherEdgeIt++)).id()) {
+                return false;
+            }
         }
+    }
+    return true;
+}
+
+void PopulationGrowth::beforeLoop()
+{
+    // the nodes might have been edited while the trial was paused
+    const size_t numNodes = nodes().size();
+    m_nodes.assign(m_replicas.size(), std::vector<Node>());
+    for (size_t r = 0; r < m_replicas.size(); ++r) {
+        m_nodes[r].reserve(numNodes);
+        for (const auto& p : m_replicas[r]->nodes()) {
+            m_nodes[r].emplace_back(p.second);
+        }
+    }
+
+    std::unordered_map<int, int> idx; // node id -> position
+    idx.reserve(numNodes);
+    for (const Node& node : m_nodes.front()) {
+        idx.insert({node.id(), static_cast<int>(idx.size())});
+    }
 
-        // Select a random neighbour
-        auto neighbour = node.randNeighbour(prg());
+    m_offsets.assign(1, 0);
+    m_offsets.reserve(numNodes + 1);
+    m_neighbours.clear();
+    m_infected.assign(numNodes, 0);
+    for (size_t i = 0; i < numNodes; ++i) {
+        for (const Node& neighbour : m_nodes.front()[i].outEdges()) {
+            m_neighbours.emplace_back(idx.at(neighbour.id()));
+        }
+        m_offsets.emplace_back(static_cast<int>(m_neighbours.size()));
 
-        // and check if the neighbour is currently infected
-        if (neighbour.attr(m_infectedAttrId).toBool()) {
-            // if so, the current node will become infected with a given probability
-            nextInfectedStates.emplace_back(m_prob > prg()->uniform());
-        } else {
-            nextInfectedStates.emplace_back(false);
+        for (size_t r = 0; r < m_replicas.size(); ++r) {
+            if (m_nodes[r][i].attr(m_infectedAttrId).toBool()) {
+                m_infected[i] |= quint64(1) << r;
+            }
         }
     }
+    m_nextInfected.resize(numNodes);
+    m_synced = true;
+}
+
+bool PopulationGrowth::algorithmStep()
+{
+    const int numNodes = static_cast<int>(m_infected.size());
+    const int* offsets = m_offsets.data();
+    const int* neighbours = m_neighbours.data();
+    const quint64* infected = m_infected.data();
+    quint64* nextInfected = m_nextInfected.data();
+    const quint64 allReplicas = m_replicas.size() == 64 ? ~quint64(0)
+                              : (quint64(1) << m_replicas.size()) - 1;
 
-    // For each node, load the next state into the current state
-    size_t i = 0;
-    for (Node node : nodes()) {
-        node.setAttr(m_infectedAttrId, nextInfectedStates.at(i));
-        ++i;
+    for (int i = 0; i < numNodes; ++i) {
+        const int degree = offsets[i+1] - offsets[i];
+        quint64 state = infected[i];
+
+        // the replicas in which the node is already infected are skipped, so
+        // as all of them if the node does not have neighbours
+        quint64 healthy = degree < 1 ? 0 : ~state & allReplicas;
+        while (healthy) {
+            const int r = static_cast<int>(qCountTrailingZeroBits(healthy));
+            healthy &= healthy - 1;
+
+            // each replica draws from its own PRG, in the same order as if it
+            // was run alone; select a random neighbour
+            PRG* prg = m_replicas[static_cast<size_t>(r)]->prg();
+            const int neighbour = neighbours[offsets[i] + prg->uniform(degree - 1)];
+
+            // and check if the neighbour is currently infected; if so, the
+            // current node will become infected with a given probability
+            if (((infected[neighbour] >> r) & 1) && m_prob > prg->uniform()) {
+                state |= quint64(1) << r;
+            }
+        }
+        nextInfected[i] = state;
     }
 
+    // load the next state into the current state
+    m_infected.swap(m_nextInfected);
+    m_synced = false;
     return true;
 }
+
+void PopulationGrowth::afterLoop()
+{
+    syncNodes();
+}
+
+void PopulationGrowth::syncNodes()
+{
+    if (m_synced) {
+        return;
+    }
+    for (size_t r = 0; r < m_nodes.size(); ++r) {
+        for (size_t i = 0; i < m_infected.size(); ++i) {
+            const bool infected = (m_infected[i] >> r) & 1;
+            if (m_nodes[r][i].attr(m_infectedAttrId).toBool() != infected) {
+                m_nodes[r][i].setAttr(m_infectedAttrId, infected);
+            }
+        }
+    }
+    m_synced = true;
+}
+
 } // evoplex
 REGISTER_PLUGIN(PopulationGrowth)
 #include "plugin.moc"
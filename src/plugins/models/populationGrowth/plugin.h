@@ -9,6 +9,7 @@
 #ifndef POPULATION_GROWTH_H
 #define POPULATION_GROWTH_H
 
+#include <vector>
 #include <plugininterface.h>
 
 namespace evoplex {
@@ -16,11 +17,32 @@ class PopulationGrowth: public AbstractModel
 {
 public:
     bool init() override;
+    void beforeLoop() override;
     bool algorithmStep() override;
+    void afterLoop() override;
+    void syncNodes() override;
+    bool takeReplicas(const std::vector<AbstractModel*>& replicas) override;
 
 private:
     int m_infectedAttrId;   // the id of the 'infected' node's attribute
     double m_prob;          // probability of a node becoming infected
+
+    // The replicas stepped by this model (see takeReplicas()); this model is
+    // the 0-th one. They all have the same topology, so during the loop it is
+    // kept once, in a compressed neighbour list (in the order of nodes()); the
+    // neighbours of the i-th node are in [m_offsets[i], m_offsets[i+1]).
+    // The state of the i-th node in all replicas is packed in m_infected[i],
+    // where the bit r is set if it's infected in the r-th replica.
+    std::vector<PopulationGrowth*> m_replicas;
+    std::vector<std::vector<Node>> m_nodes; // [replica][i]
+    std::vector<int> m_offsets;
+    std::vector<int> m_neighbours;
+    std::vector<quint64> m_infected;
+    std::vector<quint64> m_nextInfected;
+    bool m_synced; // true if the nodes hold the current state
+
+    // true if 'other' has the same nodes and neighbours, in the same order
+    bool hasSameTopology(const PopulationGrowth* other) const;
 };
 } // evoplex
 #endif // POPULATION_GROWTH_H
@@ -12,69 +12,132 @@ namespace evoplex {
 bool PDGame::init()
 {
     m_temptation = attr("temptation", -1.0).toDouble();
-    return m_temptation >=1.0 && m_temptation <= 2.0;
+    m_payoffs[0] = 1.0;             // CC : Reward for mutual cooperation
+    m_payoffs[1] = 0.0;             // CD : Sucker's payoff
+    m_payoffs[2] = m_temptation;    // DC : Temptation to defect
+    m_payoffs[3] = 0.0;             // DD : Punishment for mutual defection
+    m_synced = true;
+    m_valid = false;
+    if (m_temptation < 1.0 || m_temptation > 2.0) {
+        return false;
+    }
+
+    m_valid = validStrategies();
+    return m_valid;
+}
+
+bool PDGame::validStrategies() const
+{
+    // the payoffs are looked up by strategy; make sure they're all valid
+    for (const auto& p : nodes()) {
+        const int s = p.second.attr(STRATEGY).toInt();
+        if (s < 0 || s > 3) {
+            qWarning() << "the strategy of the node" << p.first << "should be 0, 1, 2 or 3";
+            return false;
+        }
+    }
+    return true;
+}
+
+void PDGame::beforeLoop()
+{
+    // the nodes might have been edited while the trial was paused
+    m_synced = true;
+    m_valid = validStrategies();
+    if (!m_valid) {
+        return; // algorithmStep() stops straight away
+    }
+
+    const size_t numNodes = nodes().size();
+    m_nodes.clear();
+    m_nodes.reserve(numNodes);
+    m_strategies.clear();
+    m_strategies.reserve(numNodes);
+    m_scores.clear();
+    m_scores.reserve(numNodes);
+    std::unordered_map<int, int> idx; // node id -> position
+    idx.reserve(numNodes);
+    for (const auto& p : nodes()) {
+        idx.insert({p.first, static_cast<int>(m_nodes.size())});
+        m_nodes.emplace_back(p.second);
+        m_strategies.emplace_back(p.second.attr(STRATEGY).toInt());
+        m_scores.emplace_back(p.second.attr(SCORE).toDouble());
+    }
+
+    m_offsets.assign(1, 0);
+    m_offsets.reserve(numNodes + 1);
+    m_neighbours.clear();
+    for (const Node& node : m_nodes) {
+        for (const Node& neighbour : node.outEdges()) {
+            m_neighbours.emplace_back(idx.at(neighbour.id()));
+        }
+        m_offsets.emplace_back(static_cast<int>(m_neighbours.size()));
+    }
+    m_bestStrategies.resize(numNodes);
 }
 
 bool PDGame::algorithmStep()
 {
+    if (!m_valid) {
+        return false;
+    }
+
+    const int numNodes = static_cast<int>(m_nodes.size());
+    const int* offsets = m_offsets.data();
+    const int* neighbours = m_neighbours.data();
+    int* strategies = m_strategies.data();
+    double* scores = m_scores.data();
+    char* bestStrategies = m_bestStrategies.data();
+
     // 1. each agent accumulates the payoff obtained by playing
     //    the game with all its neighbours and itself
-    for (Node node : nodes()) {
-        const int sX = node.attr(STRATEGY).toInt();
-        double score = playGame(sX, sX);
-        for (const Node& neighbour : node.outEdges()) {
-            score += playGame(sX, neighbour.attr(STRATEGY).toInt());
+    for (int i = 0; i < numNodes; ++i) {
+        const int row = binarize(strategies[i]) * 2;
+        double score = m_payoffs[row + binarize(strategies[i])];
+        for (int j = offsets[i]; j < offsets[i+1]; ++j) {
+            score += m_payoffs[row + binarize(strategies[neighbours[j]])];
         }
-        node.setAttr(SCORE, score);
+        scores[i] = score;
     }
 
-    std::vector<char> bestStrategies;
-    bestStrategies.reserve(nodes().size());
-
     // 2. the best agent in the neighbourhood is selected to reproduce
-    for (const Node& node : nodes()) {
-        int bestStrategy = node.attr(STRATEGY).toInt();
-        double highestScore = node.attr(SCORE).toDouble();
-        for (const Node& neighbour : node.outEdges()) {
-            const double neighbourScore = neighbour.attr(SCORE).toDouble();
-            if (neighbourScore > highestScore) {
-                highestScore = neighbourScore;
-                bestStrategy = neighbour.attr(STRATEGY).toInt();
+    for (int i = 0; i < numNodes; ++i) {
+        int bestStrategy = strategies[i];
+        double highestScore = scores[i];
+        for (int j = offsets[i]; j < offsets[i+1]; ++j) {
+            if (scores[neighbours[j]] > highestScore) {
+                highestScore = scores[neighbours[j]];
+                bestStrategy = strategies[neighbours[j]];
             }
         }
-        bestStrategies.emplace_back(binarize(bestStrategy));
+        bestStrategies[i] = static_cast<char>(binarize(bestStrategy));
     }
 
     // 3. prepare the next generation
-    size_t i = 0;
-    for (Node node : nodes()) {
-        int s = binarize(node.attr(STRATEGY).toInt());
-        s = (s == bestStrategies.at(i)) ? s : bestStrategies.at(i) + 2;
-        node.setAttr(STRATEGY, s);
-        ++i;
+    for (int i = 0; i < numNodes; ++i) {
+        const int s = binarize(strategies[i]);
+        strategies[i] = (s == bestStrategies[i]) ? s : bestStrategies[i] + 2;
     }
 
+    m_synced = false;
     return true;
 }
 
-// 0) cooperator; 1) new cooperator
-// 2) defector;   3) new defector
-double PDGame::playGame(const int sX, const int sY) const
+void PDGame::afterLoop()
 {
-    switch (binarize(sX) * 2 + binarize(sY)) {
-    case 0: return 1.0;             // CC : Reward for mutual cooperation
-    case 1: return 0.0;             // CD : Sucker's payoff
-    case 2: return m_temptation;    // DC : Temptation to defect
-    case 3: return 0.0;             // DD : Punishment for mutual defection
-    default: qFatal("Error! strategy should be 0 or 1!");
-    }
+    syncNodes();
 }
 
-// transform from 0|2 -> 0 (cooperator)
-//                1|3 -> 1 (defector)
-int PDGame::binarize(const int strategy) const
+void PDGame::syncNodes()
 {
-    return (strategy < 2) ? strategy : strategy - 2;
+    if (m_synced) {
+        return;
+    }
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        m_nodes[i].setAttr(STRATEGY, m_strategies[i]);
+        m_nodes[i].setAttr(SCORE, m_scores[i]);
+    }
+    m_synced = true;
 }
 
 } // evoplex
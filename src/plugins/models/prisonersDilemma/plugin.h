@@ -8,6 +8,8 @@
 #ifndef PDGAME_H
 #define PDGAME_H
 
+#include <unordered_map>
+#include <vector>
 #include <plugininterface.h>
 
 namespace evoplex {
@@ -15,15 +17,45 @@ class PDGame: public AbstractModel
 {
 public:
     bool init() override;
+    void beforeLoop() override;
     bool algorithmStep() override;
+    void afterLoop() override;
+    void syncNodes() override;
 
 private:
     enum NodeAttr { STRATEGY, SCORE };
 
     double m_temptation;
+    double m_payoffs[4]; // indexed by binarize(sX)*2 + binarize(sY)
 
-    double playGame(const int sX, const int sY) const;
-    int binarize(const int strategy) const;
+    // During the loop, the nodes' state is kept in contiguous arrays (in
+    // the order of nodes()), and the graph in a compressed neighbour list;
+    // the neighbours of the i-th node are in [m_offsets[i], m_offsets[i+1]).
+    // The neighbours keep the order of outEdges(), so the sums and ties are
+    // resolved exactly as before.
+    std::vector<Node> m_nodes;
+    std::vector<int> m_offsets;
+    std::vector<int> m_neighbours;
+    std::vector<int> m_strategies;
+    std::vector<double> m_scores;
+    std::vector<char> m_bestStrategies;
+    bool m_synced; // true if the nodes hold the current state
+    bool m_valid;  // false if any strategy is not 0, 1, 2 or 3
+
+    // warns about the first node with an invalid strategy
+    bool validStrategies() const;
+
+    inline int binarize(const int strategy) const;
 };
+
+// 0) cooperator; 1) new cooperator
+// 2) defector;   3) new defector
+// transform from 0|2 -> 0 (cooperator)
+//                1|3 -> 1 (defector)
+inline int PDGame::binarize(const int strategy) const
+{
+    return (strategy < 2) ? strategy : strategy - 2;
+}
+
 } // evoplex
 #endif
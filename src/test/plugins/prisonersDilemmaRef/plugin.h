@@ -0,0 +1,33 @@
+/**
+ * Copyright (c) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * This source code is licensed under the MIT license found in
+ * the LICENSE file in the root directory of this source tree.
+ */
+
+// The original implementation of the prisonersDilemma model plugin,
+// which reads and writes the nodes' attributes directly. It's kept as
+// a reference for the optimized one (see tst_experiment).
+
+#ifndef PDGAME_REF_H
+#define PDGAME_REF_H
+
+#include <plugininterface.h>
+
+namespace evoplex {
+class PDGameRef: public AbstractModel
+{
+public:
+    bool init() override;
+    bool algorithmStep() override;
+
+private:
+    enum NodeAttr { STRATEGY, SCORE };
+
+    double m_temptation;
+
+    double playGame(const int sX, const int sY) const;
+    int binarize(const int strategy) const;
+};
+} // evoplex
+#endif
@@ -0,0 +1,31 @@
+/**
+ * Copyright (c) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * This source code is licensed under the MIT license found in
+ * the LICENSE file in the root directory of this source tree.
+ */
+
+#include "plugin.h"
+
+namespace evoplex {
+
+bool TestAsync::init()
+{
+    m_visitsAttrId = node(0).attrs().indexOf("visits");
+    m_lastAttrId = node(0).attrs().indexOf("last");
+    m_updates = 0;
+    if (attr("random").toBool()) {
+        setUpdateOrder(UpdateOrder::Random);
+    }
+    return m_visitsAttrId >= 0 && m_lastAttrId >= 0;
+}
+
+void TestAsync::updateNode(Node node)
+{
+    node.setAttr(m_visitsAttrId, Value(node.attr(m_visitsAttrId).toInt() + 1));
+    node.setAttr(m_lastAttrId, Value(m_updates++));
+}
+
+} // evoplex
+REGISTER_PLUGIN(TestAsync)
+#include "plugin.moc"
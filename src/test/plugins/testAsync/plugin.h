@@ -0,0 +1,29 @@
+/**
+ * Copyright (c) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * This source code is licensed under the MIT license found in
+ * the LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef TEST_ASYNC_H
+#define TEST_ASYNC_H
+
+#include <plugininterface.h>
+
+namespace evoplex {
+// Each update increments the node's 'visits' and stores in 'last' the
+// number of updates performed before it in the trial, ie, its position
+// in the sequence of updates.
+class TestAsync: public AbstractAsyncModel
+{
+public:
+    bool init() override;
+    void updateNode(Node node) override;
+
+private:
+    int m_visitsAttrId;
+    int m_lastAttrId;
+    int m_updates; // updates performed so far
+};
+} // evoplex
+#endif // TEST_ASYNC_H
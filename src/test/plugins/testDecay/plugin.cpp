@@ -0,0 +1,31 @@
+/**
+ * Copyright (c) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * This source code is licensed under the MIT license found in
+ * the LICENSE file in the root directory of this source tree.
+ */
+
+#include "plugin.h"
+
+namespace evoplex {
+
+bool TestDecay::init()
+{
+    m_aliveAttrId = node(0).attrs().indexOf("alive");
+    m_rate = attr("rate").toDouble();
+    return m_aliveAttrId >= 0;
+}
+
+double TestDecay::rate(const Node& node) const
+{
+    return node.attr(m_aliveAttrId).toBool() ? m_rate : 0.0;
+}
+
+void TestDecay::fire(Node node)
+{
+    node.setAttr(m_aliveAttrId, Value(false));
+}
+
+} // evoplex
+REGISTER_PLUGIN(TestDecay)
+#include "plugin.moc"
@@ -0,0 +1,28 @@
+/**
+ * Copyright (c) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ * This source code is licensed under the MIT license found in
+ * the LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef TEST_DECAY_H
+#define TEST_DECAY_H
+
+#include <plugininterface.h>
+
+namespace evoplex {
+// Each alive node dies at a constant rate, independently of the others;
+// so, the fraction of alive nodes at the time t is about exp(-rate*t).
+class TestDecay: public AbstractEventModel
+{
+public:
+    bool init() override;
+    double rate(const Node& node) const override;
+    void fire(Node node) override;
+
+private:
+    int m_aliveAttrId;
+    double m_rate;
+};
+} // evoplex
+#endif // TEST_DECAY_H
@@ -0,0 +1,257 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a multi-agent system for networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <vector>
+#include <QtTest>
+
+#include <core/include/abstractgraph.h>
+#include <core/node_p.h>
+
+namespace evoplex {
+
+// a toroidal lattice with Moore neighbourhood, built without a graph plugin
+class Lattice : public AbstractGraph
+{
+public:
+    Lattice() : AbstractGraph(GraphType::Undirected) {}
+    bool reset() override { return true; }
+};
+
+class TestActiveNodes: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {}
+    void cleanupTestCase() {}
+    void tst_activeNodes();
+    void tst_topology();
+    void tst_gameOfLife();
+    void bench_gameOfLife_data();
+    void bench_gameOfLife();
+
+private:
+    void buildLattice(Lattice& graph, int width, int height);
+    void addGlider(Lattice& graph, int width, int x, int y);
+    // one step of the Game of Life over 'nodes'
+    void stepGameOfLife(const std::vector<Node>& nodes);
+    std::vector<Node> allNodes(const Lattice& graph) const;
+};
+
+void TestActiveNodes::buildLattice(Lattice& graph, int width, int height)
+{
+    Attributes attrs(1);
+    attrs.replace(0, "live", Value(false));
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            graph.addNode(attrs, x, y);
+        }
+    }
+
+    // each pair of neighbours is linked once
+    auto id = [width, height](int x, int y) {
+        return ((y + height) % height) * width + (x + width) % width;
+    };
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            graph.addEdge(id(x, y), id(x+1, y));
+            graph.addEdge(id(x, y), id(x-1, y+1));
+            graph.addEdge(id(x, y), id(x, y+1));
+            graph.addEdge(id(x, y), id(x+1, y+1));
+        }
+    }
+}
+
+void TestActiveNodes::addGlider(Lattice& graph, int width, int x, int y)
+{
+    const int cells[5][2] = {{1,0}, {2,1}, {0,2}, {1,2}, {2,2}};
+    for (auto const& c : cells) {
+        graph.node((y + c[1]) * width + x + c[0]).setAttr(0, Value(true));
+    }
+}
+
+void TestActiveNodes::stepGameOfLife(const std::vector<Node>& nodes)
+{
+    std::vector<bool> next;
+    next.reserve(nodes.size());
+    for (const Node& node : nodes) {
+        int live = 0;
+        for (auto const& e : node.outEdges()) {
+            live += e.second.neighbour().attr(0).toBool() ? 1 : 0;
+        }
+        next.emplace_back(live == 3 || (live == 2 && node.attr(0).toBool()));
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const bool live = next[i];
+        if (nodes[i].attr(0).toBool() != live) {
+            Node node = nodes[i];
+            node.setAttr(0, Value(live));
+        }
+    }
+}
+
+std::vector<Node> TestActiveNodes::allNodes(const Lattice& graph) const
+{
+    std::vector<Node> nodes;
+    for (auto const& p : graph.nodes()) {
+        nodes.emplace_back(p.second);
+    }
+    return nodes;
+}
+
+void TestActiveNodes::tst_activeNodes()
+{
+    Lattice graph;
+    buildLattice(graph, 8, 8);
+
+    // the first call takes all nodes
+    QCOMPARE(static_cast<int>(graph.activeNodes().size()), 64);
+    // nothing has changed since then
+    QVERIFY(graph.activeNodes().empty());
+
+    // setting the same value is not a change
+    graph.node(9).setAttr(0, Value(false));
+    QVERIFY(graph.activeNodes().empty());
+
+    // a node and its 8 neighbours
+    graph.node(9).setAttr(0, Value(true));
+    graph.node(9).setAttr(0, Value(false));
+    std::vector<int> ids;
+    for (const Node& node : graph.activeNodes()) {
+        ids.emplace_back(node.id());
+    }
+    std::sort(ids.begin(), ids.end());
+    QCOMPARE(ids, std::vector<int>({0, 1, 2, 8, 9, 10, 16, 17, 18}));
+
+    // the neighbourhoods overlap; each node is taken only once
+    graph.node(9).setAttr(0, Value(true));
+    graph.node(10).setAttr(0, Value(true));
+    QCOMPARE(static_cast<int>(graph.activeNodes().size()), 12);
+    QVERIFY(graph.activeNodes().empty());
+}
+
+void TestActiveNodes::tst_topology()
+{
+    Lattice graph;
+    buildLattice(graph, 8, 8);
+    graph.activeNodes();
+
+    auto ids = [&graph]() {
+        std::vector<int> ids;
+        for (const Node& node : graph.activeNodes()) {
+            ids.emplace_back(node.id());
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    auto contains = [](const std::vector<int>& ids, int id) {
+        return std::binary_search(ids.cbegin(), ids.cend(), id);
+    };
+
+    // the ends of an edge are active
+    graph.removeEdge(graph.edge(0)); // 0 -> 1
+    std::vector<int> active = ids();
+    QVERIFY(contains(active, 0));
+    QVERIFY(contains(active, 1));
+
+    // a removed node is not taken, but its neighbours are
+    Node node = graph.node(27);
+    std::vector<int> neighbours;
+    for (auto const& e : node.outEdges()) {
+        neighbours.emplace_back(e.second.neighbour().id());
+    }
+    node.setAttr(0, Value(true));
+    graph.removeNode(node);
+    active = ids();
+    QVERIFY(!contains(active, 27));
+    for (int id : neighbours) {
+        QVERIFY(contains(active, id));
+    }
+
+    // a new node is active
+    Node added = graph.addNode(Attributes(1));
+    QCOMPARE(ids(), std::vector<int>({added.id()}));
+
+    // all nodes are active after removing all edges
+    graph.removeAllEdges();
+    QCOMPARE(graph.activeNodes().size(), graph.nodes().size());
+}
+
+void TestActiveNodes::tst_gameOfLife()
+{
+    // sweeping all nodes and only the active ones must give the same states
+    const int width = 16;
+    Lattice full, active;
+    buildLattice(full, width, width);
+    buildLattice(active, width, width);
+    addGlider(full, width, 1, 1);
+    addGlider(full, width, 8, 3);
+    addGlider(active, width, 1, 1);
+    addGlider(active, width, 8, 3);
+
+    const std::vector<Node> fullNodes = allNodes(full);
+    for (int step = 0; step < 4 * width; ++step) {
+        stepGameOfLife(fullNodes);
+        stepGameOfLife(active.activeNodes());
+        for (auto const& p : full.nodes()) {
+            QCOMPARE(active.node(p.first).attr(0), p.second.attr(0));
+        }
+    }
+}
+
+void TestActiveNodes::bench_gameOfLife_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<bool>("activeOnly");
+
+    // a single glider; the active set has the same size in all grids
+    for (int width : {32, 64, 128}) {
+        QTest::newRow(qPrintable(QString("full %1x%1").arg(width))) << width << false;
+        QTest::newRow(qPrintable(QString("active %1x%1").arg(width))) << width << true;
+    }
+}
+
+void TestActiveNodes::bench_gameOfLife()
+{
+    QFETCH(int, width);
+    QFETCH(bool, activeOnly);
+
+    Lattice graph;
+    buildLattice(graph, width, width);
+    addGlider(graph, width, 1, 1);
+    const std::vector<Node> nodes = allNodes(graph);
+    stepGameOfLife(graph.activeNodes()); // the first call takes all nodes
+
+    if (activeOnly) {
+        QBENCHMARK {
+            stepGameOfLife(graph.activeNodes());
+        }
+    } else {
+        QBENCHMARK {
+            stepGameOfLife(nodes);
+        }
+    }
+}
+
+} // evoplex
+QTEST_MAIN(evoplex::TestActiveNodes)
+#include "tst_activenodes.moc"
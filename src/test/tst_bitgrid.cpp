@@ -0,0 +1,221 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a multi-agent system for networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <random>
+#include <vector>
+#include <QtTest>
+
+#include <bitgrid.h>
+
+namespace evoplex {
+class TestBitGrid: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {}
+    void cleanupTestCase() {}
+    void tst_cells();
+    void tst_lifeStep_data();
+    void tst_lifeStep();
+    void tst_takeChanges();
+    void tst_applyRule_data();
+    void tst_applyRule();
+
+private:
+    // the Game of Life as in the gameOfLife plugin running on a squareGrid
+    std::vector<bool> lifeStep(const std::vector<bool>& cells, int width, int height,
+                               int neighbours, bool periodic) const;
+};
+
+std::vector<bool> TestBitGrid::lifeStep(const std::vector<bool>& cells, int width,
+        int height, int neighbours, bool periodic) const
+{
+    const std::vector<std::pair<int,int>> moore {
+        {-1,-1}, {-1,0}, {-1,1}, {0,-1}, {0,1}, {1,-1}, {1,0}, {1,1} };
+    const std::vector<std::pair<int,int>> vonNeumann { {-1,0}, {0,-1}, {0,1}, {1,0} };
+    const auto& offsets = neighbours == 8 ? moore : vonNeumann;
+
+    std::vector<bool> next(cells.size());
+    for (int row = 0; row < height; ++row) {
+        for (int col = 0; col < width; ++col) {
+            int live = 0;
+            for (auto const& o : offsets) {
+                int r = row + o.first;
+                int c = col + o.second;
+                if (periodic) {
+                    r = (r + height) % height;
+                    c = (c + width) % width;
+                } else if (r < 0 || r >= height || c < 0 || c >= width) {
+                    continue;
+                }
+                live += cells[static_cast<size_t>(r * width + c)] ? 1 : 0;
+            }
+            const size_t id = static_cast<size_t>(row * width + col);
+            next[id] = live == 3 || (live == 2 && cells[id]);
+        }
+    }
+    return next;
+}
+
+void TestBitGrid::tst_cells()
+{
+    BitGrid grid(70, 3, 8, false);
+    QCOMPARE(grid.width(), 70);
+    QCOMPARE(grid.height(), 3);
+    for (int id : {0, 63, 64, 69, 70, 139, 209}) {
+        QVERIFY(!grid.cell(id));
+        grid.setCell(id, true);
+        QVERIFY(grid.cell(id));
+    }
+    grid.setCell(64, false);
+    QVERIFY(!grid.cell(64));
+    QVERIFY(grid.cell(63));
+    QVERIFY(!grid.cell(65));
+}
+
+void TestBitGrid::tst_lifeStep_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+    QTest::addColumn<int>("neighbours");
+    QTest::addColumn<bool>("periodic");
+
+    // the widths around the word boundaries are the interesting ones
+    const std::vector<std::pair<int,int>> shapes {
+        {1,1}, {1,5}, {2,2}, {3,3}, {5,7}, {62,4}, {63,5}, {64,6}, {65,3}, {130,9} };
+    for (auto const& s : shapes) {
+        for (int neighbours : {4, 8}) {
+            for (bool periodic : {false, true}) {
+                if (periodic && (s.first < 3 || s.second < 3)) {
+                    continue;
+                }
+                QTest::newRow(qPrintable(QString("%1x%2 n%3 %4").arg(s.first).arg(s.second)
+                        .arg(neighbours).arg(periodic ? "periodic" : "fixed")))
+                        << s.first << s.second << neighbours << periodic;
+            }
+        }
+    }
+}
+
+void TestBitGrid::tst_lifeStep()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(int, neighbours);
+    QFETCH(bool, periodic);
+
+    std::mt19937 prg(static_cast<unsigned>(width * 1000 + height));
+    std::bernoulli_distribution alive(0.4);
+
+    BitGrid grid(width, height, neighbours, periodic);
+    std::vector<bool> cells(static_cast<size_t>(width * height));
+    for (size_t id = 0; id < cells.size(); ++id) {
+        cells[id] = alive(prg);
+        grid.setCell(static_cast<int>(id), cells[id]);
+    }
+
+    for (int step = 0; step < 50; ++step) {
+        cells = lifeStep(cells, width, height, neighbours, periodic);
+        grid.lifeStep();
+        for (size_t id = 0; id < cells.size(); ++id) {
+            QCOMPARE(grid.cell(static_cast<int>(id)), static_cast<bool>(cells[id]));
+        }
+    }
+}
+
+void TestBitGrid::tst_takeChanges()
+{
+    const int width = 66;
+    BitGrid grid(width, 4, 8, true);
+    // a blinker crossing the word boundary
+    for (int col = 63; col <= 65; ++col) {
+        grid.setCell(width + col, true);
+    }
+    grid.resetChanges();
+
+    std::vector<std::pair<int,bool>> changes;
+    auto take = [&changes](int id, bool live) { changes.emplace_back(id, live); };
+
+    grid.takeChanges(take);
+    QVERIFY(changes.empty());
+
+    grid.lifeStep();
+    grid.takeChanges(take);
+    const std::vector<std::pair<int,bool>> expected {
+        {64, true}, {width + 63, false}, {width + 65, false}, {2*width + 64, true} };
+    QCOMPARE(changes, expected);
+
+    changes.clear();
+    grid.takeChanges(take);
+    QVERIFY(changes.empty());
+}
+
+void TestBitGrid::tst_applyRule_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<bool>("periodic");
+
+    for (int width : {1, 2, 3, 63, 64, 65, 66, 129}) {
+        QTest::newRow(qPrintable(QString("%1 fixed").arg(width))) << width << false;
+        QTest::newRow(qPrintable(QString("%1 periodic").arg(width))) << width << true;
+    }
+}
+
+void TestBitGrid::tst_applyRule()
+{
+    QFETCH(int, width);
+    QFETCH(bool, periodic);
+
+    std::mt19937 prg(static_cast<unsigned>(width));
+    std::bernoulli_distribution alive(0.5);
+
+    for (int rule = 0; rule < 256; ++rule) {
+        BitRow src(width), dst(width);
+        std::vector<bool> srcCells, expected;
+        for (int col = 0; col < width; ++col) {
+            srcCells.emplace_back(alive(prg));
+            expected.emplace_back(alive(prg));
+            src.setCell(col, srcCells.back());
+            dst.setCell(col, expected.back());
+        }
+
+        // the first and last cells are untouched with fixed boundaries
+        for (int col = 0; col < width; ++col) {
+            if (!periodic && (col == 0 || col == width - 1)) {
+                continue;
+            }
+            const bool l = srcCells[static_cast<size_t>((col - 1 + width) % width)];
+            const bool c = srcCells[static_cast<size_t>(col)];
+            const bool r = srcCells[static_cast<size_t>((col + 1) % width)];
+            expected[static_cast<size_t>(col)] = (rule >> (l*4 + c*2 + r)) & 1;
+        }
+
+        dst.applyRule(src, static_cast<quint8>(rule), periodic);
+        for (int col = 0; col < width; ++col) {
+            QCOMPARE(dst.cell(col), static_cast<bool>(expected[static_cast<size_t>(col)]));
+        }
+    }
+}
+
+} // evoplex
+QTEST_MAIN(evoplex::TestBitGrid)
+#include "tst_bitgrid.moc"
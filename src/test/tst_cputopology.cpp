@@ -0,0 +1,72 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a multi-agent system for networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+
+#include <core/cputopology.h>
+
+using namespace evoplex;
+
+class TestCpuTopology: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {}
+    void cleanupTestCase() {}
+    void tst_parseCpuList();
+    void tst_instance();
+};
+
+void TestCpuTopology::tst_parseCpuList()
+{
+    QCOMPARE(CpuTopology::parseCpuList("0"), std::vector<int>({0}));
+    QCOMPARE(CpuTopology::parseCpuList("0-3"), std::vector<int>({0, 1, 2, 3}));
+    QCOMPARE(CpuTopology::parseCpuList("8-9,0,2-3"), std::vector<int>({0, 2, 3, 8, 9}));
+    QCOMPARE(CpuTopology::parseCpuList("1,1-2"), std::vector<int>({1, 2}));
+    QVERIFY(CpuTopology::parseCpuList("").empty());
+    QVERIFY(CpuTopology::parseCpuList("3-1").empty());
+    QVERIFY(CpuTopology::parseCpuList("1-2-3").empty());
+    QVERIFY(CpuTopology::parseCpuList("a").empty());
+}
+
+void TestCpuTopology::tst_instance()
+{
+    const CpuTopology& topology = CpuTopology::instance();
+    QVERIFY(topology.numNodes() >= 1);
+    QVERIFY(topology.numCpus() >= 1);
+
+    int numCpus = 0;
+    for (int node = 0; node < topology.numNodes(); ++node) {
+        QVERIFY(!topology.cpus(node).empty());
+        for (int cpu : topology.cpus(node)) {
+            QCOMPARE(topology.nodeOf(cpu), node);
+        }
+        numCpus += static_cast<int>(topology.cpus(node).size());
+    }
+    QCOMPARE(numCpus, topology.numCpus());
+    QCOMPARE(topology.nodeOf(-1), -1);
+
+    // this thread has not been pinned
+    QCOMPARE(CpuTopology::currentNode(), -1);
+}
+
+QTEST_MAIN(TestCpuTopology)
+#include "tst_cputopology.moc"
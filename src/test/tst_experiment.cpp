@@ -0,0 +1,576 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a multi-agent system for networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtTest>
+
+#include <abstracteventmodel.h>
+#include <core/experiment.h>
+#include <core/experimentsmgr.h>
+#include <core/expinputs.h>
+#include <core/mainapp.h>
+#include <core/project.h>
+#include <core/trial.h>
+
+using namespace evoplex;
+
+// Runs whole experiments of the plugins built along with the tests.
+class TestExperiment: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void tst_cyclePeriod();
+    void tst_prisonersDilemma();
+    void tst_asyncModel();
+    void tst_eventModel();
+    void tst_eventModelBatches();
+    void tst_replicates();
+    void tst_checkpointResume();
+    void tst_timeSlices();
+
+private:
+    MainApp* m_mainApp;
+    ProjectPtr m_project;
+    QTemporaryDir m_dir;
+
+    // creates an experiment with the given attributes; the missing
+    // general and squareGrid attributes take the values below
+    ExperimentPtr newExperiment(const std::map<QString, QString>& attrs, QString& error);
+
+    // runs the experiment until it finishes (or fails)
+    bool run(const ExperimentPtr& exp);
+
+    // the state of all nodes of the trial, in the order of their ids;
+    // the doubles are printed with all their digits
+    static QStringList nodesState(const Trial* trial);
+
+    // writes a nodes file with the given header and rows
+    QString writeNodes(const QString& name, const QString& header, const QStringList& rows);
+};
+
+void TestExperiment::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_mainApp = new MainApp();
+
+    const QStringList ext = { QString("*%1").arg(MainApp::kPluginExtension) };
+    for (const QString& dir : { EVOPLEX_PLUGINS_DIR, TEST_PLUGINS_DIR }) {
+        QDir pluginsDir(dir);
+        for (const QString& fileName : pluginsDir.entryList(ext, QDir::Files)) {
+            QString error;
+            m_mainApp->loadPlugin(pluginsDir.absoluteFilePath(fileName), error, false);
+        }
+    }
+
+    QString error;
+    m_project = m_mainApp->newProject(error);
+    QVERIFY2(m_project, qPrintable(error));
+}
+
+void TestExperiment::cleanupTestCase()
+{
+    m_project.reset();
+    delete m_mainApp;
+}
+
+ExperimentPtr TestExperiment::newExperiment(const std::map<QString, QString>& attrs, QString& error)
+{
+    std::map<QString, QString> all = {
+        { GENERAL_ATTR_EXPID, QString::number(m_project->generateExpId()) },
+        { GENERAL_ATTR_SEED, "0" },
+        { GENERAL_ATTR_STOPAT, "10" },
+        { GENERAL_ATTR_TRIALS, "1" },
+        { GENERAL_ATTR_AUTODELETE, "false" },
+        { GENERAL_ATTR_GRAPHID, "squareGrid" },
+        { GENERAL_ATTR_GRAPHTYPE, "undirected" },
+        { GENERAL_ATTR_EDGEATTRS, "" },
+        { OUTPUT_DIR, m_dir.path() },
+        { OUTPUT_HEADER, "" },
+        { "squareGrid_neighbours", "4" },
+        { "squareGrid_boundary", "periodic" }
+    };
+    for (auto const& it : attrs) {
+        all[it.first] = it.second;
+    }
+
+    QStringList header, values;
+    for (auto const& it : all) {
+        header << it.first;
+        values << it.second;
+    }
+
+    auto inputs = ExpInputs::parse(m_mainApp, header, values, error);
+    if (!inputs || !error.isEmpty()) {
+        return nullptr;
+    }
+    ExperimentPtr exp = m_project->newExperiment(std::move(inputs), error);
+    if (!exp || !error.isEmpty() || !exp->reset(&error)) {
+        return nullptr;
+    }
+    return exp;
+}
+
+bool TestExperiment::run(const ExperimentPtr& exp)
+{
+    exp->play();
+    // the status changes in the work threads
+    QElapsedTimer timer;
+    timer.start();
+    while (exp->expStatus() != Status::Finished && exp->expStatus() != Status::Invalid
+           && timer.elapsed() < 60000) {
+        QTest::qWait(10);
+    }
+    return exp->expStatus() == Status::Finished;
+}
+
+QStringList TestExperiment::nodesState(const Trial* trial)
+{
+    std::vector<Node> nodes;
+    for (auto const& p : trial->graph()->nodes()) {
+        nodes.emplace_back(p.second);
+    }
+    std::sort(nodes.begin(), nodes.end(),
+              [](const Node& a, const Node& b) { return a.id() < b.id(); });
+
+    QStringList state;
+    for (const Node& node : nodes) {
+        QString row = QString::number(node.id());
+        for (const Value& v : node.attrs().values()) {
+            row += "," + (v.isDouble() ? QString::number(v.toDouble(), 'g', 17) : v.toQString());
+        }
+        state << row;
+    }
+    return state;
+}
+
+QString TestExperiment::writeNodes(const QString& name, const QString& header, const QStringList& rows)
+{
+    const QString path = m_dir.filePath(name);
+    QFile file(path);
+    if (file.open(QFile::WriteOnly | QFile::Truncate)) {
+        QTextStream out(&file);
+        out << header << "\n" << rows.join("\n") << "\n";
+    }
+    return path;
+}
+
+void TestExperiment::tst_cyclePeriod()
+{
+    // a blinker in the middle of a 5x5 grid; it repeats every 2 steps
+    QStringList live;
+    for (int id = 0; id < 25; ++id) {
+        live << ((id == 11 || id == 12 || id == 13) ? "true" : "false");
+    }
+    const QString nodesFile = writeNodes("blinker.csv", "live", live);
+
+    QString error;
+    ExperimentPtr exp = newExperiment({
+        { GENERAL_ATTR_MODELID, "gameOfLife" },
+        { GENERAL_ATTR_NODES, nodesFile },
+        { GENERAL_ATTR_STOPAT, "100" },
+        { GENERAL_ATTR_TRIALS, "3" },
+        { GENERAL_ATTR_CYCLEWINDOW, "10" },
+        { "squareGrid_height", "5" },
+        { "squareGrid_width", "5" },
+        { "squareGrid_boundary", "fixed" }
+    }, error);
+    QVERIFY2(exp, qPrintable(error));
+    QVERIFY(run(exp));
+
+    // all trials have stopped as soon as the cycle was found
+    for (auto const& t : exp->trials()) {
+        QCOMPARE(t.second->cyclePeriod(), 2);
+        QCOMPARE(t.second->step(), 2);
+    }
+    const std::map<int, int> expected = { { 2, 3 } };
+    QVERIFY(exp->cyclePeriods() == expected);
+    QCOMPARE(exp->progress(), static_cast<quint16>(360));
+
+    // it's cleared when the trials start over
+    QVERIFY(exp->reset(&error));
+    QVERIFY(exp->cyclePeriods().empty());
+}
+
+void TestExperiment::tst_prisonersDilemma()
+{
+    // the optimized plugin must give exactly the same results as the
+    // original implementation (ie, prisonersDilemmaRef)
+    for (const QString& stopAt : { "1", "7", "50" }) {
+        std::map<QString, QStringList> states;
+        for (const QString& modelId : { "prisonersDilemma", "prisonersDilemmaRef" }) {
+            QString error;
+            ExperimentPtr exp = newExperiment({
+                { GENERAL_ATTR_MODELID, modelId },
+                { GENERAL_ATTR_NODES, "*400;rand_7" },
+                { GENERAL_ATTR_SEED, "3" },
+                { GENERAL_ATTR_STOPAT, stopAt },
+                { modelId + "_temptation", "1.9" },
+                { "squareGrid_height", "20" },
+                { "squareGrid_width", "20" },
+                { "squareGrid_neighbours", "8" }
+            }, error);
+            QVERIFY2(exp, qPrintable(error));
+            QVERIFY(run(exp));
+            states[modelId] = nodesState(exp->trials().at(0));
+        }
+        QCOMPARE(states.at("prisonersDilemma"), states.at("prisonersDilemmaRef"));
+    }
+}
+
+void TestExperiment::tst_asyncModel()
+{
+    const int numNodes = 100;
+    const int stopAt = 20;
+    auto newAsync = [this](const QString& seed, const QString& random, QString& error) {
+        return newExperiment({
+            { GENERAL_ATTR_MODELID, "testAsync" },
+            { GENERAL_ATTR_NODES, "*100;min" },
+            { GENERAL_ATTR_SEED, seed },
+            { GENERAL_ATTR_STOPAT, "20" },
+            { "testAsync_random", random },
+            { "squareGrid_height", "10" },
+            { "squareGrid_width", "10" }
+        }, error);
+    };
+
+    // a shuffled sweep updates each node exactly once per step,
+    // so the updates of the last step are a permutation of the nodes
+    QString error;
+    ExperimentPtr exp = newAsync("1", "false", error);
+    QVERIFY2(exp, qPrintable(error));
+    QVERIFY(run(exp));
+    const QStringList state = nodesState(exp->trials().at(0));
+    std::set<int> positions;
+    bool inOrder = true;
+    for (auto const& p : exp->trials().at(0)->graph()->nodes()) {
+        QCOMPARE(p.second.attr("visits").toInt(), stopAt);
+        const int pos = p.second.attr("last").toInt() - (stopAt - 1) * numNodes;
+        QVERIFY(pos >= 0 && pos < numNodes);
+        positions.insert(pos);
+        inOrder = inOrder && pos == p.first;
+    }
+    QCOMPARE(static_cast<int>(positions.size()), numNodes);
+    QVERIFY(!inOrder);
+
+    // the sequence only depends on the seed
+    exp = newAsync("1", "false", error);
+    QVERIFY2(exp, qPrintable(error));
+    QVERIFY(run(exp));
+    QCOMPARE(nodesState(exp->trials().at(0)), state);
+
+    exp = newAsync("2", "false", error);
+    QVERIFY2(exp, qPrintable(error));
+    QVERIFY(run(exp));
+    QVERIFY(nodesState(exp->trials().at(0)) != state);
+
+    // a random order samples the nodes with replacement
+    exp = newAsync("1", "true", error);
+    QVERIFY2(exp, qPrintable(error));
+    QVERIFY(run(exp));
+    int visits = 0;
+    bool allEqual = true;
+    for (auto const& p : exp->trials().at(0)->graph()->nodes()) {
+        visits += p.second.attr("visits").toInt();
+        allEqual = allEqual && p.second.attr("visits").toInt() == stopAt;
+    }
+    QCOMPARE(visits, numNodes * stopAt);
+    QVERIFY(!allEqual);
+}
+
+void TestExperiment::tst_eventModel()
+{
+    // each of the 2000 nodes dies at the given rate; so, the fraction of
+    // alive nodes at the time t=1 (ie, 10 steps of 0.1) is about exp(-rate)
+    const int numNodes = 2000;
+    for (const double rate : { 0.5, 2.0 }) {
+        QString error;
+        ExperimentPtr exp = newExperiment({
+            { GENERAL_ATTR_MODELID, "testDecay" },
+            { GENERAL_ATTR_NODES, "*2000;max" },
+            { GENERAL_ATTR_STOPAT, "10" },
+            { GENERAL_ATTR_TIMESTEP, "0.1" },
+            { "testDecay_rate", QString::number(rate) },
+            { "squareGrid_height", "40" },
+            { "squareGrid_width", "50" }
+        }, error);
+        QVERIFY2(exp, qPrintable(error));
+        QVERIFY(run(exp));
+
+        const Trial* trial = exp->trials().at(0);
+        int alive = 0;
+        for (auto const& p : trial->graph()->nodes()) {
+            alive += p.second.attr("alive").toBool() ? 1 : 0;
+        }
+        const double fraction = static_cast<double>(alive) / numNodes;
+        QVERIFY2(std::abs(fraction - std::exp(-rate)) < 0.05,
+                 qPrintable(QString("%1 alive at t=1").arg(fraction)));
+
+        auto model = dynamic_cast<const AbstractEventModel*>(trial->model());
+        QVERIFY(model);
+        QCOMPARE(model->time(), 1.0);
+        QCOMPARE(model->numEvents(), static_cast<quint64>(numNodes - alive));
+    }
+
+    // it stops as soon as nothing can happen anymore
+    QString error;
+    ExperimentPtr exp = newExperiment({
+        { GENERAL_ATTR_MODELID, "testDecay" },
+        { GENERAL_ATTR_NODES, "*20;max" },
+        { GENERAL_ATTR_STOPAT, "100000" },
+        { "testDecay_rate", "1" },
+        { "squareGrid_height", "4" },
+        { "squareGrid_width", "5" }
+    }, error);
+    QVERIFY2(exp, qPrintable(error));
+    QVERIFY(run(exp));
+    const Trial* trial = exp->trials().at(0);
+    QVERIFY(trial->step() < 100000);
+    for (auto const& p : trial->graph()->nodes()) {
+        QVERIFY(!p.second.attr("alive").toBool());
+    }
+    auto model = dynamic_cast<const AbstractEventModel*>(trial->model());
+    QVERIFY(model);
+    QCOMPARE(model->numEvents(), static_cast<quint64>(20));
+
+    // the time step must be positive
+    exp = newExperiment({
+        { GENERAL_ATTR_MODELID, "testDecay" },
+        { GENERAL_ATTR_NODES, "*20;max" },
+        { GENERAL_ATTR_TIMESTEP, "0" },
+        { "testDecay_rate", "1" },
+        { "squareGrid_height", "4" },
+        { "squareGrid_width", "5" }
+    }, error);
+    QVERIFY(!exp);
+}
+
+void TestExperiment::tst_eventModelBatches()
+{
+    // the steps are performed in batches when no output is due; so, an
+    // event model must give the same results with and without outputs
+    std::map<QString, QStringList> states;
+    std::map<QString, quint64> events;
+    for (const QString& header : { "count_nodes_alive_true", "" }) {
+        QString error;
+        ExperimentPtr exp = newExperiment({
+            { GENERAL_ATTR_MODELID, "testDecay" },
+            { GENERAL_ATTR_NODES, "*400;max" },
+            { GENERAL_ATTR_SEED, "5" },
+            { GENERAL_ATTR_STOPAT, "200" },
+            { GENERAL_ATTR_TIMESTEP, "0.01" },
+            { OUTPUT_HEADER, header },
+            { "testDecay_rate", "0.5" },
+            { "squareGrid_height", "20" },
+            { "squareGrid_width", "20" }
+        }, error);
+        QVERIFY2(exp, qPrintable(error));
+        QVERIFY(run(exp));
+
+        const Trial* trial = exp->trials().at(0);
+        QCOMPARE(trial->step(), 200);
+        auto model = dynamic_cast<const AbstractEventModel*>(trial->model());
+        QVERIFY(model);
+        QCOMPARE(model->time(), 2.0);
+        states[header] = nodesState(trial);
+        events[header] = model->numEvents();
+    }
+    QVERIFY(events.at("") > 0);
+    QCOMPARE(events.at("count_nodes_alive_true"), events.at(""));
+    QCOMPARE(states.at("count_nodes_alive_true"), states.at(""));
+}
+
+void TestExperiment::tst_replicates()
+{
+    // the trials run in groups of replicates must give exactly the same
+    // outputs as when they are run one by one
+    const quint16 numTrials = 6;
+    std::map<QString, QStringList> outputs; // <replicates, output files>
+    std::map<QString, QStringList> states;  // <replicates, trials' nodes>
+    for (const QString& replicates : { "1", "4", "4+resume" }) {
+        QString error;
+        ExperimentPtr exp = newExperiment({
+            { GENERAL_ATTR_MODELID, "populationGrowth" },
+            { GENERAL_ATTR_NODES, "*100;rand_3" },
+            { GENERAL_ATTR_SEED, "9" },
+            { GENERAL_ATTR_STOPAT, "30" },
+            { GENERAL_ATTR_TRIALS, QString::number(numTrials) },
+            { GENERAL_ATTR_REPLICATES, replicates.left(1) },
+            { OUTPUT_HEADER, "count_nodes_infected_true" },
+            { "populationGrowth_prob", "0.2" },
+            { "squareGrid_height", "10" },
+            { "squareGrid_width", "10" }
+        }, error);
+        QVERIFY2(exp, qPrintable(error));
+        if (replicates.endsWith("resume")) {
+            // there's nothing to resume from; the trials run individually
+            exp->setResumeFromCheckpoints(true);
+            QVERIFY2(exp->reset(&error), qPrintable(error));
+        }
+        QVERIFY(run(exp));
+
+        // otherwise, the comparisons below would be pointless
+        for (quint16 trialId = 0; trialId < numTrials; ++trialId) {
+            int groupSize = 1;
+            if (replicates == "4") {
+                const int sizes[] = { 4, 0, 0, 0, 2, 0 }; // trials 0-3 and 4-5
+                groupSize = sizes[trialId];
+            }
+            QCOMPARE(exp->trials().at(trialId)->groupSize(), groupSize);
+        }
+
+        for (quint16 trialId = 0; trialId < numTrials; ++trialId) {
+            states[replicates] << nodesState(exp->trials().at(trialId));
+            QFile file(m_dir.filePath(QString("%1_e%2_t%3.csv")
+                    .arg(m_project->name()).arg(exp->id()).arg(trialId)));
+            QVERIFY(file.open(QFile::ReadOnly));
+            outputs[replicates] << QString(file.readAll());
+        }
+    }
+    QCOMPARE(outputs.at("4"), outputs.at("1"));
+    QCOMPARE(states.at("4"), states.at("1"));
+    QCOMPARE(outputs.at("4+resume"), outputs.at("1"));
+    QCOMPARE(states.at("4+resume"), states.at("1"));
+}
+
+void TestExperiment::tst_checkpointResume()
+{
+    // a trial resumed from its checkpoint must carry on exactly as if it
+    // had never been interrupted, ie, same nodes, same PRG and same rows
+    const int stopAt = 60;
+    const int pauseAt = 45;
+    std::map<QString, QString> attrs = {
+        { GENERAL_ATTR_MODELID, "populationGrowth" },
+        { GENERAL_ATTR_NODES, "*100;rand_3" },
+        { GENERAL_ATTR_SEED, "4" },
+        { GENERAL_ATTR_STOPAT, QString::number(stopAt) },
+        { OUTPUT_HEADER, "count_nodes_infected_true" },
+        { "populationGrowth_prob", "0.2" },
+        { "squareGrid_height", "10" },
+        { "squareGrid_width", "10" }
+    };
+    auto trialFile = [this](const ExperimentPtr& exp, const QString& ext) {
+        return m_dir.filePath(QString("%1_e%2_t0.%3")
+                .arg(m_project->name()).arg(exp->id()).arg(ext));
+    };
+    auto readAll = [](const QString& path) {
+        QFile file(path);
+        return file.open(QFile::ReadOnly) ? QString(file.readAll()) : QString();
+    };
+
+    QString error;
+    ExperimentPtr uninterrupted = newExperiment(attrs, error);
+    QVERIFY2(uninterrupted, qPrintable(error));
+    QVERIFY(run(uninterrupted));
+    const QStringList expectedState = nodesState(uninterrupted->trials().at(0));
+    const QString expectedRows = readAll(trialFile(uninterrupted, "csv"));
+    QVERIFY(!expectedRows.isEmpty());
+
+    // the checkpoints are taken every second; so, the delay makes sure
+    // that there is one somewhere before the pause, followed by some rows
+    // which must be discarded when resuming
+    attrs[OUTPUT_CHECKPOINT] = "1";
+    ExperimentPtr exp = newExperiment(attrs, error);
+    QVERIFY2(exp, qPrintable(error));
+    exp->setDelay(40);
+    exp->setPauseAt(pauseAt);
+    exp->play();
+    QElapsedTimer timer;
+    timer.start();
+    while (!(exp->expStatus() == Status::Paused && exp->trials().at(0)->step() >= pauseAt)
+           && exp->expStatus() != Status::Invalid && timer.elapsed() < 60000) {
+        QTest::qWait(10);
+    }
+    QCOMPARE(exp->expStatus(), Status::Paused);
+    QCOMPARE(exp->trials().at(0)->step(), pauseAt);
+    QVERIFY(QFileInfo::exists(trialFile(exp, "ckpt")));
+
+    // rebuilds the trials from scratch, as when the application is restarted
+    QVERIFY2(exp->disable(&error), qPrintable(error));
+    exp->setDelay(0);
+    exp->setResumeFromCheckpoints(true);
+    QVERIFY2(exp->reset(&error), qPrintable(error));
+    QVERIFY(run(exp));
+
+    QCOMPARE(exp->trials().at(0)->step(), stopAt);
+    QCOMPARE(nodesState(exp->trials().at(0)), expectedState);
+    QCOMPARE(readAll(trialFile(exp, "csv")), expectedRows);
+    // it's not needed anymore
+    QVERIFY(!QFileInfo::exists(trialFile(exp, "ckpt")));
+}
+
+void TestExperiment::tst_timeSlices()
+{
+    // with more trials than threads, the trials which have used up their
+    // quantum yield to the queued ones and resume later on; it must give
+    // exactly the same outputs as when each trial runs to the end at once
+    ExperimentsMgr* expMgr = m_mainApp->expMgr();
+    struct Settings {
+        ExperimentsMgr* mgr;
+        const int threads, steps, msecs;
+        ~Settings() { mgr->setMaxThreadCount(threads); mgr->setQuantum(steps, msecs); }
+    } settings { expMgr, expMgr->maxThreadsCount(), expMgr->quantumSteps(), expMgr->quantumMsecs() };
+    expMgr->setMaxThreadCount(2);
+
+    const quint16 numTrials = 7;
+    std::map<int, QStringList> outputs; // <quantum, output files>
+    std::map<int, QStringList> states;  // <quantum, trials' nodes>
+    for (const int quantum : { 0, 3 }) {
+        expMgr->setQuantum(quantum, 0);
+        QString error;
+        ExperimentPtr exp = newExperiment({
+            { GENERAL_ATTR_MODELID, "populationGrowth" },
+            { GENERAL_ATTR_NODES, "*100;rand_7" },
+            { GENERAL_ATTR_SEED, "2" },
+            { GENERAL_ATTR_STOPAT, "40" },
+            { GENERAL_ATTR_TRIALS, QString::number(numTrials) },
+            { OUTPUT_HEADER, "count_nodes_infected_true" },
+            { "populationGrowth_prob", "0.1" },
+            { "squareGrid_height", "10" },
+            { "squareGrid_width", "10" }
+        }, error);
+        QVERIFY2(exp, qPrintable(error));
+        QVERIFY(run(exp));
+
+        for (quint16 trialId = 0; trialId < numTrials; ++trialId) {
+            QCOMPARE(exp->trials().at(trialId)->step(), 40);
+            states[quantum] << nodesState(exp->trials().at(trialId));
+            QFile file(m_dir.filePath(QString("%1_e%2_t%3.csv")
+                    .arg(m_project->name()).arg(exp->id()).arg(trialId)));
+            QVERIFY(file.open(QFile::ReadOnly));
+            outputs[quantum] << QString(file.readAll());
+        }
+    }
+    QCOMPARE(outputs.at(3), outputs.at(0));
+    QCOMPARE(states.at(3), states.at(0));
+}
+
+QTEST_MAIN(TestExperiment)
+#include "tst_experiment.moc"
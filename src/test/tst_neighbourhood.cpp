@@ -0,0 +1,261 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a multi-agent system for networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <limits>
+#include <random>
+#include <vector>
+#include <QtTest>
+
+#include <core/include/abstractgraph.h>
+
+namespace evoplex {
+
+class RandomGraph : public AbstractGraph
+{
+public:
+    explicit RandomGraph(GraphType type) : AbstractGraph(type) {}
+    bool reset() override { return true; }
+};
+
+class TestNeighbourhood: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {}
+    void cleanupTestCase() {}
+    void tst_star();
+    void tst_random_data();
+    void tst_random();
+    void tst_topologyChanged();
+    void tst_invalid();
+    void tst_adjacency();
+
+private:
+    // node attrs: 0 'value' (double), 1 'flag' (bool), 2 'name' (string)
+    // edge attrs: 0 'weight' (double)
+    void build(RandomGraph& graph, int numNodes, int numEdges, int seed);
+};
+
+void TestNeighbourhood::build(RandomGraph& graph, int numNodes, int numEdges, int seed)
+{
+    std::mt19937 prg(static_cast<quint32>(seed));
+    std::uniform_int_distribution<int> value(-5, 5);
+    for (int i = 0; i < numNodes; ++i) {
+        Attributes attrs(3);
+        attrs.replace(0, "value", Value(static_cast<double>(value(prg))));
+        attrs.replace(1, "flag", Value(value(prg) > 0));
+        attrs.replace(2, "name", Value("n"));
+        graph.addNode(attrs);
+    }
+
+    std::uniform_int_distribution<int> node(0, numNodes - 1);
+    std::uniform_real_distribution<double> weight(0.0, 2.0);
+    for (int i = 0; i < numEdges; ++i) {
+        Attributes* attrs = new Attributes(1);
+        attrs->replace(0, "weight", Value(weight(prg)));
+        graph.addEdge(node(prg), node(prg), attrs);
+    }
+}
+
+void TestNeighbourhood::tst_star()
+{
+    RandomGraph graph(GraphType::Undirected);
+
+    Attributes attrs(3);
+    attrs.replace(1, "flag", Value(true));
+    attrs.replace(2, "name", Value("n"));
+    for (int i = 0; i < 5; ++i) {
+        attrs.replace(0, "value", Value(static_cast<double>(i)));
+        graph.addNode(attrs);
+    }
+    graph.addNode(attrs); // isolated node with value 4
+    for (int i = 1; i < 5; ++i) {
+        Attributes* w = new Attributes(1);
+        w->replace(0, "weight", Value(2.0));
+        graph.addEdge(0, i, w);
+    }
+
+    std::vector<double> sum;
+    QVERIFY(graph.sumNeighbours(0, sum));
+    QCOMPARE(sum, std::vector<double>({10.0, 0.0, 0.0, 0.0, 0.0, 0.0}));
+    QVERIFY(graph.sumNeighbours(0, sum, 0));
+    QCOMPARE(sum, std::vector<double>({20.0, 0.0, 0.0, 0.0, 0.0, 0.0}));
+
+    std::vector<int> count;
+    QVERIFY(graph.countNeighbours(0, Value(0.0), count));
+    QCOMPARE(count, std::vector<int>({0, 1, 1, 1, 1, 0}));
+    QVERIFY(graph.countNeighbours(2, Value("n"), count));
+    QCOMPARE(count, std::vector<int>({4, 1, 1, 1, 1, 0}));
+
+    std::vector<double> max;
+    QVERIFY(graph.maxNeighbours(0, max));
+    QCOMPARE(max[0], 4.0);
+    QCOMPARE(max[1], 0.0);
+    QCOMPARE(max[5], -std::numeric_limits<double>::infinity());
+
+    std::vector<int> argmax;
+    QVERIFY(graph.argmaxNeighbours(0, argmax));
+    QCOMPARE(argmax, std::vector<int>({4, 0, 0, 0, 0, -1}));
+}
+
+void TestNeighbourhood::tst_random_data()
+{
+    QTest::addColumn<int>("type");
+    QTest::addColumn<int>("threads");
+    QTest::newRow("undirected") << static_cast<int>(GraphType::Undirected) << 1;
+    QTest::newRow("directed") << static_cast<int>(GraphType::Directed) << 1;
+    QTest::newRow("undirected, 4 threads") << static_cast<int>(GraphType::Undirected) << 4;
+    QTest::newRow("directed, 4 threads") << static_cast<int>(GraphType::Directed) << 4;
+}
+
+void TestNeighbourhood::tst_random()
+{
+    QFETCH(int, type);
+    QFETCH(int, threads);
+
+    RandomGraph graph(static_cast<GraphType>(type));
+    build(graph, 300, 1200, 42);
+
+    std::vector<double> sum, wsum, max, wmax;
+    std::vector<int> count, argmax;
+    QVERIFY(graph.sumNeighbours(0, sum, -1, threads));
+    QVERIFY(graph.sumNeighbours(0, wsum, 0, threads));
+    QVERIFY(graph.maxNeighbours(0, max, -1, threads));
+    QVERIFY(graph.maxNeighbours(0, wmax, 0, threads));
+    QVERIFY(graph.countNeighbours(1, Value(true), count, threads));
+    QVERIFY(graph.argmaxNeighbours(0, argmax, 0, threads));
+
+    // the reference: walking the outEdges of each node
+    for (auto const& p : graph.nodes()) {
+        const Node& node = p.second;
+        const size_t id = static_cast<size_t>(node.id());
+        double s = 0.0, ws = 0.0;
+        double m = -std::numeric_limits<double>::infinity(), wm = m;
+        int c = 0, am = -1;
+        for (auto const& e : node.outEdges()) {
+            const double v = e.second.neighbour().attr(0).toDouble();
+            const double w = e.second.attr(0).toDouble() * v;
+            s += v;
+            ws += w;
+            m = std::max(m, v);
+            if (am < 0 || w > wm) {
+                am = e.second.neighbour().id();
+            }
+            wm = std::max(wm, w);
+            c += e.second.neighbour().attr(1).toBool() ? 1 : 0;
+        }
+        QCOMPARE(sum[id], s);
+        QCOMPARE(wsum[id], ws);
+        QCOMPARE(max[id], m);
+        QCOMPARE(wmax[id], wm);
+        QCOMPARE(count[id], c);
+        QCOMPARE(argmax[id], am);
+    }
+}
+
+void TestNeighbourhood::tst_topologyChanged()
+{
+    RandomGraph graph(GraphType::Undirected);
+    build(graph, 10, 0, 1);
+
+    std::vector<int> count;
+    QVERIFY(graph.countNeighbours(2, Value("n"), count));
+    QCOMPARE(count, std::vector<int>(10, 0));
+
+    Edge edge = graph.addEdge(3, 7);
+    QVERIFY(graph.countNeighbours(2, Value("n"), count));
+    QCOMPARE(count[3], 1);
+    QCOMPARE(count[7], 1);
+
+    graph.removeEdge(edge);
+    QVERIFY(graph.countNeighbours(2, Value("n"), count));
+    QCOMPARE(count, std::vector<int>(10, 0));
+
+    // the output column is indexed by id, so it keeps the gaps
+    graph.addEdge(0, 9);
+    graph.removeNode(graph.node(4));
+    QVERIFY(graph.countNeighbours(2, Value("n"), count));
+    QCOMPARE(count, std::vector<int>({1, 0, 0, 0, 0, 0, 0, 0, 0, 1}));
+}
+
+void TestNeighbourhood::tst_invalid()
+{
+    RandomGraph graph(GraphType::Undirected);
+    build(graph, 10, 20, 1);
+
+    std::vector<double> out;
+    // strings are not numeric
+    QVERIFY(!graph.sumNeighbours(2, out));
+    QVERIFY(!graph.maxNeighbours(0, out, 2));
+    // out of range
+    QVERIFY(!graph.sumNeighbours(3, out));
+    QVERIFY(!graph.sumNeighbours(0, out, 1));
+}
+
+void TestNeighbourhood::tst_adjacency()
+{
+    RandomGraph graph(GraphType::Directed);
+    build(graph, 200, 800, 3);
+
+    // A x is the weighted sum of the neighbours
+    const SparseMatrix* a = graph.adjacency(0);
+    QVERIFY(a);
+    QCOMPARE(a->size(), 200);
+    QCOMPARE(a->numEntries(), 800);
+    std::vector<double> x(200), y, sum;
+    for (auto const& p : graph.nodes()) {
+        x[static_cast<size_t>(p.first)] = p.second.attr(0).toDouble();
+    }
+    a->multiply(x, y, 4);
+    QVERIFY(graph.sumNeighbours(0, sum, 0));
+    QCOMPARE(y, sum);
+
+    // it's cached until the topology changes
+    QCOMPARE(graph.adjacency(0), a);
+    const SparseMatrix* ones = graph.adjacency();
+    QVERIFY(ones && ones != a);
+    QCOMPARE(ones->values(), std::vector<double>(800, 1.0));
+
+    // A^T x pushes the values along the edges
+    const SparseMatrix* t = graph.adjacency(0, true);
+    QVERIFY(t);
+    t->multiply(x, y);
+    std::vector<double> pushed(200, 0.0);
+    for (auto const& p : graph.edges()) {
+        const Edge& e = p.second;
+        pushed[static_cast<size_t>(e.neighbour().id())] +=
+                e.attr(0).toDouble() * x[static_cast<size_t>(e.origin().id())];
+    }
+    for (size_t i = 0; i < pushed.size(); ++i) {
+        QVERIFY(qAbs(y[i] - pushed[i]) < 1e-9);
+    }
+
+    graph.addEdge(0, 1);
+    a = graph.adjacency();
+    QCOMPARE(a->numEntries(), 801);
+
+    QVERIFY(!graph.adjacency(2)); // not numeric
+}
+
+} // evoplex
+QTEST_MAIN(evoplex::TestNeighbourhood)
+#include "tst_neighbourhood.moc"
@@ -0,0 +1,378 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a multi-agent system for networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <set>
+#include <QThread>
+#include <QtTest>
+
+#include <core/output.h>
+#include <core/outputaggregator.h>
+
+using namespace evoplex;
+
+// exposes the rows storage of an Output
+class RowsOutput : public Output
+{
+public:
+    RowsOutput() : Output(SamplingPolicy()) {}
+    void push(int trialId, int step, const Values& values) { updateCaches(trialId, step, values); }
+    bool operator==(const OutputPtr) const override { return false; }
+protected:
+    Values compute(const Trial*, const Values&) const override { return Values(); }
+};
+
+// runs a function in another thread
+class FunctionThread : public QThread
+{
+public:
+    explicit FunctionThread(std::function<void()> f) : m_f(f) {}
+protected:
+    void run() override { m_f(); }
+private:
+    std::function<void()> m_f;
+};
+
+class TestOutput: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {}
+    void cleanupTestCase() {}
+    void tst_samplingFromString();
+    void tst_samplingStride();
+    void tst_samplingLogSpaced();
+    void tst_samplingOthers();
+    void tst_samplingNextDue();
+    void tst_cacheCursors();
+    void tst_cachesWhileRunning();
+    void tst_outputBudget();
+    void tst_outputAggregator();
+};
+
+void TestOutput::tst_samplingFromString()
+{
+    auto check = [](const QString& str, SamplingPolicy::Type type, int n) {
+        QString error;
+        SamplingPolicy p = SamplingPolicy::fromString(str, error);
+        QVERIFY(error.isEmpty());
+        QCOMPARE(p.type(), type);
+        QCOMPARE(p.n(), n);
+        QCOMPARE(p.toString(), str);
+    };
+    check("stride:1000", SamplingPolicy::Type::Stride, 1000);
+    check("log:10", SamplingPolicy::Type::LogSpaced, 10);
+    check("onchange", SamplingPolicy::Type::OnChange, 1);
+    check("last", SamplingPolicy::Type::LastStep, 1);
+
+    for (const QString& invalid : {"", "stride", "stride:0", "stride:-1",
+                                   "stride:a", "log:", "last:1", "every"}) {
+        QString error;
+        SamplingPolicy p = SamplingPolicy::fromString(invalid, error);
+        QVERIFY(!error.isEmpty());
+        QVERIFY(p.isDense());
+    }
+
+    QVERIFY(SamplingPolicy().isDense());
+    QVERIFY(SamplingPolicy().toString().isEmpty());
+    QVERIFY(SamplingPolicy(SamplingPolicy::Type::Stride, 5) == SamplingPolicy(SamplingPolicy::Type::Stride, 5));
+    QVERIFY(SamplingPolicy(SamplingPolicy::Type::Stride, 5) != SamplingPolicy(SamplingPolicy::Type::Stride, 6));
+    QVERIFY(SamplingPolicy(SamplingPolicy::Type::Stride, 5) != SamplingPolicy(SamplingPolicy::Type::LogSpaced, 5));
+}
+
+void TestOutput::tst_samplingStride()
+{
+    SamplingPolicy p(SamplingPolicy::Type::Stride, 1000);
+    QVERIFY(p.isDue(0));
+    QVERIFY(!p.isDue(1));
+    QVERIFY(!p.isDue(999));
+    QVERIFY(p.isDue(1000));
+    QVERIFY(!p.isDue(1001));
+    QVERIFY(p.isDue(2000000));
+}
+
+void TestOutput::tst_samplingLogSpaced()
+{
+    // one step per decade
+    SamplingPolicy p1(SamplingPolicy::Type::LogSpaced, 1);
+    std::vector<int> due;
+    for (int step = 0; step <= 100000; ++step) {
+        if (p1.isDue(step)) due.emplace_back(step);
+    }
+    QCOMPARE(due, std::vector<int>({0, 1, 10, 100, 1000, 10000, 100000}));
+
+    // about 10 steps per decade
+    SamplingPolicy p10(SamplingPolicy::Type::LogSpaced, 10);
+    int count = 0;
+    for (int step = 1000; step < 10000; ++step) {
+        if (p10.isDue(step)) ++count;
+    }
+    QCOMPARE(count, 10);
+}
+
+void TestOutput::tst_samplingOthers()
+{
+    SamplingPolicy every;
+    SamplingPolicy onChange(SamplingPolicy::Type::OnChange);
+    SamplingPolicy last(SamplingPolicy::Type::LastStep);
+    for (int step = 0; step < 100; ++step) {
+        QVERIFY(every.isDue(step));
+        // the values are always computed to detect changes
+        QVERIFY(onChange.isDue(step));
+        // the last step is handled by the Output
+        QVERIFY(!last.isDue(step));
+    }
+}
+
+void TestOutput::tst_samplingNextDue()
+{
+    SamplingPolicy stride(SamplingPolicy::Type::Stride, 1000);
+    QCOMPARE(stride.nextDue(0), 1000);
+    QCOMPARE(stride.nextDue(999), 1000);
+    QCOMPARE(stride.nextDue(1000), 2000);
+
+    SamplingPolicy every;
+    SamplingPolicy onChange(SamplingPolicy::Type::OnChange);
+    QCOMPARE(every.nextDue(41), 42);
+    QCOMPARE(onChange.nextDue(41), 42);
+
+    SamplingPolicy last(SamplingPolicy::Type::LastStep);
+    QCOMPARE(last.nextDue(0), std::numeric_limits<int>::max());
+
+    // it's the first step after 'step' in which isDue() is true
+    for (int n : {1, 3, 10, 100}) {
+        SamplingPolicy log(SamplingPolicy::Type::LogSpaced, n);
+        int next = 100001;
+        while (!log.isDue(next)) ++next;
+        for (int step = 100000; step >= 0; --step) {
+            QCOMPARE(log.nextDue(step), next);
+            if (log.isDue(step)) next = step;
+        }
+    }
+}
+
+void TestOutput::tst_cacheCursors()
+{
+    auto output = std::make_shared<RowsOutput>();
+    Cache* c1 = output->addCache({Value(1), Value(3)}, {0, 1});
+    Cache* c2 = output->addCache({Value(2)}, {0});
+    // the inputs of a new cache go after the current ones
+    QCOMPARE(output->allInputs(), Values({Value(1), Value(3), Value(2)}));
+    QVERIFY(c1->isEmpty(0));
+    QVERIFY(c2->isEmpty(0));
+    QVERIFY(c2->isEmpty(1)); // c2 does not read trial 1
+
+    output->push(0, 0, {Value(10), Value(30), Value(20)});
+    output->push(0, 5, {Value(11), Value(31), Value(21)});
+
+    // both caches read the same rows, through their own columns
+    const Cache::Row& r1 = c1->readFrontRow(0);
+    const Cache::Row& r2 = c2->readFrontRow(0);
+    QCOMPARE(&r1, &r2); // no copies
+    QCOMPARE(r1.first, 0);
+    QCOMPARE(c1->value(r1, 0), Value(10));
+    QCOMPARE(c1->value(r1, 1), Value(30));
+    QCOMPARE(c2->value(r2, 0), Value(20));
+
+    // moving a cursor does not affect the other cache
+    c1->flushFrontRow(0);
+    QCOMPARE(c1->readFrontRow(0).first, 5);
+    QCOMPARE(c1->value(c1->readFrontRow(0), 1), Value(31));
+    c1->flushFrontRow(0);
+    QVERIFY(c1->isEmpty(0));
+    QVERIFY(!c2->isEmpty(0));
+    QCOMPARE(c2->readFrontRow(0).first, 0);
+    QCOMPARE(c2->value(c2->readFrontRow(0), 0), Value(20));
+
+    // a new cache reads only the new rows
+    Cache* c3 = output->addCache({Value(2)}, {0});
+    QVERIFY(c3->isEmpty(0));
+    output->push(0, 6, {Value(12), Value(32), Value(22)});
+    QCOMPARE(c3->readFrontRow(0).first, 6);
+    QCOMPARE(c3->value(c3->readFrontRow(0), 0), Value(22));
+
+    // the columns never change; so, the pending rows of c2 are still
+    // read correctly after the deletion of c1
+    c1->deleteCache();
+    QCOMPARE(output->allInputs(), Values({Value(1), Value(3), Value(2)}));
+    QVERIFY(output->trialIds() == std::set<int>({0}));
+    QCOMPARE(c2->value(c2->readFrontRow(0), 0), Value(20));
+    c2->flushAll();
+    QVERIFY(c2->isEmpty(0));
+    QCOMPARE(c3->value(c3->readFrontRow(0), 0), Value(22));
+
+    // the rows computed before a cache was added don't have its inputs
+    Cache* c4 = output->addCache({Value(4)}, {0});
+    output->push(0, 7, {Value(13), Value(33), Value(23)});
+    c3->flushFrontRow(0);
+    QCOMPARE(c3->value(c3->readFrontRow(0), 0), Value(23));
+    QVERIFY(!c4->value(c4->readFrontRow(0), 0).isValid());
+
+    c2->deleteCache();
+    c3->deleteCache();
+    c4->deleteCache();
+    QVERIFY(output->isEmpty());
+}
+
+void TestOutput::tst_cachesWhileRunning()
+{
+    // the caches are added and deleted while a trial records its rows
+    auto output = std::make_shared<RowsOutput>();
+    output->createRows(2);
+    Cache* c1 = output->addCache({Value(0)}, {0, 1});
+
+    std::atomic<bool> done(false);
+    FunctionThread trial([&output, &done]() {
+        for (int step = 0; step < 200000; ++step) {
+            const Values inputs = output->allInputs();
+            output->push(step % 2, step, Values(inputs.size(), Value(step)));
+        }
+        done = true;
+    });
+    trial.start();
+
+    bool ok = true;
+    for (int i = 0; !done; ++i) {
+        const int trialId = i % 2;
+        Cache* c = output->addCache({Value(i % 8)}, {trialId});
+        if (!c->isEmpty(trialId)) {
+            const Cache::Row& row = c->readFrontRow(trialId);
+            const Value& v = c->value(row, 0);
+            ok = ok && (!v.isValid() || v == Value(row.first));
+        }
+        c->deleteCache();
+        c1->flushAll();
+    }
+    trial.wait();
+    QVERIFY(ok);
+
+    c1->flushAll();
+    QVERIFY(c1->isEmpty(0) && c1->isEmpty(1));
+    c1->deleteCache();
+    QVERIFY(output->isEmpty());
+}
+
+void TestOutput::tst_outputBudget()
+{
+    auto output = std::make_shared<RowsOutput>();
+    Cache* c1 = output->addCache({Value(1), Value(2)}, {0});
+
+    // a budget of one byte: only the first row is kept in memory
+    auto budget = std::make_shared<OutputBudget>(1, OutputBudget::Policy::Spill);
+    output->setBudget(budget);
+    const int numRows = 1000; // more than a chunk of spilled rows
+    for (int i = 0; i < numRows; ++i) {
+        output->push(0, i, {Value(i), Value(QString("row%1").arg(i))});
+    }
+    const quint64 oneRow = OutputBudget::rowSize({Value(0), Value("row0")});
+    QCOMPARE(budget->usage(), oneRow);
+    QVERIFY(budget->isFull());
+
+    // a cache created now does not see the spilled rows either
+    Cache* c2 = output->addCache({Value(2)}, {0});
+    QVERIFY(c2->isEmpty(0));
+
+    // the spilled rows are read back in order
+    for (int i = 0; i < numRows; ++i) {
+        QVERIFY(!c1->isEmpty(0));
+        const Cache::Row& row = c1->readFrontRow(0);
+        QCOMPARE(row.first, i);
+        QCOMPARE(c1->value(row, 0), Value(i));
+        QCOMPARE(c1->value(row, 1).toQString(), QString("row%1").arg(i));
+        c1->flushFrontRow(0);
+    }
+    QVERIFY(c1->isEmpty(0));
+    QCOMPARE(budget->usage(), quint64(0));
+    QVERIFY(budget->peak() >= oneRow);
+
+    // rows in memory are moved to another budget
+    output->push(0, numRows, {Value(1), Value(2)});
+    auto unlimited = std::make_shared<OutputBudget>(0, OutputBudget::Policy::Block);
+    output->setBudget(unlimited);
+    QCOMPARE(budget->usage(), quint64(0));
+    QVERIFY(unlimited->usage() > 0);
+    QVERIFY(!unlimited->isFull());
+    QVERIFY(unlimited->waitForRoom(0));
+
+    c1->deleteCache();
+    c2->deleteCache();
+    QCOMPARE(unlimited->usage(), quint64(0));
+}
+
+void TestOutput::tst_outputAggregator()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QStringList columns = {"a", "b"};
+    const QString header = OutputAggregator::header(columns);
+    QCOMPARE(header, QString("step,a_n,a_mean,a_std,a_q25,a_q50,a_q75,"
+                             "b_n,b_mean,b_std,b_q25,b_q50,b_q75\n"));
+
+    QString error;
+    auto file = std::make_shared<OutputFile>(dir.filePath("summary.csv"), header);
+    QVERIFY(file->open(error));
+    OutputAggregator aggregator(columns, 2, file);
+
+    // nothing is written until both trials go past a step
+    QVERIFY(aggregator.fold(0, {{0, 0, 1.}, {0, 1, 10.}, {1, 0, 2.}}, 1));
+    QVERIFY(aggregator.fold(1, {{0, 0, 3.}, {1, 0, 4.}}, 0));
+    QVERIFY(aggregator.trialFinished(0));
+    QVERIFY(aggregator.trialFinished(1));
+
+    QFile f(dir.filePath("summary.csv"));
+    QVERIFY(f.open(QFile::ReadOnly));
+    const QStringList lines = QString(f.readAll()).split("\n", QString::SkipEmptyParts);
+    QCOMPARE(lines.size(), 3);
+    QCOMPARE(lines.at(1), QString("0,2,2,1.41421356237,1.5,2,2.5,1,10,0,10,10,10"));
+    // the column 'b' skipped the step 1
+    QCOMPARE(lines.at(2), QString("1,2,3,1.41421356237,2.5,3,3.5,,,,,,"));
+
+    // the statistics held for the trials behind are charged to the budget
+    auto budget = std::make_shared<OutputBudget>(0, OutputBudget::Policy::Flush);
+    auto file2 = std::make_shared<OutputFile>(dir.filePath("summary2.csv"), header);
+    QVERIFY(file2->open(error));
+    {
+        OutputAggregator held(columns, 2, file2, budget);
+        QVERIFY(held.fold(0, {{0, 0, 1.}, {1, 0, 1.}, {2, 0, 1.}}, 2));
+        const quint64 threeSteps = held.usage();
+        QVERIFY(threeSteps > 0);
+        QCOMPARE(budget->usage(), threeSteps);
+        QVERIFY(held.isAhead(0)); // the trial 1 has not started yet
+        QVERIFY(!held.isAhead(1));
+
+        // the step 0 is written and released
+        QVERIFY(held.fold(1, {{0, 0, 2.}}, 0));
+        QCOMPARE(held.usage(), threeSteps / 3 * 2);
+        QCOMPARE(budget->usage(), held.usage());
+        QVERIFY(held.isAhead(0));
+
+        QVERIFY(held.restart(error));
+        QCOMPARE(held.usage(), quint64(0));
+        QVERIFY(held.fold(0, {{0, 0, 1.}}, 0));
+    }
+    // the remaining ones are released with the aggregator
+    QCOMPARE(budget->usage(), quint64(0));
+}
+
+QTEST_MAIN(TestOutput)
+#include "tst_output.moc"
@@ -19,7 +19,10 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <memory>
+#include <numeric>
+#include <vector>
 #include <prg.h>
 #include <QtTest>
 
@@ -37,6 +40,9 @@ private slots:
     void tst_uniformInt();
     void tst_uniformSizeT();
     void tst_uniformFloat();
+    void tst_index();
+    void tst_shuffle();
+    void tst_state();
 };
 
 void TestPRG::tst_prg()
@@ -176,6 +182,70 @@ void TestPRG::tst_uniformSizeT()
     QVERIFY(v <= max);
 }
 
+void TestPRG::tst_index()
+{
+    auto prg = std::unique_ptr<PRG>(new PRG(0));
+
+    QCOMPARE(prg->index(1), 0u);
+
+    const quint32 n = 7;
+    const int samples = 70000;
+    std::vector<int> counts(n, 0);
+    for (int i = 0; i < samples; ++i) {
+        const quint32 v = prg->index(n);
+        QVERIFY(v < n);
+        ++counts[v];
+    }
+    for (int c : counts) {
+        QVERIFY(qAbs(c - samples / static_cast<int>(n)) < 500);
+    }
+
+    // large numbers
+    const quint32 max = UINT32_MAX;
+    QVERIFY(prg->index(max) < max);
+
+    // same seed, same sequence
+    auto prg1 = std::unique_ptr<PRG>(new PRG(123));
+    auto prg2 = std::unique_ptr<PRG>(new PRG(123));
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(prg1->index(1000), prg2->index(1000));
+    }
+}
+
+void TestPRG::tst_shuffle()
+{
+    auto prg = std::unique_ptr<PRG>(new PRG(0));
+
+    std::vector<int> empty;
+    prg->shuffle(empty.begin(), empty.end());
+    QVERIFY(empty.empty());
+
+    // it's a permutation
+    std::vector<int> v(100);
+    std::iota(v.begin(), v.end(), 0);
+    prg->shuffle(v.begin(), v.end());
+    std::vector<int> sorted(v);
+    std::sort(sorted.begin(), sorted.end());
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(sorted[static_cast<size_t>(i)], i);
+    }
+
+    // each element lands in each position equally often
+    const int n = 4;
+    const int samples = 40000;
+    std::vector<int> counts(n * n, 0);
+    for (int s = 0; s < samples; ++s) {
+        std::vector<int> p { 0, 1, 2, 3 };
+        prg->shuffle(p.begin(), p.end());
+        for (int pos = 0; pos < n; ++pos) {
+            ++counts[static_cast<size_t>(p[static_cast<size_t>(pos)] * n + pos)];
+        }
+    }
+    for (int c : counts) {
+        QVERIFY(qAbs(c - samples / n) < 500);
+    }
+}
+
 void TestPRG::tst_uniformFloat()
 {
     auto prg = std::unique_ptr<PRG>(new PRG(0));
@@ -202,5 +272,26 @@ void TestPRG::tst_uniformFloat()
     QVERIFY(v == min);
 }
 
+void TestPRG::tst_state()
+{
+    auto prg1 = std::unique_ptr<PRG>(new PRG(123));
+    for (int i = 0; i < 1000; ++i) prg1->uniform();
+    const std::string state = prg1->state();
+
+    // a PRG with another seed continues the same sequence
+    auto prg2 = std::unique_ptr<PRG>(new PRG(0));
+    QVERIFY(prg2->setState(state));
+    for (int i = 0; i < 1000; ++i) {
+        QCOMPARE(prg1->uniform(), prg2->uniform());
+        QCOMPARE(prg1->uniform(100), prg2->uniform(100));
+    }
+
+    // invalid states are ignored
+    const double next = prg2->uniform();
+    QVERIFY(!prg2->setState("not a state"));
+    QVERIFY(!prg2->setState(""));
+    QCOMPARE(prg1->uniform(), next);
+}
+
 QTEST_MAIN(TestPRG)
 #include "tst_prg.moc"
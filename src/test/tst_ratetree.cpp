@@ -0,0 +1,129 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a multi-agent system for networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <random>
+#include <vector>
+#include <QtTest>
+
+#include <ratetree.h>
+
+namespace evoplex {
+class TestRateTree: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {}
+    void cleanupTestCase() {}
+    void tst_empty();
+    void tst_update();
+    void tst_find();
+    void tst_frequencies();
+};
+
+void TestRateTree::tst_empty()
+{
+    RateTree t;
+    QCOMPARE(t.size(), 0);
+    QCOMPARE(t.total(), 0.0);
+    QCOMPARE(t.find(0.0), -1);
+
+    t.assign({0.0, 0.0, 0.0});
+    QCOMPARE(t.size(), 3);
+    QCOMPARE(t.find(0.0), -1);
+}
+
+void TestRateTree::tst_update()
+{
+    RateTree t;
+    t.assign({1.0, 2.0, 3.0, 4.0, 5.0});
+    QCOMPARE(t.size(), 5);
+    QCOMPARE(t.total(), 15.0);
+    QCOMPARE(t.rate(3), 4.0);
+
+    t.update(3, 0.5);
+    QCOMPARE(t.rate(3), 0.5);
+    QCOMPARE(t.total(), 11.5);
+
+    t.update(0, -1.0); // taken as zero
+    QCOMPARE(t.rate(0), 0.0);
+    QCOMPARE(t.total(), 10.5);
+
+    // the sums are recomputed, so they do not drift
+    for (int i = 0; i < 10000; ++i) {
+        t.update(i % 5, 0.1 * (i % 7));
+    }
+    double total = 0.0;
+    for (int i = 0; i < t.size(); ++i) {
+        total += t.rate(i);
+    }
+    QVERIFY(qAbs(t.total() - total) < 1e-12);
+}
+
+void TestRateTree::tst_find()
+{
+    RateTree t;
+    t.assign({1.0, 0.0, 2.0, 0.0, 0.0, 3.0, 0.0});
+    QCOMPARE(t.find(0.0), 0);
+    QCOMPARE(t.find(0.999), 0);
+    QCOMPARE(t.find(1.0), 2);
+    QCOMPARE(t.find(2.999), 2);
+    QCOMPARE(t.find(3.0), 5);
+    QCOMPARE(t.find(5.999), 5);
+    // a rounding error past the total must not pick a zero rate
+    QCOMPARE(t.find(6.0), 5);
+    QCOMPARE(t.find(6.5), 5);
+
+    t.assign({4.0});
+    QCOMPARE(t.find(0.0), 0);
+    QCOMPARE(t.find(3.9), 0);
+}
+
+void TestRateTree::tst_frequencies()
+{
+    const std::vector<double> rates { 0.5, 0.0, 2.0, 1.0, 0.0, 4.5, 2.0 };
+    RateTree t;
+    t.assign(rates);
+
+    std::mt19937 prg(123);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const int samples = 200000;
+    std::vector<int> counts(rates.size(), 0);
+    for (int i = 0; i < samples; ++i) {
+        const int idx = t.find(uniform(prg) * t.total());
+        QVERIFY(idx >= 0 && idx < t.size());
+        ++counts[static_cast<size_t>(idx)];
+    }
+
+    for (size_t i = 0; i < rates.size(); ++i) {
+        const double expected = rates[i] / t.total();
+        const double observed = counts[i] / static_cast<double>(samples);
+        if (rates[i] == 0.0) {
+            QCOMPARE(counts[i], 0);
+        } else {
+            QVERIFY(qAbs(observed - expected) < 0.01);
+        }
+    }
+}
+
+} // evoplex
+QTEST_MAIN(evoplex::TestRateTree)
+#include "tst_ratetree.moc"
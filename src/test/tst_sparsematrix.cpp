@@ -0,0 +1,141 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a multi-agent system for networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <random>
+#include <utility>
+#include <vector>
+#include <QtTest>
+
+#include <sparsematrix.h>
+
+namespace evoplex {
+class TestSparseMatrix: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {}
+    void cleanupTestCase() {}
+    void tst_empty();
+    void tst_small();
+    void tst_random_data();
+    void tst_random();
+
+private:
+    using Rows = std::vector<std::vector<std::pair<int, double>>>;
+    SparseMatrix fromRows(const Rows& rows) const;
+};
+
+SparseMatrix TestSparseMatrix::fromRows(const Rows& rows) const
+{
+    std::vector<int> offsets { 0 };
+    std::vector<int> columns;
+    std::vector<double> values;
+    for (auto const& row : rows) {
+        for (auto const& e : row) {
+            columns.emplace_back(e.first);
+            values.emplace_back(e.second);
+        }
+        offsets.emplace_back(static_cast<int>(columns.size()));
+    }
+    return SparseMatrix(static_cast<int>(rows.size()), offsets, columns, values);
+}
+
+void TestSparseMatrix::tst_empty()
+{
+    SparseMatrix m;
+    QCOMPARE(m.size(), 0);
+    QCOMPARE(m.numEntries(), 0);
+
+    std::vector<double> x, y { 1.0 };
+    m.multiply(x, y);
+    QVERIFY(y.empty());
+    QCOMPARE(m.transposed().size(), 0);
+}
+
+void TestSparseMatrix::tst_small()
+{
+    // | 0 2 0 |
+    // | 1 0 3 |
+    // | 0 0 0 |
+    SparseMatrix m = fromRows({ {{1, 2.0}}, {{0, 1.0}, {2, 3.0}}, {} });
+    QCOMPARE(m.size(), 3);
+    QCOMPARE(m.numEntries(), 3);
+
+    std::vector<double> y;
+    m.multiply({1.0, 10.0, 100.0}, y);
+    QCOMPARE(y, std::vector<double>({20.0, 301.0, 0.0}));
+
+    SparseMatrix t = m.transposed();
+    QCOMPARE(t.offsets(), std::vector<int>({0, 1, 2, 3}));
+    QCOMPARE(t.columns(), std::vector<int>({1, 0, 1}));
+    QCOMPARE(t.values(), std::vector<double>({1.0, 2.0, 3.0}));
+
+    t.multiply({1.0, 10.0, 100.0}, y);
+    QCOMPARE(y, std::vector<double>({10.0, 2.0, 30.0}));
+}
+
+void TestSparseMatrix::tst_random_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("4 threads") << 4;
+}
+
+void TestSparseMatrix::tst_random()
+{
+    QFETCH(int, threads);
+
+    const int n = 500;
+    std::mt19937 prg(7);
+    std::uniform_int_distribution<int> node(0, n - 1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    Rows rows(n);
+    for (int e = 0; e < 3000; ++e) {
+        rows[static_cast<size_t>(node(prg))].emplace_back(node(prg), uniform(prg));
+    }
+    std::vector<double> x(n);
+    for (double& v : x) {
+        v = uniform(prg);
+    }
+
+    const SparseMatrix m = fromRows(rows);
+    std::vector<double> y, yt;
+    m.multiply(x, y, threads);
+    m.transposed().multiply(x, yt, threads);
+
+    std::vector<double> expectedT(n, 0.0);
+    for (int i = 0; i < n; ++i) {
+        double sum = 0.0;
+        for (auto const& e : rows[static_cast<size_t>(i)]) {
+            sum += e.second * x[static_cast<size_t>(e.first)];
+            expectedT[static_cast<size_t>(e.first)] += e.second * x[static_cast<size_t>(i)];
+        }
+        QCOMPARE(y[static_cast<size_t>(i)], sum);
+    }
+    for (int i = 0; i < n; ++i) {
+        QCOMPARE(yt[static_cast<size_t>(i)], expectedT[static_cast<size_t>(i)]);
+    }
+}
+
+} // evoplex
+QTEST_MAIN(evoplex::TestSparseMatrix)
+#include "tst_sparsematrix.moc"
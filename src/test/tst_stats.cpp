@@ -0,0 +1,117 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a multi-agent system for networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stats.h>
+#include <QtTest>
+
+using namespace evoplex;
+
+class TestStats: public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase() {}
+    void cleanupTestCase() {}
+    void tst_runningStats();
+    void tst_p2QuantileFewObservations();
+    void tst_p2Quantile();
+};
+
+void TestStats::tst_runningStats()
+{
+    RunningStats s;
+    QCOMPARE(s.count(), size_t(0));
+    QVERIFY(std::isnan(s.mean()));
+    QCOMPARE(s.variance(), 0.);
+
+    s.add(4.);
+    QCOMPARE(s.mean(), 4.);
+    QCOMPARE(s.variance(), 0.);
+
+    for (double x : {7., 13., 16.}) {
+        s.add(x);
+    }
+    QCOMPARE(s.count(), size_t(4));
+    QCOMPARE(s.mean(), 10.);
+    QCOMPARE(s.variance(), 30.);
+    QCOMPARE(s.stdev(), std::sqrt(30.));
+
+    // a large offset must not hurt the precision
+    RunningStats shifted;
+    for (double x : {4., 7., 13., 16.}) {
+        shifted.add(1e9 + x);
+    }
+    QCOMPARE(shifted.mean(), 1e9 + 10.);
+    QVERIFY(std::abs(shifted.variance() - 30.) < 1e-4);
+}
+
+void TestStats::tst_p2QuantileFewObservations()
+{
+    P2Quantile median(0.5);
+    QVERIFY(std::isnan(median.value()));
+    median.add(3.);
+    QCOMPARE(median.value(), 3.);
+    median.add(1.);
+    QCOMPARE(median.value(), 2.);
+    median.add(2.);
+    QCOMPARE(median.value(), 2.);
+
+    P2Quantile q25(0.25);
+    for (double x : {40., 10., 30., 20.}) {
+        q25.add(x);
+    }
+    QCOMPARE(q25.count(), size_t(4));
+    QCOMPARE(q25.value(), 17.5);
+}
+
+void TestStats::tst_p2Quantile()
+{
+    // 0..9999 in a random order
+    std::vector<double> data(10000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = i;
+    }
+    std::mt19937 gen(123);
+    std::shuffle(data.begin(), data.end(), gen);
+
+    for (double p : {0.05, 0.25, 0.5, 0.75, 0.95}) {
+        P2Quantile q(p);
+        for (double x : data) {
+            q.add(x);
+        }
+        QCOMPARE(q.count(), data.size());
+        const double expected = p * (data.size() - 1);
+        QVERIFY2(std::abs(q.value() - expected) < 0.01 * data.size(),
+                 qPrintable(QString("p=%1 expected=%2 got=%3").arg(p).arg(expected).arg(q.value())));
+    }
+
+    // a constant stream
+    P2Quantile q(0.5);
+    for (int i = 0; i < 100; ++i) {
+        q.add(7.);
+    }
+    QCOMPARE(q.value(), 7.);
+}
+
+QTEST_MAIN(TestStats)
+#include "tst_stats.moc"
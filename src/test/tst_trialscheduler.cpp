@@ -0,0 +1,174 @@
+/**
+ *  This file is part of Evoplex.
+ *
+ *  Evoplex is a multi-agent system for networks.
+ *  Copyright (C) 2018 - Marcos Cardinot <marcos@cardinot.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <atomic>
+#include <vector>
+#include <QSemaphore>
+#include <QtTest>
+
+#include <core/trialscheduler.h>
+
+using namespace evoplex;
+
+// the scheduler never dereferences the trials; let's use fake ones
+static Trial* fakeTrial(int i) { return reinterpret_cast<Trial*>(static_cast<quintptr>(i + 1)); }
+static int fakeId(const Trial* t) { return static_cast<int>(reinterpret_cast<quintptr>(t)) - 1; }
+
+class TestTrialScheduler: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {}
+    void cleanupTestCase() {}
+    void tst_runAll();
+    void tst_stealing();
+    void tst_removeIf();
+    void tst_resize();
+};
+
+void TestTrialScheduler::tst_runAll()
+{
+    const int numTrials = 1000;
+    std::vector<std::atomic<int>> runs(numTrials);
+    for (auto& r : runs) r = 0;
+    std::atomic<int> done(0);
+
+    TrialScheduler scheduler(4, [&](Trial* t) { ++runs[fakeId(t)]; ++done; });
+    QCOMPARE(scheduler.numWorkers(), 4);
+
+    std::vector<Trial*> trials;
+    for (int i = 0; i < numTrials; ++i) {
+        trials.emplace_back(fakeTrial(i));
+        if (trials.size() == 7) { // several small batches
+            scheduler.submit(trials);
+            trials.clear();
+        }
+    }
+    scheduler.submit(trials);
+
+    QTRY_COMPARE(done.load(), numTrials);
+    for (auto& r : runs) {
+        QCOMPARE(r.load(), 1); // exactly once
+    }
+    QCOMPARE(scheduler.numQueued(), 0);
+}
+
+void TestTrialScheduler::tst_stealing()
+{
+    // trial 0 blocks its worker; the other one must take all the rest
+    QSemaphore release;
+    std::atomic<int> done(0);
+    TrialScheduler scheduler(2, [&](Trial* t) {
+        if (fakeId(t) == 0) release.acquire();
+        ++done;
+    });
+
+    std::vector<Trial*> trials;
+    for (int i = 0; i < 100; ++i) {
+        trials.emplace_back(fakeTrial(i));
+    }
+    scheduler.submit(trials);
+
+    QTRY_COMPARE(done.load(), 99);
+    release.release();
+    QTRY_COMPARE(done.load(), 100);
+}
+
+void TestTrialScheduler::tst_removeIf()
+{
+    QSemaphore started, release;
+    std::vector<std::atomic<int>> runs(50);
+    for (auto& r : runs) r = 0;
+    std::atomic<int> done(0);
+    TrialScheduler scheduler(1, [&](Trial* t) {
+        if (fakeId(t) == 0) {
+            started.release();
+            release.acquire();
+        }
+        ++runs[fakeId(t)];
+        ++done;
+    });
+
+    scheduler.submit({fakeTrial(0)});
+    started.acquire(); // the only worker is busy now
+
+    std::vector<Trial*> trials;
+    for (int i = 1; i < 50; ++i) {
+        trials.emplace_back(fakeTrial(i));
+    }
+    scheduler.submit(trials);
+    QCOMPARE(scheduler.numQueued(), 49);
+
+    const int removed = scheduler.removeIf([](const Trial* t) { return fakeId(t) % 2 == 0; });
+    QCOMPARE(removed, 24);
+    QCOMPARE(scheduler.numQueued(), 25);
+
+    release.release();
+    QTRY_COMPARE(done.load(), 26);
+    for (int i = 1; i < 50; ++i) {
+        QCOMPARE(runs[i].load(), i % 2);
+    }
+}
+
+void TestTrialScheduler::tst_resize()
+{
+    QSemaphore gate;
+    std::atomic<int> running(0);
+    std::atomic<int> done(0);
+    TrialScheduler scheduler(4, [&](Trial*) {
+        ++running;
+        gate.acquire();
+        --running;
+        ++done;
+    });
+    QVERIFY(scheduler.maxWorkers() >= 4);
+
+    // the excess workers are idle; they retire right away
+    scheduler.resize(1);
+    QCOMPARE(scheduler.numWorkers(), 1);
+
+    std::vector<Trial*> trials;
+    for (int i = 0; i < 12; ++i) {
+        trials.emplace_back(fakeTrial(i));
+    }
+    scheduler.submit(trials);
+    QTRY_COMPARE(running.load(), 1);
+    QTest::qWait(50);
+    QCOMPARE(running.load(), 1);
+
+    // the new workers take the queued trials immediately
+    scheduler.resize(3);
+    QCOMPARE(scheduler.numWorkers(), 3);
+    QTRY_COMPARE(running.load(), 3);
+
+    // shrinking does not interrupt the running trials
+    scheduler.resize(2);
+    QCOMPARE(scheduler.numWorkers(), 2);
+    QCOMPARE(running.load(), 3);
+
+    gate.release(12);
+    QTRY_COMPARE(done.load(), 12);
+    QCOMPARE(scheduler.numQueued(), 0);
+}
+
+QTEST_MAIN(TestTrialScheduler)
+#include "tst_trialscheduler.moc"
@@ -38,6 +38,7 @@ private slots:
     void tst_valueInt();
     void tst_valueChar();
     void tst_valueString();
+    void tst_dataStream();
 };
 
 void TestValue::tst_valueInvalid()
@@ -339,5 +340,30 @@ void TestValue::tst_valueString()
     QCOMPARE(vCopy2, Value(""));
 }
 
+void TestValue::tst_dataStream()
+{
+    const Values values = { Value(), Value(true), Value('c'), Value(-1.5),
+                            Value(42), Value(QString("abc£ãã&")), Value("") };
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    for (const Value& v : values) {
+        out << v;
+    }
+    QCOMPARE(out.status(), QDataStream::Ok);
+
+    QDataStream in(data);
+    for (const Value& expected : values) {
+        Value v;
+        in >> v;
+        QCOMPARE(v.type(), expected.type());
+        if (expected.isValid()) {
+            QCOMPARE(v, expected);
+        }
+    }
+    QCOMPARE(in.status(), QDataStream::Ok);
+    QVERIFY(in.atEnd());
+}
+
 QTEST_MAIN(TestValue)
 #include "tst_value.moc"